@@ -0,0 +1,900 @@
+// bench times the hot paths of the parameter library and reports how much
+// memory each parameter costs. Every measurement is one record in a JSON
+// document, so runs can be compared between commits:
+//
+//   cmake --build build --target bench    # writes build/bench.json
+//   ./bench_parameters [results.json]     # JSON to stdout without a path
+//
+// A readable summary always goes to stderr. Timings are the best of a few
+// runs and measure a warm cache; run on an idle machine and compare results
+// from the same host only.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../cbor.hpp"
+#include "../concurrent_parameter.hpp"
+#include "../journal_storage.hpp"
+#include "../json.hpp"
+#include "../packed_file_storage.hpp"
+#include "../parameter.hpp"
+#include "../rpc.hpp"
+#include "../rpc_socket.hpp"
+
+#ifndef CGX_BENCH_PACKED_PATH
+#define CGX_BENCH_PACKED_PATH "./bench_lun%zu.bin"
+#endif
+
+#ifndef CGX_BENCH_JOURNAL_PATH
+#define CGX_BENCH_JOURNAL_PATH "./bench_journal%zu.bin"
+#endif
+
+#ifndef CGX_BENCH_SOCKET_PATH
+#define CGX_BENCH_SOCKET_PATH "./bench_rpc.sock"
+#endif
+
+// Every allocation goes through the global operator new, which counts the
+// bytes so that heap footprints can be read as a difference.
+namespace {
+size_t g_heap_bytes = 0;
+}  // namespace
+
+void* operator new(size_t size) {
+    g_heap_bytes += size;
+    if (void* p = std::malloc(size > 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Kept out of line so that GCC does not see free() paired with new.
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// The per-UID hooks are unused: every list here goes through a batched
+// backend or stays in RAM.
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+using namespace cgx::parameter;
+using clock_type = std::chrono::steady_clock;
+
+constexpr int    runs = 5;
+constexpr size_t ops  = size_t{1} << 20;
+
+struct result_t {
+    std::string name;
+    double      value;
+    const char* unit;
+};
+
+std::vector<result_t> g_results;
+
+void report(std::string name, double value, const char* unit) {
+    std::fprintf(stderr, "%-40s %14.2f %s\n", name.c_str(), value, unit);
+    g_results.push_back({std::move(name), value, unit});
+}
+
+// keep stops the compiler from dropping a result it can prove unused.
+template <typename T>
+void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// best returns the fastest of a few runs of body, in nanoseconds.
+template <typename F>
+double best(F&& body) {
+    double fastest = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < runs; ++run) {
+        const auto start = clock_type::now();
+        body();
+        const std::chrono::duration<double, std::nano> took =
+            clock_type::now() - start;
+        fastest = std::min(fastest, took.count());
+    }
+    return fastest;
+}
+
+double mb_per_s(size_t bytes, double ns) {
+    return static_cast<double>(bytes) * 1e3 / ns;
+}
+
+void discard(const char*) {
+}
+
+// names keeps generated parameter names alive, since parameters only hold
+// a view of their name.
+class names {
+   public:
+    names(const char* prefix, size_t count) : m_names(count) {
+        for (size_t i = 0; i < count; ++i) {
+            std::snprintf(
+                m_names[i].data(), m_names[i].size(), "%s_%zu", prefix, i
+            );
+        }
+    }
+
+    std::string_view operator[](size_t index) const {
+        return m_names[index].data();
+    }
+
+   private:
+    std::vector<std::array<char, 32>> m_names;
+};
+
+// fill adds count parameters cycling through int, float and a small table.
+template <typename List>
+void fill(List& list, const names& name, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        switch (i % 3) {
+            case 0: list.add(name[i], static_cast<int>(i)); break;
+            case 1: list.add(name[i], static_cast<float>(i) * 0.5f); break;
+            case 2: list.add(name[i], std::array<float, 8>{}); break;
+        }
+    }
+}
+
+template <typename T>
+void bench_access(const char* type, const T& a, const T& b) {
+    cgx::unique_parameter_list<0, 1> list(discard);
+    auto&                            param = list.add("value", a);
+
+    const double set = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            param.set_value(i & 1 ? a : b);
+        }
+    });
+    report(std::string("set_value.") + type, set / ops, "ns");
+
+    const double get = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keep(param.value());
+        }
+    });
+    report(std::string("value.") + type, get / ops, "ns");
+}
+
+// bench_concurrent reads a value while another thread keeps writing it,
+// once through the lock-free concurrent<T> parameter and once through a
+// plain parameter guarded by a mutex.
+void bench_concurrent() {
+    cgx::unique_parameter_list<0, 2> list(discard);
+    auto&      shared  = list.add("shared", cgx::concurrent<float>{0.0f});
+    auto&      guarded = list.add("guarded", 0.0f);
+    std::mutex mutex;
+
+    std::atomic<bool> done{false};
+    std::thread       writer([&]() {
+        float value = 0.0f;
+        while (!done.load(std::memory_order_relaxed)) {
+            value += 1.0f;
+            shared = value;
+            std::lock_guard<std::mutex> lock(mutex);
+            guarded = value;
+        }
+    });
+
+    const double lock_free = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keep(shared.value());
+        }
+    });
+    report("concurrent.read", lock_free / ops, "ns");
+
+    const double locked = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            std::lock_guard<std::mutex> lock(mutex);
+            keep(guarded.value());
+        }
+    });
+    report("mutex.read", locked / ops, "ns");
+
+    done.store(true, std::memory_order_relaxed);
+    writer.join();
+}
+
+// bench_crc dirties one byte before each get_crc() so that the whole value
+// of N bytes is folded again.
+template <size_t N>
+void bench_crc() {
+    cgx::unique_parameter_list<0, 1> list(discard);
+    auto& param = list.add("table", std::array<int, N / sizeof(int)>{});
+
+    const size_t n    = std::max<size_t>(1024, (size_t{1} << 26) / N);
+    uint8_t      byte = 0;
+    const double took = best([&] {
+        for (size_t i = 0; i < n; ++i) {
+            byte += 1;
+            param.set_bytes_at(0, &byte, 1);
+            keep(param.get_crc());
+        }
+    });
+    const std::string name = "get_crc." + std::to_string(N);
+    report(name, took / n, "ns");
+    report(name + ".throughput", mb_per_s(N * n, took), "MB/s");
+
+    if (N == 4) {
+        const double cached = best([&] {
+            for (size_t i = 0; i < ops; ++i) {
+                keep(param.get_crc());
+            }
+        });
+        report("get_crc.cached", cached / ops, "ns");
+    }
+}
+
+// bench_dispatch reads the bytes of 1000 parameters and hashes them with
+// FNV-1a steps, once through unique_parameter_i and once through
+// for_each(), which passes each one as its final unique_parameter<T>.
+void bench_dispatch() {
+    constexpr size_t count = 1000;
+    using list_t           = cgx::unique_parameter_list<0, count>;
+
+    const names name("param", count);
+    auto        list = std::make_unique<list_t>(discard);
+    for (size_t i = 0; i < count; ++i) {
+        if (i & 1) {
+            list->add(name[i], static_cast<float>(i) * 0.5f);
+        } else {
+            list->add(name[i], static_cast<int>(i));
+        }
+    }
+
+    constexpr size_t repeat = 256;
+    uint32_t         crc    = 0;
+    auto             hash   = [&crc](const auto& param) {
+        uint32_t word = 0;
+        param.get_bytes(reinterpret_cast<uint8_t*>(&word), sizeof(word));
+        crc = (crc ^ word) * 16777619u;
+    };
+
+    const list_t& all          = *list;
+    const double  virtual_call = best([&] {
+        for (size_t i = 0; i < repeat; ++i) {
+            for (size_t slot = 0; slot < all.size(); ++slot) {
+                hash(*all.at(slot));
+            }
+        }
+    });
+    keep(crc);
+    report("dispatch.virtual.1000", virtual_call / (repeat * count), "ns");
+
+    const double for_each = best([&] {
+        for (size_t i = 0; i < repeat; ++i) {
+            all.for_each<int, float>(hash);
+        }
+    });
+    keep(crc);
+    report("dispatch.for_each.1000", for_each / (repeat * count), "ns");
+}
+
+// bench_crc_backend runs one crc32 update function over a 16 KiB buffer.
+// Cycles are read from the time-stamp counter where there is one, so
+// bytes/cycle is only reported on x86.
+template <typename F>
+void bench_crc_backend(const char* backend, F&& update) {
+    constexpr size_t     size   = 16 * 1024;
+    constexpr size_t     repeat = 256;
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 131);
+    }
+
+    uint32_t crc  = cgx::_init_crc32();
+    double   took = std::numeric_limits<double>::infinity();
+#if defined(__x86_64__) || defined(__i386__)
+    double cycles = std::numeric_limits<double>::infinity();
+#endif
+    for (int run = 0; run < runs; ++run) {
+        const auto start = clock_type::now();
+#if defined(__x86_64__) || defined(__i386__)
+        const uint64_t tsc = __rdtsc();
+#endif
+        for (size_t i = 0; i < repeat; ++i) {
+            crc = update(crc, data.data(), size);
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        cycles = std::min(cycles, static_cast<double>(__rdtsc() - tsc));
+#endif
+        const std::chrono::duration<double, std::nano> elapsed =
+            clock_type::now() - start;
+        took = std::min(took, elapsed.count());
+    }
+    keep(crc);
+
+    const std::string name = std::string("crc32.") + backend;
+    report(name + ".throughput", mb_per_s(size * repeat, took), "MB/s");
+#if defined(__x86_64__) || defined(__i386__)
+    report(name + ".bytes_per_cycle", size * repeat / cycles, "B/cycle");
+#endif
+}
+
+void bench_crc_backends() {
+    bench_crc_backend("bytewise", cgx::crc32::update_bytewise);
+    bench_crc_backend("slice_4", cgx::crc32::update_slice<4>);
+    bench_crc_backend("slice_8", cgx::crc32::update_slice<8>);
+    bench_crc_backend("slice_16", cgx::crc32::update_slice<16>);
+#if CGX_CRC32_HAS_PCLMUL
+    if (cgx::crc32::has_pclmul()) {
+        bench_crc_backend("pclmul", cgx::crc32::update_pclmul);
+    }
+#endif
+#if CGX_CRC32_HAS_ARMV8
+    bench_crc_backend("armv8", cgx::crc32::update_armv8);
+#endif
+    bench_crc_backend("update", cgx::crc32::update);
+}
+
+template <size_t N>
+void bench_lookup() {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+    const names name("param", N);
+    const names absent("absent", N);
+    auto        list = std::make_unique<cgx::unique_parameter_list<0, N>>(
+        discard
+    );
+    std::vector<uid_value_t> hits(N), misses(N);
+    for (size_t i = 0; i < N; ++i) {
+        list->add(name[i], static_cast<int>(i));
+        hits[i]   = cgx::parameter::uid_t::hash(name[i]);
+        misses[i] = cgx::parameter::uid_t::hash(absent[i]);
+    }
+
+    const double find = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keep(list->find(hits[i & (N - 1)]));
+        }
+    });
+    report("find." + std::to_string(N), find / ops, "ns");
+
+    const double exists = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keep(list->uid_exists(hits[i & (N - 1)]));
+        }
+    });
+    report("uid_exists.hit." + std::to_string(N), exists / ops, "ns");
+
+    const double missing = best([&] {
+        for (size_t i = 0; i < ops; ++i) {
+            keep(list->uid_exists(misses[i & (N - 1)]));
+        }
+    });
+    report("uid_exists.miss." + std::to_string(N), missing / ops, "ns");
+}
+
+// bench_init times init() against a packed file. The first run creates
+// every record; the cold runs open the file with a new backend and a new
+// list each time, as a reboot would.
+void bench_init() {
+    constexpr size_t count = 200;
+    using list_t           = cgx::unique_parameter_list<0, count>;
+
+    char path[256];
+    std::snprintf(path, sizeof(path), CGX_BENCH_PACKED_PATH, size_t{0});
+    std::remove(path);
+
+    const names name("param", count);
+    auto        boot = [&](bool& ok) {
+        packed_file_storage storage(CGX_BENCH_PACKED_PATH);
+        set_storage(&storage);
+        auto list = std::make_unique<list_t>(discard);
+        fill(*list, name, count);
+
+        const auto start = clock_type::now();
+        ok               = list->init();
+        const std::chrono::duration<double, std::micro> took =
+            clock_type::now() - start;
+
+        list.reset();
+        set_storage(nullptr);
+        return took.count();
+    };
+
+    bool         ok    = false;
+    const double first = boot(ok);
+    if (!ok) {
+        std::fprintf(stderr, "init: cannot use %s\n", path);
+        return;
+    }
+    report("init.first." + std::to_string(count), first, "us");
+
+    double cold = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < 4 * runs; ++run) {
+        cold = std::min(cold, boot(ok));
+    }
+    report("init.cold." + std::to_string(count), cold, "us");
+
+    std::remove(path);
+}
+
+// bench_journal stores one changed int at a time through a journal, so
+// each update is one appended record and one fdatasync(), then the same
+// updates 16 to a transaction. Compaction is off, so the bytes appended
+// per update show the record overhead on top of the 4-byte payload.
+void bench_journal() {
+    constexpr size_t count   = 64;
+    constexpr size_t updates = 1024;
+    constexpr size_t batch   = 16;
+    using list_t             = cgx::unique_parameter_list<0, count>;
+
+    char path[256];
+    std::snprintf(path, sizeof(path), CGX_BENCH_JOURNAL_PATH, size_t{0});
+    std::remove(path);
+
+    const names     name("param", count);
+    journal_storage storage(CGX_BENCH_JOURNAL_PATH, false);
+    set_storage(&storage);
+
+    auto list = std::make_unique<list_t>(discard);
+    std::vector<cgx::unique_parameter<int>*> params;
+    for (size_t i = 0; i < count; ++i) {
+        params.push_back(&list->add(name[i], 0));
+    }
+    if (!list->init()) {
+        std::fprintf(stderr, "journal: cannot use %s\n", path);
+        set_storage(nullptr);
+        return;
+    }
+
+    auto run = [&](const char* mode, size_t per_commit) {
+        const journal_file::stats_t before = storage.file(0)->stats();
+        bool                        ok     = true;
+        const auto                  start  = clock_type::now();
+        for (size_t i = 0; i < updates; i += per_commit) {
+            transaction commit(0);
+            for (size_t j = i; j < i + per_commit; ++j) {
+                auto& param = *params[j % count];
+                param       = param + 1;
+                ok          = param.store() && ok;
+            }
+            ok = commit.commit() && ok;
+        }
+        const std::chrono::duration<double> took = clock_type::now() - start;
+        const journal_file::stats_t after        = storage.file(0)->stats();
+        if (!ok || after.appends - before.appends != updates) {
+            std::fprintf(stderr, "journal: %s updates failed\n", mode);
+            return;
+        }
+
+        const std::string prefix = std::string("journal.") + mode;
+        report(prefix + ".rate", updates / took.count(), "updates/s");
+        report(
+            prefix + ".bytes",
+            static_cast<double>(after.bytes_appended - before.bytes_appended) /
+                updates,
+            "B/update"
+        );
+    };
+    run("single", 1);
+    run("batch_16", batch);
+
+    list.reset();
+    set_storage(nullptr);
+    std::remove(path);
+}
+
+void bench_print() {
+    constexpr size_t count = 256;
+
+    size_t      bytes = 0;
+    auto        sink  = [&bytes](const char* text) {
+        bytes += std::strlen(text);
+    };
+    const names name("param", count);
+    cgx::unique_parameter_list<0, count> list(sink);
+    for (size_t i = 0; i < count; ++i) {
+        if (i & 1) {
+            list.add(name[i], static_cast<float>(i) * 0.25f);
+        } else {
+            list.add(name[i], static_cast<int>(i) * 1000);
+        }
+    }
+
+    constexpr size_t repeat = 64;
+    const double     took   = best([&] {
+        bytes = 0;
+        for (size_t i = 0; i < repeat; ++i) {
+            list.print();
+        }
+    });
+    report("print.list", took / (repeat * count), "ns/param");
+    report("print.list.throughput", mb_per_s(bytes, took), "MB/s");
+
+    const double line = best([&] {
+        for (size_t i = 0; i < repeat; ++i) {
+            for (size_t slot = 0; slot < list.size(); ++slot) {
+                list.at(slot)->print();
+            }
+        }
+    });
+    report("print.line", line / (repeat * count), "ns/param");
+}
+
+template <typename T>
+void footprint(const char* type, const T& value) {
+    const std::string name = type;
+    report("memory.sizeof." + name, sizeof(cgx::unique_parameter<T>), "B");
+    report(
+        "memory.stack." + name, cgx::unique_parameter<T>::stack_usage(), "B"
+    );
+
+    cgx::unique_parameter_list<0, 1> heap(discard);
+    size_t                           before = g_heap_bytes;
+    heap.add("value", value);
+    report("memory.heap." + name, g_heap_bytes - before, "B");
+
+    cgx::unique_parameter_list<0, 1, sizeof(cgx::unique_parameter<T>)> arena(
+        discard
+    );
+    before = g_heap_bytes;
+    arena.add("value", value);
+    report("memory.heap.arena." + name, g_heap_bytes - before, "B");
+}
+
+// array_layout compares parameter<std::array<T, N>>, which packs values
+// and defaults into two blocks, with the layout it replaced: one whole
+// parameter<T> per element.
+template <typename T, size_t N>
+void array_layout(const char* type) {
+    const std::string name = std::string("memory.array_layout.") + type;
+    report(name + ".elementwise", sizeof(std::array<parameter<T>, N>), "B");
+    report(name + ".packed", sizeof(parameter<std::array<T, N>>), "B");
+}
+
+void bench_memory() {
+    footprint("int", 0);
+    footprint("float", 0.0f);
+    footprint("array_float_16", std::array<float, 16>{});
+    footprint("array_int_256", std::array<int, 256>{});
+    array_layout<float, 16>("float_16");
+    array_layout<int, 256>("int_256");
+    report(
+        "memory.list.256", sizeof(cgx::unique_parameter_list<0, 256>), "B"
+    );
+}
+
+void bench_codec() {
+    constexpr size_t count = 240;
+
+    const names                          name("param", count);
+    cgx::unique_parameter_list<0, count> list(discard);
+    fill(list, name, count);
+
+    std::vector<uint8_t> buffer(64 * 1024);
+    size_t               size = 0;
+
+    const double json_out = best([&] {
+        byte_output out(buffer.data(), buffer.size());
+        json_writer writer(out);
+        list.export_values(writer);
+        size = out.size();
+    });
+    report("json.export", mb_per_s(size, json_out), "MB/s");
+
+    const double json_in = best([&] {
+        json_reader reader(buffer.data(), size);
+        list.import_values(reader);
+    });
+    report("json.import", mb_per_s(size, json_in), "MB/s");
+
+    const double cbor_out = best([&] {
+        byte_output out(buffer.data(), buffer.size());
+        cbor_writer writer(out);
+        list.export_values(writer);
+        size = out.size();
+    });
+    report("cbor.export", mb_per_s(size, cbor_out), "MB/s");
+
+    const double cbor_in = best([&] {
+        cbor_reader reader(buffer.data(), size);
+        list.import_values(reader);
+    });
+    report("cbor.import", mb_per_s(size, cbor_in), "MB/s");
+
+    buffer.resize(list.snapshot_size());
+    const double snapshot = best([&] {
+        keep(list.snapshot(buffer.data(), buffer.size()));
+    });
+    report("snapshot." + std::to_string(count), snapshot / 1e3, "us");
+
+    const double restore = best([&] {
+        keep(list.restore(buffer.data(), buffer.size()));
+    });
+    report("restore." + std::to_string(count), restore / 1e3, "us");
+}
+
+// timed_restore returns the best time restoring list to the blob to, each
+// run starting from the values in the blob from.
+template <typename List>
+double timed_restore(
+    List&                       list,
+    const std::vector<uint8_t>& from,
+    const std::vector<uint8_t>& to
+) {
+    double fastest = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < runs; ++run) {
+        list.restore(from.data(), from.size());
+        const auto start = clock_type::now();
+        keep(list.restore(to.data(), to.size()));
+        const std::chrono::duration<double, std::nano> took =
+            clock_type::now() - start;
+        fastest = std::min(fastest, took.count());
+    }
+    return fastest;
+}
+
+// bench_sync restores 1000 parameters from a snapshot, then builds and
+// applies deltas against a peer that differs in 1%, 10% and 100% of them.
+// Each timed restore starts from the other values, so every record in it
+// changes a parameter.
+void bench_sync() {
+    constexpr size_t count = 1000;
+    using list_t           = cgx::unique_parameter_list<0, count>;
+
+    const names name("param", count);
+    auto        local = std::make_unique<list_t>(discard);
+    auto        peer  = std::make_unique<list_t>(discard);
+    std::vector<cgx::unique_parameter<int>*> params;
+    for (size_t i = 0; i < count; ++i) {
+        params.push_back(&local->add(name[i], 0));
+        peer->add(name[i], 0);
+    }
+
+    auto snapshot = [](const list_t& list) {
+        std::vector<uint8_t> blob(list.snapshot_size());
+        blob.resize(list.snapshot(blob.data(), blob.size()));
+        return blob;
+    };
+
+    const std::vector<uint8_t> base = snapshot(*local);
+    for (size_t i = 0; i < count; ++i) {
+        *params[i] = static_cast<int>(i) + 1;
+    }
+    const std::vector<uint8_t> full = snapshot(*local);
+    report(
+        "restore." + std::to_string(count),
+        timed_restore(*local, base, full) / 1e3,
+        "us"
+    );
+
+    std::vector<uint8_t> manifest(peer->manifest_size());
+    manifest.resize(peer->manifest(manifest.data(), manifest.size()));
+    for (const size_t percent : {1, 10, 100}) {
+        local->restore(base.data(), base.size());
+        for (size_t i = 0; i < count * percent / 100; ++i) {
+            *params[i * 100 / percent] = static_cast<int>(i) + 1;
+        }
+
+        std::vector<uint8_t> delta(local->snapshot_size());
+        size_t               size  = 0;
+        const double         build = best([&] {
+            size = local->delta(
+                manifest.data(), manifest.size(), delta.data(), delta.size()
+            );
+        });
+        delta.resize(size);
+
+        const std::string prefix = "delta." + std::to_string(percent) + "pct";
+        report(prefix + ".size", static_cast<double>(size), "B");
+        report(prefix + ".build", build / 1e3, "us");
+        const double apply = timed_restore(*peer, base, delta);
+        report(prefix + ".apply", apply / 1e3, "us");
+    }
+}
+
+// bench_rpc serves GET batches in process, which leaves out the socket.
+void bench_rpc() {
+    constexpr size_t count = 64;
+    constexpr size_t batch = 16;
+    using list_t           = cgx::unique_parameter_list<0, count>;
+
+    const names name("param", count);
+    list_t      list(discard);
+    fill(list, name, count);
+    rpc_handler<list_t> handler(list);
+
+    uint8_t     frame[sizeof(rpc_header_t) + batch * sizeof(uid_value_t)];
+    rpc_request request(frame, sizeof(frame));
+    request.begin(rpc_get, 1);
+    for (size_t i = 0; i < batch; ++i) {
+        request.add(cgx::parameter::uid_t::hash(name[i]));
+    }
+    request.finish();
+
+    std::vector<iovec>   iov(CGX_PARAMETER_RPC_IOV);
+    std::vector<uint8_t> scratch(CGX_PARAMETER_RPC_SCRATCH_SIZE);
+    rpc_output out(iov.data(), iov.size(), scratch.data(), scratch.size());
+
+    constexpr size_t n    = ops / batch;
+    const double     took = best([&] {
+        for (size_t i = 0; i < n; ++i) {
+            out.clear();
+            keep(handler.handle(frame, out));
+        }
+    });
+    report("rpc.get." + std::to_string(batch), took / n, "ns/frame");
+}
+
+// bench_rpc_socket is a load generator for rpc_server on a Unix-domain
+// socket, served from its own thread. A client sends single-entry GET
+// frames, `depth` at a time before reading the responses, and the time to
+// answer each burst is recorded for the percentile.
+void bench_rpc_socket(size_t depth) {
+    constexpr size_t count  = 64;
+    constexpr size_t frames = 1 << 16;
+    using list_t            = cgx::unique_parameter_list<0, count>;
+
+    const names        name("param", count);
+    list_t             list(discard);
+    rpc_server<list_t> server(list);
+    fill(list, name, count);
+    if (!server.listen_unix(CGX_BENCH_SOCKET_PATH)) {
+        std::fprintf(
+            stderr, "rpc: cannot listen on %s\n", CGX_BENCH_SOCKET_PATH
+        );
+        return;
+    }
+    std::atomic<bool> done{false};
+    std::thread       serve([&]() {
+        while (!done.load(std::memory_order_relaxed)) {
+            server.poll(1);
+        }
+    });
+
+    rpc_client           client;
+    std::vector<uint8_t> burst;
+    uint8_t              frame[sizeof(rpc_header_t) + sizeof(uid_value_t)];
+    uint8_t              response[256];
+    for (size_t i = 0; i < depth; ++i) {
+        rpc_request request(frame, sizeof(frame));
+        request.begin(rpc_get, static_cast<uint32_t>(i));
+        request.add(cgx::parameter::uid_t::hash(name[i % count]));
+        burst.insert(burst.end(), frame, frame + request.finish());
+    }
+
+    std::vector<double> latency;
+    latency.reserve(frames / depth);
+    bool       ok    = client.connect_unix(CGX_BENCH_SOCKET_PATH);
+    const auto start = clock_type::now();
+    for (size_t sent = 0; ok && sent < frames; sent += depth) {
+        const auto begin = clock_type::now();
+        ok               = client.send(burst.data(), burst.size());
+        for (size_t i = 0; ok && i < depth; ++i) {
+            ok = client.receive(response, sizeof(response)) > 0;
+        }
+        const std::chrono::duration<double, std::micro> took =
+            clock_type::now() - begin;
+        latency.push_back(took.count());
+    }
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    client.close();
+    done.store(true, std::memory_order_relaxed);
+    serve.join();
+    if (!ok) {
+        std::fprintf(stderr, "rpc: socket load generator failed\n");
+        return;
+    }
+
+    std::sort(latency.begin(), latency.end());
+    const std::string prefix = "rpc.socket.depth_" + std::to_string(depth);
+    report(prefix + ".throughput", frames / elapsed.count(), "req/s");
+    report(prefix + ".p99", latency[latency.size() * 99 / 100], "us");
+}
+
+bool write_results(std::FILE* file) {
+    auto write = [file](const uint8_t* data, size_t size) {
+        return std::fwrite(data, 1, size, file) == size;
+    };
+    uint8_t     buffer[1024];
+    byte_output out(buffer, sizeof(buffer), write);
+    json_writer json(out, true);
+
+    json.begin_object(2);
+    json.key("context");
+    json.begin_object(2);
+    json.key("compiler");
+    json.write_string(__VERSION__);
+#ifdef NDEBUG
+    const bool assertions = false;
+#else
+    const bool assertions = true;
+#endif
+    json.key("assertions");
+    json.write_bool(assertions);
+    json.end_object();
+
+    json.key("benchmarks");
+    json.begin_array(g_results.size());
+    for (const auto& r : g_results) {
+        json.begin_object(3);
+        json.key("name");
+        json.write_string(r.name);
+        json.key("value");
+        json.write_double(r.value);
+        json.key("unit");
+        json.write_string(r.unit);
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+
+    return out.put('\n') && out.flush();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    bench_access<int>("int", 1, 2);
+    bench_access<float>("float", 1.0f, 2.0f);
+    bench_access<std::array<float, 16>>(
+        "array_float_16", std::array<float, 16>{}, std::array<float, 16>{1}
+    );
+
+    bench_concurrent();
+
+    bench_crc_backends();
+    bench_crc<4>();
+    bench_crc<64>();
+    bench_crc<1024>();
+    bench_crc<16384>();
+
+    bench_dispatch();
+
+    bench_lookup<16>();
+    bench_lookup<256>();
+    bench_lookup<4096>();
+
+    bench_init();
+    bench_journal();
+    bench_print();
+    bench_memory();
+    bench_codec();
+    bench_sync();
+    bench_rpc();
+    bench_rpc_socket(1);
+    bench_rpc_socket(16);
+
+    std::FILE* file = argc > 1 ? std::fopen(argv[1], "w") : stdout;
+    if (file == nullptr) {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+    const bool ok = write_results(file);
+    if (file != stdout) {
+        std::fclose(file);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+// CBOR (RFC 8949) for value_writer and value_reader: the compact binary
+// counterpart of json.hpp. The writer uses the shortest encoding for
+// integers and lengths and keeps floats at their own width; the reader
+// parses a contiguous buffer without allocating.
+//
+// Only definite-length containers and strings are supported. The reader
+// ignores tags and accepts half-precision floats.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "codec.hpp"
+
+namespace cgx::parameter {
+
+enum cbor_major_t : uint8_t {
+    cbor_unsigned = 0,
+    cbor_negative = 1,
+    cbor_bytes    = 2,
+    cbor_text     = 3,
+    cbor_array    = 4,
+    cbor_map      = 5,
+    cbor_tag      = 6,
+    cbor_simple   = 7,
+};
+
+inline double _half_to_double(uint16_t half) {
+    const int exponent = half >> 10 & 0x1F;
+    const int mantissa = half & 0x3FF;
+    double    value;
+    if (exponent == 0) {
+        value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else if (mantissa == 0) {
+        value = std::numeric_limits<double>::infinity();
+    } else {
+        value = std::numeric_limits<double>::quiet_NaN();
+    }
+    return half & 0x8000 ? -value : value;
+}
+
+class cbor_writer final : public value_writer {
+   public:
+    explicit cbor_writer(byte_output& out) : m_out(out) {
+    }
+
+    bool begin_object(size_t size) override {
+        return this->head(cbor_map, size);
+    }
+
+    bool key(std::string_view name) override {
+        return this->write_string(name);
+    }
+
+    bool end_object() override {
+        return m_out.ok();
+    }
+
+    bool begin_array(size_t size) override {
+        return this->head(cbor_array, size);
+    }
+
+    bool end_array() override {
+        return m_out.ok();
+    }
+
+    bool write_int(int64_t value) override {
+        if (value < 0) {
+            return this->head(cbor_negative, static_cast<uint64_t>(-1 - value));
+        }
+        return this->head(cbor_unsigned, static_cast<uint64_t>(value));
+    }
+
+    bool write_uint(uint64_t value) override {
+        return this->head(cbor_unsigned, value);
+    }
+
+    bool write_float(float value) override {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return this->put(cbor_simple << 5 | 26, bits, sizeof(bits));
+    }
+
+    bool write_double(double value) override {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return this->put(cbor_simple << 5 | 27, bits, sizeof(bits));
+    }
+
+    bool write_bool(bool value) override {
+        const unsigned info = value ? 21 : 20;
+        return m_out.put(static_cast<uint8_t>(cbor_simple << 5 | info));
+    }
+
+    bool write_string(std::string_view value) override {
+        return this->head(cbor_text, value.size()) &&
+               m_out.put(value.data(), value.size());
+    }
+
+    bool write_bytes(const uint8_t* data, size_t size) override {
+        return this->head(cbor_bytes, size) && m_out.put(data, size);
+    }
+
+   private:
+    byte_output& m_out;
+
+    // put writes an initial byte followed by size bytes of value in
+    // network order.
+    bool put(unsigned initial, uint64_t value, size_t size) {
+        uint8_t bytes[9];
+        bytes[0] = static_cast<uint8_t>(initial);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[1 + i] = static_cast<uint8_t>(value >> (8 * (size - 1 - i)));
+        }
+        return m_out.put(bytes, 1 + size);
+    }
+
+    bool head(cbor_major_t major, uint64_t value) {
+        const unsigned type = major << 5;
+        if (value < 24) {
+            return m_out.put(static_cast<uint8_t>(type | value));
+        }
+        if (value <= 0xFF) {
+            return this->put(type | 24, value, 1);
+        }
+        if (value <= 0xFFFF) {
+            return this->put(type | 25, value, 2);
+        }
+        if (value <= 0xFFFFFFFF) {
+            return this->put(type | 26, value, 4);
+        }
+        return this->put(type | 27, value, 8);
+    }
+};
+
+class cbor_reader final : public value_reader {
+   public:
+    cbor_reader(const uint8_t* data, size_t size)
+        : m_pos(data), m_end(data + size) {
+    }
+
+    bool read_int(int64_t& value) override {
+        uint8_t  major, info;
+        uint64_t argument;
+        if (!this->value_head(major, info, argument) ||
+            (major != cbor_unsigned && major != cbor_negative) ||
+            argument > static_cast<uint64_t>(INT64_MAX)) {
+            return this->fail();
+        }
+        const auto v = static_cast<int64_t>(argument);
+        value        = major == cbor_unsigned ? v : -1 - v;
+        return true;
+    }
+
+    bool read_uint(uint64_t& value) override {
+        uint8_t major, info;
+        if (!this->value_head(major, info, value) || major != cbor_unsigned) {
+            return this->fail();
+        }
+        return true;
+    }
+
+    bool read_double(double& value) override {
+        uint8_t  major, info;
+        uint64_t argument;
+        if (!this->value_head(major, info, argument)) {
+            return false;
+        }
+        if (major == cbor_unsigned) {
+            value = static_cast<double>(argument);
+        } else if (major == cbor_negative) {
+            value = -1.0 - static_cast<double>(argument);
+        } else if (major != cbor_simple) {
+            return this->fail();
+        } else if (info == 25) {
+            value = _half_to_double(static_cast<uint16_t>(argument));
+        } else if (info == 26) {
+            float    f;
+            uint32_t bits = static_cast<uint32_t>(argument);
+            std::memcpy(&f, &bits, sizeof(f));
+            value = f;
+        } else if (info == 27) {
+            std::memcpy(&value, &argument, sizeof(value));
+        } else {
+            return this->fail();
+        }
+        return true;
+    }
+
+    bool read_bool(bool& value) override {
+        uint8_t  major, info;
+        uint64_t argument;
+        if (!this->value_head(major, info, argument) ||
+            major != cbor_simple || (info != 20 && info != 21)) {
+            return this->fail();
+        }
+        value = info == 21;
+        return true;
+    }
+
+    bool read_string(char* dst, size_t capacity, size_t& size) override {
+        return this->text(dst, capacity, size) && size < capacity;
+    }
+
+    bool read_bytes(uint8_t* dst, size_t size) override {
+        uint8_t  major, info;
+        uint64_t argument;
+        if (!this->value_head(major, info, argument) || major != cbor_bytes ||
+            argument != size || this->remaining() < size) {
+            return this->fail();
+        }
+        std::memcpy(dst, m_pos, size);
+        m_pos += size;
+        return true;
+    }
+
+    bool begin_object() override {
+        return this->open(cbor_map);
+    }
+
+    bool next_key(char* dst, size_t capacity, size_t& size) override {
+        return this->next() && this->text(dst, capacity, size);
+    }
+
+    bool begin_array() override {
+        return this->open(cbor_array);
+    }
+
+    bool next_element() override {
+        return this->next();
+    }
+
+    bool skip() override {
+        uint64_t pending = 1;
+        while (pending > 0) {
+            pending -= 1;
+            uint8_t  major, info;
+            uint64_t argument;
+            if (!this->head(major, info, argument)) {
+                return false;
+            }
+            // Every entry takes at least one byte, which bounds pending.
+            switch (major) {
+                case cbor_bytes:
+                case cbor_text:
+                    if (this->remaining() < argument) {
+                        return this->fail();
+                    }
+                    m_pos += argument;
+                    break;
+                case cbor_array:
+                case cbor_map:
+                    if (this->remaining() < argument) {
+                        return this->fail();
+                    }
+                    pending += major == cbor_map ? 2 * argument : argument;
+                    break;
+                case cbor_tag: pending += 1; break;
+                default: break;
+            }
+        }
+        return true;
+    }
+
+    // finish checks that the last value ends the buffer.
+    bool finish() const {
+        return m_ok && m_pos == m_end;
+    }
+
+   private:
+    const uint8_t* m_pos;
+    const uint8_t* m_end;
+    uint64_t       m_left[CGX_PARAMETER_CODEC_DEPTH];
+    size_t         m_depth{0};
+
+    size_t remaining() const {
+        return static_cast<size_t>(m_end - m_pos);
+    }
+
+    // head reads an initial byte and its argument: the value, length or
+    // float bits that follow it.
+    bool head(uint8_t& major, uint8_t& info, uint64_t& argument) {
+        if (m_pos == m_end) {
+            return this->fail();
+        }
+        major = *m_pos >> 5;
+        info  = *m_pos & 0x1F;
+        m_pos += 1;
+        if (info < 24) {
+            argument = info;
+            return true;
+        }
+        // 28 to 30 are reserved and 31 marks indefinite lengths.
+        const size_t size = info <= 27 ? size_t{1} << (info - 24) : 0;
+        if (size == 0 || this->remaining() < size) {
+            return this->fail();
+        }
+        argument = 0;
+        for (size_t i = 0; i < size; ++i) {
+            argument = argument << 8 | *m_pos++;
+        }
+        return true;
+    }
+
+    // value_head is head() past any tags.
+    bool value_head(uint8_t& major, uint8_t& info, uint64_t& argument) {
+        do {
+            if (!this->head(major, info, argument)) {
+                return false;
+            }
+        } while (major == cbor_tag);
+        return true;
+    }
+
+    bool text(char* dst, size_t capacity, size_t& size) {
+        uint8_t  major, info;
+        uint64_t argument;
+        if (!this->value_head(major, info, argument) || major != cbor_text ||
+            this->remaining() < argument) {
+            return this->fail();
+        }
+        size = static_cast<size_t>(argument);
+        if (capacity > 0) {
+            const size_t n = std::min(size, capacity - 1);
+            std::memcpy(dst, m_pos, n);
+            dst[n] = '\0';
+        }
+        m_pos += size;
+        return true;
+    }
+
+    bool open(cbor_major_t type) {
+        uint8_t  major, info;
+        uint64_t argument;
+        if (!this->value_head(major, info, argument) || major != type ||
+            m_depth == CGX_PARAMETER_CODEC_DEPTH ||
+            this->remaining() < argument) {
+            return this->fail();
+        }
+        m_left[m_depth++] = argument;
+        return true;
+    }
+
+    // next counts down the entries of the innermost container and leaves
+    // it after the last one.
+    bool next() {
+        if (m_depth == 0) {
+            return this->fail();
+        }
+        if (m_left[m_depth - 1] == 0) {
+            m_depth -= 1;
+            return false;
+        }
+        m_left[m_depth - 1] -= 1;
+        return true;
+    }
+};
+
+}  // namespace cgx::parameter
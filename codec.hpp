@@ -0,0 +1,312 @@
+#pragma once
+
+// Structured, format-neutral encoding of parameter values. value_writer and
+// value_reader are implemented by json.hpp and cbor.hpp, and codec<T> maps a
+// value type onto them. User types specialize codec:
+//
+//   template <>
+//   struct cgx::parameter::codec<custom_type> {
+//       static bool encode(value_writer& out, const custom_type& value) {
+//           return out.begin_array(2) && out.write_int(value.a) &&
+//                  out.write_int(value.b) && out.end_array();
+//       }
+//       static bool decode(value_reader& in, custom_type& value) { ... }
+//   };
+//
+// Types without a specialization are written as their raw bytes.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+#include "delegate.hpp"
+
+// Longest parameter name import_values() can match.
+#ifndef CGX_PARAMETER_NAME_SIZE
+#define CGX_PARAMETER_NAME_SIZE 64
+#endif
+
+// Deepest nesting the readers can step through.
+#ifndef CGX_PARAMETER_CODEC_DEPTH
+#define CGX_PARAMETER_CODEC_DEPTH 32
+#endif
+
+namespace cgx::parameter {
+
+// byte_output collects encoded bytes in a caller-provided buffer. With a
+// flush callback every full buffer is handed to it, so the output can be of
+// any length; without one the buffer must hold the whole output.
+class byte_output {
+   public:
+    using flush_t = delegate<bool(const uint8_t* data, size_t size)>;
+
+    byte_output(uint8_t* buffer, size_t capacity, flush_t flush = nullptr)
+        : m_buffer(buffer), m_capacity(capacity), m_flush(flush) {
+    }
+
+    bool put(uint8_t byte) {
+        if (m_used == m_capacity && !this->drain()) {
+            return false;
+        }
+        m_buffer[m_used++] = byte;
+        return true;
+    }
+
+    bool put(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            if (m_used == m_capacity && !this->drain()) {
+                return false;
+            }
+            const size_t n = std::min(size, m_capacity - m_used);
+            std::memcpy(m_buffer + m_used, bytes, n);
+            m_used += n;
+            bytes += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // flush hands the buffered bytes to the callback. Without a callback
+    // the bytes stay in the buffer.
+    bool flush() {
+        if (!m_flush || m_used == 0) {
+            return m_ok;
+        }
+        return this->drain();
+    }
+
+    const uint8_t* data() const {
+        return m_buffer;
+    }
+
+    // size is the number of bytes written so far, flushed or not.
+    size_t size() const {
+        return m_flushed + m_used;
+    }
+
+    bool ok() const {
+        return m_ok;
+    }
+
+   private:
+    uint8_t* m_buffer;
+    size_t   m_capacity;
+    flush_t  m_flush;
+    size_t   m_used{0};
+    size_t   m_flushed{0};
+    bool     m_ok{true};
+
+    bool drain() {
+        if (!m_ok || !m_flush || !m_flush(m_buffer, m_used)) {
+            m_ok = false;
+            return false;
+        }
+        m_flushed += m_used;
+        m_used = 0;
+        return true;
+    }
+};
+
+class value_writer {
+   public:
+    virtual ~value_writer() = default;
+
+    // Containers are written with their number of entries, which CBOR
+    // needs up front.
+    virtual bool begin_object(size_t size)  = 0;
+    virtual bool key(std::string_view name) = 0;
+    virtual bool end_object()               = 0;
+    virtual bool begin_array(size_t size)   = 0;
+    virtual bool end_array()                = 0;
+
+    virtual bool write_int(int64_t value)                      = 0;
+    virtual bool write_uint(uint64_t value)                    = 0;
+    virtual bool write_float(float value)                      = 0;
+    virtual bool write_double(double value)                    = 0;
+    virtual bool write_bool(bool value)                        = 0;
+    virtual bool write_string(std::string_view value)          = 0;
+    virtual bool write_bytes(const uint8_t* data, size_t size) = 0;
+};
+
+// value_reader is a pull parser: the caller asks for the value it expects
+// and the reader copies it straight into the destination. Containers are
+// walked with next_key() and next_element(), which return false at the end
+// of the container or on an error; ok() tells the two apart.
+class value_reader {
+   public:
+    virtual ~value_reader() = default;
+
+    virtual bool read_int(int64_t& value)   = 0;
+    virtual bool read_uint(uint64_t& value) = 0;
+    virtual bool read_double(double& value) = 0;
+    virtual bool read_bool(bool& value)     = 0;
+
+    // read_string copies a string and its terminator into dst. size is set
+    // to the string length, which may exceed capacity, in which case the
+    // call fails.
+    virtual bool read_string(char* dst, size_t capacity, size_t& size) = 0;
+
+    // read_bytes reads exactly size bytes of binary data.
+    virtual bool read_bytes(uint8_t* dst, size_t size) = 0;
+
+    virtual bool begin_object() = 0;
+    // next_key reads the next key like read_string(). A key longer than
+    // capacity is reported with its full size and must be skipped.
+    virtual bool next_key(char* dst, size_t capacity, size_t& size) = 0;
+    virtual bool begin_array()                                      = 0;
+    virtual bool next_element()                                     = 0;
+
+    // skip steps over one value, containers included.
+    virtual bool skip() = 0;
+
+    bool ok() const {
+        return m_ok;
+    }
+
+   protected:
+    bool m_ok{true};
+
+    bool fail() {
+        m_ok = false;
+        return false;
+    }
+};
+
+// Types that are not trivially copyable have no byte image to fall back on;
+// they fail to encode and decode until codec is specialized for them.
+template <typename T, typename Enable = void>
+struct codec {
+    static bool encode(value_writer& out, const T& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            return out.write_bytes(
+                reinterpret_cast<const uint8_t*>(&value), sizeof(T)
+            );
+        } else {
+            (void)out;
+            (void)value;
+            return false;
+        }
+    }
+
+    static bool decode(value_reader& in, T& value) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            return in.read_bytes(
+                reinterpret_cast<uint8_t*>(&value), sizeof(T)
+            );
+        } else {
+            (void)in;
+            (void)value;
+            return false;
+        }
+    }
+};
+
+template <>
+struct codec<bool> {
+    static bool encode(value_writer& out, bool value) {
+        return out.write_bool(value);
+    }
+
+    static bool decode(value_reader& in, bool& value) {
+        return in.read_bool(value);
+    }
+};
+
+template <typename T>
+struct codec<
+    T,
+    std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+    static bool encode(value_writer& out, T value) {
+        if constexpr (std::is_signed_v<T>) {
+            return out.write_int(value);
+        } else {
+            return out.write_uint(value);
+        }
+    }
+
+    static bool decode(value_reader& in, T& value) {
+        if constexpr (std::is_signed_v<T>) {
+            int64_t v;
+            if (!in.read_int(v) || v < std::numeric_limits<T>::min() ||
+                v > std::numeric_limits<T>::max()) {
+                return false;
+            }
+            value = static_cast<T>(v);
+        } else {
+            uint64_t v;
+            if (!in.read_uint(v) || v > std::numeric_limits<T>::max()) {
+                return false;
+            }
+            value = static_cast<T>(v);
+        }
+        return true;
+    }
+};
+
+template <typename T>
+struct codec<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    static bool encode(value_writer& out, T value) {
+        if constexpr (std::is_same_v<T, float>) {
+            return out.write_float(value);
+        } else {
+            return out.write_double(static_cast<double>(value));
+        }
+    }
+
+    static bool decode(value_reader& in, T& value) {
+        double v;
+        if (!in.read_double(v)) {
+            return false;
+        }
+        value = static_cast<T>(v);
+        return true;
+    }
+};
+
+template <size_t N>
+struct codec<char[N]> {
+    static bool encode(value_writer& out, const char (&value)[N]) {
+        return out.write_string(std::string_view(value, strnlen(value, N)));
+    }
+
+    static bool decode(value_reader& in, char (&value)[N]) {
+        size_t size;
+        return in.read_string(value, N, size);
+    }
+};
+
+template <typename T, size_t N>
+struct codec<std::array<T, N>> {
+    static bool encode(value_writer& out, const std::array<T, N>& value) {
+        if (!out.begin_array(N)) {
+            return false;
+        }
+        for (const auto& element : value) {
+            if (!codec<T>::encode(out, element)) {
+                return false;
+            }
+        }
+        return out.end_array();
+    }
+
+    // decode requires exactly N elements.
+    static bool decode(value_reader& in, std::array<T, N>& value) {
+        if (!in.begin_array()) {
+            return false;
+        }
+        for (auto& element : value) {
+            if (!in.next_element() || !codec<T>::decode(in, element)) {
+                return false;
+            }
+        }
+        return !in.next_element() && in.ok();
+    }
+};
+
+}  // namespace cgx::parameter
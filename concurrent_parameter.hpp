@@ -0,0 +1,187 @@
+#pragma once
+
+// Thread-safe parameters: parameter<concurrent<T>> lets real-time threads
+// read consistent snapshots while another thread writes. Readers never take
+// a lock and writers never wait for readers. Writers take a spin lock among
+// themselves, which also covers their dirty marks and callbacks.
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "parameter.hpp"
+
+namespace cgx {
+
+// concurrent<T> tags a parameter type for the lock-free specialization,
+// e.g. params.add("gain", cgx::concurrent<float>{1.0f}).
+template <typename T>
+struct concurrent {
+    T value;
+
+    bool operator==(const concurrent& other) const {
+        return value == other.value;
+    }
+};
+
+namespace parameter {
+
+// The value is double-buffered with a sequence counter per buffer. Writers
+// fill the buffer readers are not pointed at and then publish it, so a read
+// only retries when two writes complete while it is copying.
+template <typename T>
+class parameter<concurrent<T>> : virtual public parameter_i {
+    static_assert(
+        std::is_trivially_copyable_v<T>,
+        "concurrent parameters must be trivially copyable"
+    );
+
+   public:
+    parameter() = default;
+    parameter(
+        delegate<void(const char*)> print,
+        const concurrent<T>&        default_value
+    )
+        : m_default(default_value.value), m_print(print) {
+        m_buffers[0].value = m_default;
+        m_buffers[1].value = m_default;
+    }
+    virtual ~parameter() = default;
+
+    // Budget figures for unique_parameter::stack_usage(). The value is only
+    // reached through snapshots, which value(), get_bytes(), set_bytes() and
+    // get_crc() take on the stack.
+    static constexpr bool   in_place    = false;
+    static constexpr size_t value_stack = sizeof(T);
+
+    bool set_bytes(const uint8_t* src, size_t size) override {
+        if (size != sizeof(T)) {
+            return false;
+        }
+        T value;
+        std::memcpy(&value, src, sizeof(T));
+        this->set_value(value);
+        return true;
+    }
+
+    bool get_bytes(uint8_t* dst, size_t size) const override {
+        if (size != sizeof(T)) {
+            return false;
+        }
+        T value = this->value();
+        std::memcpy(dst, &value, sizeof(T));
+        return true;
+    }
+
+    int to_char(char* dst, size_t size) const override {
+        return _value_to_char(dst, size, this->value(), m_default);
+    }
+
+    // get_crc hashes a fresh snapshot; the shared CRC cache is not used
+    // because it would be written from reader threads.
+    uint32_t get_crc() const override {
+        T value = this->value();
+        return _calc_crc(
+            _init_crc32(), reinterpret_cast<const uint8_t*>(&value), sizeof(T)
+        );
+    }
+
+    void print() const override {
+        this->print_with(m_print);
+    }
+
+    void print(text_sink& out) const override {
+        this->print_line(out);
+        const T value = this->value();
+        _print_hex(
+            out, "   + ", reinterpret_cast<const uint8_t*>(&value), sizeof(T)
+        );
+    }
+
+    operator T() const {
+        return this->value();
+    }
+
+    parameter<concurrent<T>>& operator=(const T& value) {
+        set_value(value);
+        return *this;
+    }
+
+    parameter<concurrent<T>>& operator=(const concurrent<T>& value) {
+        set_value(value.value);
+        return *this;
+    }
+
+    // value returns a consistent snapshot. It is safe to call from any
+    // number of threads concurrently with set_value().
+    T value() const {
+        T value;
+        while (true) {
+            const uint32_t current = m_current.load(std::memory_order_acquire);
+            const auto&    buffer  = m_buffers[current];
+            const uint32_t before =
+                buffer.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            // The copy may race with a lapping writer; the sequence check
+            // below discards it in that case.
+            std::memcpy(&value, &buffer.value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer.sequence.load(std::memory_order_relaxed) == before) {
+                return value;
+            }
+        }
+    }
+
+    // set_value publishes a new value. Concurrent writers are serialized
+    // with a spin lock; readers are never blocked. on_dirty and on_changed
+    // run under the lock, so they see the writes in order and never run
+    // concurrently, and must not write this parameter again.
+    bool set_value(const T& value) {
+        while (m_writer.test_and_set(std::memory_order_acquire)) {
+        }
+        const uint32_t current = m_current.load(std::memory_order_relaxed);
+        if (std::memcmp(&m_buffers[current].value, &value, sizeof(T)) == 0) {
+            m_writer.clear(std::memory_order_release);
+            return true;
+        }
+
+        auto&          next     = m_buffers[current ^ 1];
+        const uint32_t sequence = next.sequence.load(std::memory_order_relaxed);
+        next.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&next.value, &value, sizeof(T));
+        next.sequence.store(sequence + 2, std::memory_order_release);
+        m_current.store(current ^ 1, std::memory_order_release);
+
+        this->mark_dirty();
+        this->notify_changed();
+        m_writer.clear(std::memory_order_release);
+        return true;
+    }
+
+    void reset() override {
+        set_value(m_default);
+    }
+
+    void set_print(delegate<void(const char*)> print) {
+        m_print = print;
+    }
+
+   protected:
+    struct buffer_t {
+        std::atomic<uint32_t> sequence{0};
+        T                     value{};
+    };
+
+    T                           m_default{};
+    buffer_t                    m_buffers[2];
+    std::atomic<uint32_t>       m_current{0};
+    std::atomic_flag            m_writer = ATOMIC_FLAG_INIT;
+    delegate<void(const char*)> m_print{nullptr};
+};
+
+}  // namespace parameter
+
+}  // namespace cgx
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__) || defined(__clang__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define CGX_CRC32_HAS_PCLMUL 1
+#endif
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CGX_CRC32_HAS_ARMV8 1
+#endif
+
+#ifndef CGX_CRC32_HAS_PCLMUL
+#define CGX_CRC32_HAS_PCLMUL 0
+#endif
+
+#ifndef CGX_CRC32_HAS_ARMV8
+#define CGX_CRC32_HAS_ARMV8 0
+#endif
+
+// Number of bytes processed per step by the table-driven runtime backend.
+// Valid values are 1, 4, 8 and 16. Slicing by S needs S KiB of tables, so
+// smaller targets may want to lower this.
+#ifndef CGX_CRC32_SLICE
+#define CGX_CRC32_SLICE 8
+#endif
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define CGX_CRC32_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+
+#ifndef CGX_CRC32_CONSTANT_EVALUATED
+#define CGX_CRC32_CONSTANT_EVALUATED() true
+#endif
+
+namespace cgx {
+
+constexpr uint32_t _crc32_single_byte(uint32_t byte) {
+    uint32_t crc = byte;
+    for (int i = 0; i < 8; ++i) {
+        crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return crc;
+}
+
+constexpr std::array<uint32_t, 256> _generate_crc32_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        table[i] = _crc32_single_byte(i);
+    }
+    return table;
+}
+
+constexpr uint32_t _init_crc32() {
+    return 0xFFFFFFFF;
+}
+
+constexpr std::array<uint32_t, 256> _crc32_table = _generate_crc32_table();
+
+// _crc32_slice_table<S> holds S tables where table[k][b] is the CRC of byte b
+// followed by k zero bytes. This lets S input bytes be folded in one step.
+template <size_t S>
+constexpr std::array<std::array<uint32_t, 256>, S> _generate_crc32_slices() {
+    std::array<std::array<uint32_t, 256>, S> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        tables[0][i] = _crc32_table[i];
+    }
+    for (size_t k = 1; k < S; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t prev = tables[k - 1][i];
+            tables[k][i]  = (prev >> 8) ^ _crc32_table[prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+template <size_t S>
+struct _crc32_slice_table {
+    static inline constexpr auto value = _generate_crc32_slices<S>();
+};
+
+namespace crc32 {
+
+// All update functions operate on the raw CRC register: start from
+// _init_crc32() and XOR the result with 0xFFFFFFFF to finalize.
+
+constexpr uint32_t update_bytewise(
+    uint32_t       crc,
+    const uint8_t* data,
+    size_t         size
+) {
+    for (size_t i = 0; i < size; ++i) {
+        crc = (crc >> 8) ^ _crc32_table[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+template <size_t S>
+inline uint32_t update_slice(uint32_t crc, const uint8_t* data, size_t size) {
+    static_assert(S == 4 || S == 8 || S == 16, "unsupported slice size");
+    const auto& table = _crc32_slice_table<S>::value;
+
+    while (size >= S) {
+        uint32_t next = 0;
+        for (size_t k = 0; k < S; ++k) {
+            uint32_t byte = data[k];
+            if (k < 4) {
+                byte ^= (crc >> (8 * k)) & 0xFF;
+            }
+            next ^= table[S - 1 - k][byte];
+        }
+        crc = next;
+        data += S;
+        size -= S;
+    }
+
+    return update_bytewise(crc, data, size);
+}
+
+#if CGX_CRC32_HAS_PCLMUL
+
+#define CGX_CRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+
+CGX_CRC32_PCLMUL_TARGET inline __m128i _pclmul_load(const uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+CGX_CRC32_PCLMUL_TARGET inline __m128i
+_pclmul_fold(__m128i x, __m128i k, __m128i next) {
+    __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+// Carry-less multiplication folding as described in Intel's "Fast CRC
+// Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+// Constants are for the bit-reflected CRC-32 (0xEDB88320) polynomial.
+CGX_CRC32_PCLMUL_TARGET inline uint32_t update_pclmul(
+    uint32_t       crc,
+    const uint8_t* data,
+    size_t         size
+) {
+    if (size < 64) {
+        return update_slice<8>(crc, data, size);
+    }
+
+    const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163CD6124);
+    const __m128i poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    const size_t tail = size & 15;
+    size -= tail;
+
+    __m128i x1 = _mm_xor_si128(_pclmul_load(data), _mm_cvtsi32_si128(crc));
+    __m128i x2 = _pclmul_load(data + 16);
+    __m128i x3 = _pclmul_load(data + 32);
+    __m128i x4 = _pclmul_load(data + 48);
+    data += 64;
+    size -= 64;
+
+    while (size >= 64) {
+        x1 = _pclmul_fold(x1, k1k2, _pclmul_load(data));
+        x2 = _pclmul_fold(x2, k1k2, _pclmul_load(data + 16));
+        x3 = _pclmul_fold(x3, k1k2, _pclmul_load(data + 32));
+        x4 = _pclmul_fold(x4, k1k2, _pclmul_load(data + 48));
+
+        data += 64;
+        size -= 64;
+    }
+
+    x1 = _pclmul_fold(x1, k3k4, x2);
+    x1 = _pclmul_fold(x1, k3k4, x3);
+    x1 = _pclmul_fold(x1, k3k4, x4);
+
+    while (size >= 16) {
+        x1 = _pclmul_fold(x1, k3k4, _pclmul_load(data));
+        data += 16;
+        size -= 16;
+    }
+
+    // Fold 128 bits down to 64 bits.
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction down to 32 bits.
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    crc = static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+
+    return update_slice<8>(crc, data, tail);
+}
+
+inline bool has_pclmul() {
+    static const bool supported = []() {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ecx & bit_PCLMUL) != 0 && (ecx & bit_SSE4_1) != 0;
+    }();
+    return supported;
+}
+
+#endif  // CGX_CRC32_HAS_PCLMUL
+
+#if CGX_CRC32_HAS_ARMV8
+
+inline uint32_t update_armv8(uint32_t crc, const uint8_t* data, size_t size) {
+    while (size >= sizeof(uint64_t)) {
+        uint64_t word;
+        __builtin_memcpy(&word, data, sizeof(word));
+        crc = __crc32d(crc, word);
+        data += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+    while (size > 0) {
+        crc = __crc32b(crc, *data++);
+        --size;
+    }
+    return crc;
+}
+
+#endif  // CGX_CRC32_HAS_ARMV8
+
+// update picks the fastest backend available on the running machine.
+inline uint32_t update(uint32_t crc, const uint8_t* data, size_t size) {
+#if CGX_CRC32_HAS_ARMV8
+    return update_armv8(crc, data, size);
+#else
+#if CGX_CRC32_HAS_PCLMUL
+    if (size >= 64 && has_pclmul()) {
+        return update_pclmul(crc, data, size);
+    }
+#endif
+#if CGX_CRC32_SLICE == 1
+    return update_bytewise(crc, data, size);
+#else
+    return update_slice<CGX_CRC32_SLICE>(crc, data, size);
+#endif
+#endif
+}
+
+}  // namespace crc32
+
+// _calc_crc keeps the byte-wise loop when evaluated at compile time and
+// dispatches to crc32::update() at runtime.
+constexpr uint32_t _calc_crc(const uint8_t* data, size_t size) {
+    if (CGX_CRC32_CONSTANT_EVALUATED()) {
+        return crc32::update_bytewise(_init_crc32(), data, size) ^ 0xFFFFFFFF;
+    }
+    return crc32::update(_init_crc32(), data, size) ^ 0xFFFFFFFF;
+}
+
+constexpr uint32_t _calc_crc(uint32_t crc, const uint8_t* data, size_t size) {
+    if (CGX_CRC32_CONSTANT_EVALUATED()) {
+        return crc32::update_bytewise(crc, data, size) ^ 0xFFFFFFFF;
+    }
+    return crc32::update(crc, data, size) ^ 0xFFFFFFFF;
+}
+
+// _calc_crc over text, usable in constant expressions where the bytes of a
+// string_view cannot be reinterpreted as uint8_t.
+constexpr uint32_t _calc_crc(std::string_view text) {
+    uint32_t crc = _init_crc32();
+    for (char c : text) {
+        crc = (crc >> 8) ^ _crc32_table[(crc ^ static_cast<uint8_t>(c)) & 0xFF];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+}  // namespace cgx
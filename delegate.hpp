@@ -0,0 +1,148 @@
+#pragma once
+
+// delegate<R(Args...)> is a non-allocating replacement for std::function.
+// Callables are stored in a fixed in-object buffer; ones that do not fit are
+// rejected at compile time instead of spilling to the heap.
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef CGX_DELEGATE_BUFFER_SIZE
+#define CGX_DELEGATE_BUFFER_SIZE (4 * sizeof(void*))
+#endif
+
+namespace cgx {
+
+template <typename Signature>
+class delegate;
+
+template <typename R, typename... Args>
+class delegate<R(Args...)> {
+   public:
+    delegate() = default;
+    delegate(std::nullptr_t) {
+    }
+
+    template <
+        typename F,
+        typename = std::enable_if_t<
+            !std::is_same_v<std::decay_t<F>, delegate> &&
+            std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+    delegate(F&& callable) {
+        using callable_t = std::decay_t<F>;
+        static_assert(
+            sizeof(callable_t) <= CGX_DELEGATE_BUFFER_SIZE,
+            "callable does not fit, raise CGX_DELEGATE_BUFFER_SIZE"
+        );
+        static_assert(
+            alignof(callable_t) <= alignof(std::max_align_t),
+            "callable is over-aligned"
+        );
+        if constexpr (std::is_pointer_v<std::remove_reference_t<F>>) {
+            if (callable == nullptr) {
+                return;
+            }
+        }
+        ::new (static_cast<void*>(m_storage))
+            callable_t(std::forward<F>(callable));
+        m_ops = _ops<callable_t>();
+    }
+
+    delegate(const delegate& other) : m_ops(other.m_ops) {
+        if (m_ops != nullptr) {
+            m_ops->copy(m_storage, other.m_storage);
+        }
+    }
+
+    delegate(delegate&& other) noexcept : m_ops(other.m_ops) {
+        if (m_ops != nullptr) {
+            m_ops->move(m_storage, other.m_storage);
+        }
+    }
+
+    ~delegate() {
+        this->reset();
+    }
+
+    delegate& operator=(const delegate& other) {
+        if (this != &other) {
+            this->reset();
+            if (other.m_ops != nullptr) {
+                other.m_ops->copy(m_storage, other.m_storage);
+            }
+            m_ops = other.m_ops;
+        }
+        return *this;
+    }
+
+    delegate& operator=(delegate&& other) noexcept {
+        if (this != &other) {
+            this->reset();
+            if (other.m_ops != nullptr) {
+                other.m_ops->move(m_storage, other.m_storage);
+            }
+            m_ops = other.m_ops;
+        }
+        return *this;
+    }
+
+    delegate& operator=(std::nullptr_t) {
+        this->reset();
+        return *this;
+    }
+
+    R operator()(Args... args) const {
+        return m_ops->invoke(m_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const {
+        return m_ops != nullptr;
+    }
+
+    friend bool operator==(const delegate& d, std::nullptr_t) {
+        return d.m_ops == nullptr;
+    }
+    friend bool operator!=(const delegate& d, std::nullptr_t) {
+        return d.m_ops != nullptr;
+    }
+
+    void reset() {
+        if (m_ops != nullptr) {
+            m_ops->destroy(m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+   private:
+    struct ops {
+        R (*invoke)(void*, Args&&...);
+        void (*copy)(void*, const void*);
+        void (*move)(void*, void*);
+        void (*destroy)(void*);
+    };
+
+    template <typename F>
+    static const ops* _ops() {
+        static constexpr ops table{
+            [](void* f, Args&&... args) -> R {
+                return (*static_cast<F*>(f))(std::forward<Args>(args)...);
+            },
+            [](void* dst, const void* src) {
+                ::new (dst) F(*static_cast<const F*>(src));
+            },
+            [](void* dst, void* src) {
+                ::new (dst) F(std::move(*static_cast<F*>(src)));
+            },
+            [](void* f) { static_cast<F*>(f)->~F(); },
+        };
+        return &table;
+    }
+
+    alignas(std::max_align_t) mutable unsigned char
+        m_storage[CGX_DELEGATE_BUFFER_SIZE];
+    const ops* m_ops{nullptr};
+};
+
+}  // namespace cgx
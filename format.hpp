@@ -0,0 +1,309 @@
+#pragma once
+
+// printf-free text formatting for print() and to_char(). text_writer fills a
+// fixed buffer with table-driven integer, float and hex conversions, and
+// text_sink batches whole lines into one caller-provided buffer so the
+// printer is called once per chunk instead of once per line.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "delegate.hpp"
+
+namespace cgx::parameter {
+
+struct _digit_tables {
+    char hex[256][2];
+    char decimal[100][2];
+};
+
+constexpr _digit_tables _make_digit_tables() {
+    constexpr char digits[] = "0123456789ABCDEF";
+    _digit_tables  tables{};
+    for (int i = 0; i < 256; ++i) {
+        tables.hex[i][0] = digits[i >> 4];
+        tables.hex[i][1] = digits[i & 0xF];
+    }
+    for (int i = 0; i < 100; ++i) {
+        tables.decimal[i][0] = static_cast<char>('0' + i / 10);
+        tables.decimal[i][1] = static_cast<char>('0' + i % 10);
+    }
+    return tables;
+}
+
+inline constexpr _digit_tables _digits = _make_digit_tables();
+
+// _round_scaled rounds fraction * scale to the nearest integer for a
+// fraction in [0, 1) and a power of ten scale up to 1e9. Ties go to the even
+// last digit of integer * scale + result, as printf() rounds. The product in
+// double may round across a digit, e.g. 5e-7 is just below the tie, so each
+// step is checked against the exact product with fma(), whose single
+// rounding keeps the sign of the difference.
+inline uint64_t
+_round_scaled(double fraction, uint64_t scale, uint64_t integer) {
+    const auto s      = static_cast<double>(scale);
+    double     digits = std::floor(fraction * s);
+    if (std::fma(fraction, s, -digits) < 0) {
+        digits -= 1;
+    } else if (std::fma(fraction, s, -(digits + 1)) >= 0) {
+        digits += 1;
+    }
+    const double above = std::fma(fraction, s, -(digits + 0.5));
+    const auto   n     = static_cast<uint64_t>(digits);
+    const bool   odd   = ((scale == 1 ? integer : n) & 1) != 0;
+    return above > 0 || (above == 0 && odd) ? n + 1 : n;
+}
+
+// text_writer appends to a fixed buffer and keeps counting once it is full,
+// like snprintf(), so size() is the length the text needed. The buffer is
+// NUL-terminated by terminate().
+class text_writer {
+   public:
+    text_writer(char* buffer, size_t capacity)
+        : m_buffer(buffer), m_capacity(capacity) {
+    }
+
+    text_writer& put(char c) {
+        if (m_size + 1 < m_capacity) {
+            m_buffer[m_size] = c;
+        }
+        m_size += 1;
+        return *this;
+    }
+
+    text_writer& put(std::string_view text) {
+        if (m_size + 1 < m_capacity) {
+            const size_t n = std::min(text.size(), m_capacity - 1 - m_size);
+            std::memcpy(m_buffer + m_size, text.data(), n);
+        }
+        m_size += text.size();
+        return *this;
+    }
+
+    text_writer& put(const char* text) {
+        return this->put(std::string_view(text));
+    }
+
+    // put_uint writes value right-aligned in width characters of fill.
+    text_writer& put_uint(uint64_t value, size_t width = 0, char fill = ' ') {
+        char  digits[20];
+        char* end   = digits + sizeof(digits);
+        char* first = end;
+        while (value >= 100) {
+            const auto pair = _digits.decimal[value % 100];
+            value /= 100;
+            *--first = pair[1];
+            *--first = pair[0];
+        }
+        if (value >= 10) {
+            *--first = _digits.decimal[value][1];
+            *--first = _digits.decimal[value][0];
+        } else {
+            *--first = static_cast<char>('0' + value);
+        }
+        for (size_t n = static_cast<size_t>(end - first); n < width; ++n) {
+            this->put(fill);
+        }
+        return this->put(std::string_view(first, end - first));
+    }
+
+    text_writer& put_int(int64_t value) {
+        if (value < 0) {
+            this->put('-');
+            return this->put_uint(0 - static_cast<uint64_t>(value));
+        }
+        return this->put_uint(static_cast<uint64_t>(value));
+    }
+
+    // put_float writes value with a fixed number of decimals like "%f",
+    // rounded as printf() rounds the exact binary value. Magnitudes beyond
+    // the 64-bit integer range use exponent notation, whose digits may
+    // differ from "%e" in the last place.
+    text_writer& put_float(double value, unsigned decimals = 6) {
+        if (std::isnan(value)) {
+            return this->put("nan");
+        }
+        if (std::signbit(value)) {
+            this->put('-');
+            value = -value;
+        }
+        if (std::isinf(value)) {
+            return this->put("inf");
+        }
+        if (decimals > 9) {
+            decimals = 9;
+        }
+
+        int exponent = 0;
+        if (value >= 1e19) {
+            exponent = static_cast<int>(std::floor(std::log10(value)));
+            value /= std::pow(10.0, exponent);
+        }
+
+        uint64_t scale = 1;
+        for (unsigned i = 0; i < decimals; ++i) {
+            scale *= 10;
+        }
+        uint64_t integer  = static_cast<uint64_t>(value);
+        uint64_t fraction = _round_scaled(
+            value - static_cast<double>(integer), scale, integer
+        );
+        if (fraction >= scale) {
+            integer += 1;
+            fraction -= scale;
+        }
+
+        this->put_uint(integer);
+        if (decimals > 0) {
+            this->put('.').put_uint(fraction, decimals, '0');
+        }
+        if (exponent != 0) {
+            this->put("e+").put_uint(static_cast<uint64_t>(exponent), 2, '0');
+        }
+        return *this;
+    }
+
+    text_writer& put_hex(uint8_t byte) {
+        return this->put(std::string_view(_digits.hex[byte], 2));
+    }
+
+    text_writer& put_bool(bool value) {
+        return this->put(value ? "true" : "false");
+    }
+
+    // append lets snprintf()-style functions, such as to_char(), write at
+    // the end: f(dst, room) returns the length it needed, or < 0 on error.
+    template <typename F>
+    text_writer& append(F&& f) {
+        const size_t at = std::min(m_size, m_capacity);
+        const int    n  = f(m_buffer + at, m_capacity - at);
+        if (n < 0) {
+            m_error = true;
+        } else {
+            m_size += static_cast<size_t>(n);
+        }
+        return *this;
+    }
+
+    // terminate NUL-terminates the buffer and returns the length needed,
+    // or -1 after an error, matching snprintf().
+    int terminate() {
+        if (m_capacity > 0) {
+            m_buffer[std::min(m_size, m_capacity - 1)] = '\0';
+        }
+        return m_error ? -1 : static_cast<int>(m_size);
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+    // fits tells whether the text and its terminator fit in the buffer.
+    bool fits() const {
+        return !m_error && m_size < m_capacity;
+    }
+
+   private:
+    char*  m_buffer;
+    size_t m_capacity;
+    size_t m_size{0};
+    bool   m_error{false};
+};
+
+// text_sink collects lines in a caller-provided buffer and passes as many
+// whole lines as fit, joined by '\n', to print in one call. A line longer
+// than the buffer is truncated.
+class text_sink {
+   public:
+    text_sink(char* buffer, size_t capacity, delegate<void(const char*)> print)
+        : m_buffer(buffer), m_capacity(capacity), m_print(print) {
+    }
+    text_sink(const text_sink&)            = delete;
+    text_sink& operator=(const text_sink&) = delete;
+    ~text_sink() {
+        this->flush();
+    }
+
+    // line calls fill(text_writer&) to format one line. fill may be called
+    // a second time after a flush, so it must not have side effects.
+    template <
+        typename F,
+        typename = std::enable_if_t<std::is_invocable_v<F&, text_writer&>>>
+    void line(F&& fill) {
+        if (m_capacity < 2) {
+            return;
+        }
+        const size_t separator = m_used > 0 ? 1 : 0;
+        const size_t at        = m_used + separator;
+        if (at + 1 < m_capacity) {
+            text_writer out(m_buffer + at, m_capacity - at);
+            fill(out);
+            if (out.fits()) {
+                if (separator) {
+                    m_buffer[m_used] = '\n';
+                }
+                m_used = at + out.size();
+                return;
+            }
+        }
+
+        this->flush();
+        text_writer out(m_buffer, m_capacity);
+        fill(out);
+        m_used = std::min(out.size(), m_capacity - 1);
+    }
+
+    void line(std::string_view text) {
+        this->line([text](text_writer& out) {
+            out.put(text);
+        });
+    }
+
+    void flush() {
+        if (m_used == 0) {
+            return;
+        }
+        m_buffer[m_used] = '\0';
+        m_used           = 0;
+        if (m_print) {
+            m_print(m_buffer);
+        }
+    }
+
+   private:
+    char*                       m_buffer;
+    size_t                      m_capacity;
+    size_t                      m_used{0};
+    delegate<void(const char*)> m_print;
+};
+
+// _print_hex dumps bytes in lines of eight, each starting with prefix,
+// e.g. "   +  2A 00 00 00".
+inline void _print_hex(
+    text_sink&       out,
+    std::string_view prefix,
+    const uint8_t*   bytes,
+    size_t           size
+) {
+    constexpr size_t group_size = 8;
+    for (size_t i = 0; i < size; i += group_size) {
+        const size_t n = std::min(group_size, size - i);
+        out.line([&](text_writer& line) {
+            line.put(prefix);
+            for (size_t j = 0; j < n; ++j) {
+                line.put(' ').put_hex(bytes[i + j]);
+            }
+        });
+    }
+}
+
+}  // namespace cgx::parameter
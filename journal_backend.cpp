@@ -0,0 +1,39 @@
+// Link this file instead of providing cgx::parameter::set_bytes() and
+// get_bytes() to keep every LUN in an append-only journal.
+
+#include "journal_storage.hpp"
+
+#ifndef CGX_PARAMETER_JOURNAL_PATH
+#define CGX_PARAMETER_JOURNAL_PATH "./stored/lun%zu.log"
+#endif
+
+namespace {
+
+cgx::parameter::journal_storage& journal() {
+    static cgx::parameter::journal_storage storage(CGX_PARAMETER_JOURNAL_PATH);
+    return storage;
+}
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(
+    size_t         lun,
+    uid_value_t    uid,
+    const uint8_t* src,
+    size_t         len
+) {
+    auto& storage = journal();
+    bool  ok      = storage.enter(lun) && storage.write(lun, uid, src, len);
+    return storage.leave() && ok;
+}
+
+bool cgx::parameter::get_bytes(
+    size_t      lun,
+    uid_value_t uid,
+    uint8_t*    dst,
+    size_t      len
+) {
+    auto& storage = journal();
+    bool  ok      = storage.enter(lun) && storage.read(lun, uid, dst, len);
+    return storage.leave() && ok;
+}
@@ -0,0 +1,640 @@
+#pragma once
+
+// Log-structured record store: every write appends a (uid, size, crc,
+// payload) record to the LUN's journal file, and the latest record per UID
+// wins. Requires POSIX file I/O.
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "crc.hpp"
+#include "storage.hpp"
+
+#ifndef CGX_PARAMETER_JOURNAL_MAX_LUNS
+#define CGX_PARAMETER_JOURNAL_MAX_LUNS 4
+#endif
+
+#ifndef CGX_PARAMETER_JOURNAL_ENTRIES
+#define CGX_PARAMETER_JOURNAL_ENTRIES 256
+#endif
+
+// A journal is compacted once it is larger than this many bytes...
+#ifndef CGX_PARAMETER_JOURNAL_COMPACT_MIN
+#define CGX_PARAMETER_JOURNAL_COMPACT_MIN (16 * 1024)
+#endif
+
+// ...and holds more than this many times the bytes of its live records.
+#ifndef CGX_PARAMETER_JOURNAL_COMPACT_RATIO
+#define CGX_PARAMETER_JOURNAL_COMPACT_RATIO 4
+#endif
+
+namespace cgx::parameter {
+
+// Version 1 journals, which did not record their UID width, and journals
+// with 32-bit UIDs opened by a 64-bit build are rewritten in the current
+// layout on open. Their keys are kept, widened, for
+// unique_parameter_list::migrate().
+class journal_file {
+   public:
+    static constexpr uint32_t file_magic   = 0x4C584743;  // "CGXL"
+    static constexpr uint32_t record_magic = 0x52584743;  // "CGXR"
+    static constexpr uint16_t version      = 2;
+
+    struct file_header_t {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t key_version;  // 0 in files written before it was recorded
+        uint16_t uid_bits;     // width of the records' UIDs
+        uint16_t reserved;
+    };
+
+    template <typename U>
+    struct basic_record_header_t {
+        uint32_t magic;
+        U        uid;
+        uint32_t size;
+        uint32_t crc;
+    };
+
+    using record_header_t = basic_record_header_t<uid_value_t>;
+
+    struct stats_t {
+        size_t appends;
+        size_t bytes_appended;
+        size_t compactions;
+        size_t bytes_compacted;
+    };
+
+    journal_file() = default;
+    journal_file(const journal_file&)            = delete;
+    journal_file& operator=(const journal_file&) = delete;
+    ~journal_file() {
+        close();
+    }
+
+    // open replays the journal to rebuild the UID index. A torn or corrupt
+    // tail is cut off at the last record whose CRC checks out. A journal
+    // holding more UIDs than CGX_PARAMETER_JOURNAL_ENTRIES, or keys of
+    // another key_version than the current or accepted one, fails to open
+    // and is left untouched.
+    bool open(const char* path) {
+        close();
+        int n = snprintf(m_path, sizeof(m_path), "%s", path);
+        if (n < 0 || static_cast<size_t>(n) >= sizeof(m_path)) {
+            return false;
+        }
+
+        m_fd = ::open(m_path, O_RDWR | O_CREAT, 0644);
+        if (m_fd < 0) {
+            return false;
+        }
+
+        file_header_t fh{};
+        ssize_t       got = ::pread(m_fd, &fh, sizeof(fh), 0);
+        if (got == 0) {
+            m_key_version = cgx::parameter::key_version;
+            if (!this->write_file_header(m_fd)) {
+                close();
+                return false;
+            }
+            m_end = sizeof(fh);
+            return true;
+        }
+
+        // Version 1 headers end before uid_bits; their UIDs are as wide as
+        // their keys.
+        size_t   start = sizeof(fh);
+        uint32_t bits  = fh.uid_bits;
+        if (got >= static_cast<ssize_t>(offsetof(file_header_t, uid_bits)) &&
+            fh.version == 1) {
+            start = offsetof(file_header_t, uid_bits);
+            bits  = _key_bits(fh.key_version);
+        } else if (got != static_cast<ssize_t>(sizeof(fh)) ||
+                   fh.version != version) {
+            close();
+            return false;
+        }
+        const uint32_t keys = _key_version(fh.key_version);
+        if (fh.magic != file_magic || (bits != 32 && bits != 64) ||
+            bits > CGX_PARAMETER_UID_BITS || _key_bits(keys) > bits ||
+            (keys != cgx::parameter::key_version && keys != m_accepted)) {
+            close();
+            return false;
+        }
+        m_key_version = keys;
+
+        const bool ok = bits == 64 ? this->replay<uint64_t>(start)
+                                   : this->replay<uint32_t>(start);
+        if (!ok) {
+            close();
+            return false;
+        }
+        if ((fh.version != version || bits != CGX_PARAMETER_UID_BITS) &&
+            !this->compact()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // accept_key_version lets open() take journals whose keys follow
+    // version besides the current cgx::parameter::key_version, so that
+    // unique_parameter_list::migrate() can move them. Call it before open().
+    void accept_key_version(uint32_t version) {
+        m_accepted = _key_version(version);
+    }
+
+    void close() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+        m_fd    = -1;
+        m_count = 0;
+        m_end   = 0;
+        m_live  = 0;
+    }
+
+    bool is_open() const {
+        return m_fd >= 0;
+    }
+
+    bool read(uid_value_t uid, uint8_t* dst, size_t len) const {
+        const entry_t* e = this->find(uid);
+        if (e == nullptr || e->size != len) {
+            return false;
+        }
+        return ::pread(m_fd, dst, len, static_cast<off_t>(e->offset)) ==
+               static_cast<ssize_t>(len);
+    }
+
+    bool write(uid_value_t uid, const uint8_t* src, size_t len) {
+        if (!is_open()) {
+            return false;
+        }
+        entry_t* e = this->find(uid);
+        if (e == nullptr && m_count >= m_index.size()) {
+            return false;
+        }
+
+        const size_t offset = m_end;
+        if (!this->append(m_fd, offset, uid, src, len)) {
+            // Drop whatever part of the record made it to the file.
+            (void)::ftruncate(m_fd, static_cast<off_t>(offset));
+            return false;
+        }
+        m_end += _record_size(len);
+
+        m_stats.appends += 1;
+        m_stats.bytes_appended += _record_size(len);
+
+        if (e == nullptr) {
+            e = this->insert(uid);
+        } else {
+            m_live -= _record_size(e->size);
+        }
+        e->offset = offset + sizeof(record_header_t);
+        e->size   = len;
+        m_live += _record_size(len);
+        return true;
+    }
+
+    bool sync() {
+        return is_open() && ::fdatasync(m_fd) == 0;
+    }
+
+    bool needs_compaction() const {
+        return m_end > CGX_PARAMETER_JOURNAL_COMPACT_MIN &&
+               m_end > m_live * CGX_PARAMETER_JOURNAL_COMPACT_RATIO;
+    }
+
+    // compact rewrites the live records into a fresh journal and atomically
+    // replaces the old one, syncing the directory so that the rename
+    // survives a power cut. It must not run concurrently with other calls.
+    bool compact() {
+        if (!is_open()) {
+            return false;
+        }
+        char tmp[sizeof(m_path) + 4];
+        snprintf(tmp, sizeof(tmp), "%s.tmp", m_path);
+
+        int fd = ::open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        bool   ok     = this->write_file_header(fd);
+        size_t offset = sizeof(file_header_t);
+
+        uint8_t buffer[256];
+        for (size_t i = 0; ok && i < m_count; ++i) {
+            // Copy the payload through a small bounce buffer; the CRC is
+            // recomputed incrementally on the way.
+            ok = this->copy(fd, offset, m_index[i], buffer, sizeof(buffer));
+            offset += _record_size(m_index[i].size);
+        }
+        ok = ok && ::fdatasync(fd) == 0 && ::rename(tmp, m_path) == 0;
+        if (!ok) {
+            ::close(fd);
+            ::unlink(tmp);
+            return false;
+        }
+
+        ::close(m_fd);
+        m_fd   = fd;
+        offset = sizeof(file_header_t);
+        for (size_t i = 0; i < m_count; ++i) {
+            m_index[i].offset = offset + sizeof(record_header_t);
+            offset += _record_size(m_index[i].size);
+        }
+        m_stats.compactions += 1;
+        m_stats.bytes_compacted += m_end > offset ? m_end - offset : 0;
+        m_end  = offset;
+        m_live = offset - sizeof(file_header_t);
+        // Either journal is complete, so a failed directory sync only means
+        // the old one may come back after a power cut.
+        return _sync_dir(m_path);
+    }
+
+    size_t size() const {
+        return m_end;
+    }
+
+    size_t live_size() const {
+        return m_live;
+    }
+
+    const stats_t& stats() const {
+        return m_stats;
+    }
+
+    // key_version tells how the keys in this journal were derived from
+    // parameter names, see cgx::parameter::key_version.
+    uint32_t key_version() const {
+        return is_open() ? m_key_version : 0;
+    }
+
+    // set_key_version records that the keys now follow version, e.g. after
+    // unique_parameter_list::migrate() moved them to a new hash. Keys wider
+    // than the records' UIDs are refused.
+    bool set_key_version(uint32_t version) {
+        if (!is_open() || _key_bits(version) > CGX_PARAMETER_UID_BITS) {
+            return false;
+        }
+        m_key_version = version;
+        return this->write_file_header(m_fd) && this->sync();
+    }
+
+   private:
+    struct entry_t {
+        uid_value_t uid;
+        size_t      offset;
+        size_t      size;
+    };
+
+    char                                               m_path[256]{};
+    int                                                m_fd{-1};
+    std::array<entry_t, CGX_PARAMETER_JOURNAL_ENTRIES> m_index{};
+    size_t                                             m_count{0};
+    size_t                                             m_end{0};
+    size_t                                             m_live{0};
+    uint32_t                                           m_key_version{0};
+    stats_t                                            m_stats{};
+
+    uint32_t                m_accepted{cgx::parameter::key_version};
+
+    // _sync_dir flushes the directory holding path, which makes a rename()
+    // into it durable.
+    static bool _sync_dir(const char* path) {
+        char        dir[sizeof(m_path)] = ".";
+        const char* slash               = std::strrchr(path, '/');
+        if (slash != nullptr) {
+            const size_t len = slash == path ? 1 : slash - path;
+            std::memcpy(dir, path, len);
+            dir[len] = '\0';
+        }
+        int fd = ::open(dir, O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            return false;
+        }
+        const bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+    }
+
+    static constexpr size_t _pad(size_t size) {
+        return (4 - size % 4) % 4;
+    }
+
+    template <typename U = uid_value_t>
+    static constexpr size_t _record_size(size_t size) {
+        return sizeof(basic_record_header_t<U>) + size + _pad(size);
+    }
+
+    // _record_seed returns the raw CRC register after hashing the record's
+    // uid and size; the payload is folded in on top of it.
+    template <typename U = uid_value_t>
+    static uint32_t _record_seed(U uid, size_t size) {
+        const uint32_t size32 = static_cast<uint32_t>(size);
+
+        uint8_t head[sizeof(uid) + sizeof(size32)];
+        std::memcpy(head, &uid, sizeof(uid));
+        std::memcpy(head + sizeof(uid), &size32, sizeof(size32));
+        return crc32::update(_init_crc32(), head, sizeof(head));
+    }
+
+    bool write_file_header(int fd) const {
+        const file_header_t fh{
+            file_magic,
+            version,
+            static_cast<uint16_t>(m_key_version),
+            CGX_PARAMETER_UID_BITS,
+            0,
+        };
+        return ::pwrite(fd, &fh, sizeof(fh), 0) ==
+               static_cast<ssize_t>(sizeof(fh));
+    }
+
+    bool append(
+        int            fd,
+        size_t         offset,
+        uid_value_t    uid,
+        const uint8_t* src,
+        size_t         len
+    ) const {
+        record_header_t rh{record_magic, uid, static_cast<uint32_t>(len), 0};
+        rh.crc = crc32::update(_record_seed(uid, len), src, len) ^ 0xFFFFFFFF;
+
+        static const uint8_t zero[4] = {};
+        struct iovec         iov[3]  = {
+            {&rh, sizeof(rh)},
+            {const_cast<uint8_t*>(src), len},
+            {const_cast<uint8_t*>(zero), _pad(len)},
+        };
+        return ::pwritev(fd, iov, 3, static_cast<off_t>(offset)) ==
+               static_cast<ssize_t>(_record_size(len));
+    }
+
+    bool copy(
+        int            fd,
+        size_t         offset,
+        const entry_t& e,
+        uint8_t*       buffer,
+        size_t         buffer_size
+    ) const {
+        record_header_t rh{
+            record_magic, e.uid, static_cast<uint32_t>(e.size), 0
+        };
+        uint32_t crc = _record_seed(e.uid, e.size);
+
+        size_t dst = offset + sizeof(rh);
+        for (size_t done = 0; done < e.size;) {
+            size_t n = std::min(buffer_size, e.size - done);
+            if (::pread(m_fd, buffer, n, static_cast<off_t>(e.offset + done)) !=
+                    static_cast<ssize_t>(n) ||
+                ::pwrite(fd, buffer, n, static_cast<off_t>(dst)) !=
+                    static_cast<ssize_t>(n)) {
+                return false;
+            }
+            crc = crc32::update(crc, buffer, n);
+            done += n;
+            dst += n;
+        }
+
+        static const uint8_t zero[4] = {};
+        rh.crc                       = crc ^ 0xFFFFFFFF;
+        return ::pwrite(fd, zero, _pad(e.size), static_cast<off_t>(dst)) ==
+                   static_cast<ssize_t>(_pad(e.size)) &&
+               ::pwrite(fd, &rh, sizeof(rh), static_cast<off_t>(offset)) ==
+                   static_cast<ssize_t>(sizeof(rh));
+    }
+
+    // replay reads the records from offset on, whose UIDs are of type U.
+    template <typename U>
+    bool replay(size_t offset) {
+        uint8_t                  buffer[256];
+        basic_record_header_t<U> rh;
+        while (::pread(m_fd, &rh, sizeof(rh), static_cast<off_t>(offset)) ==
+               static_cast<ssize_t>(sizeof(rh))) {
+            if (rh.magic != record_magic) {
+                break;
+            }
+            uint32_t crc  = _record_seed<U>(rh.uid, rh.size);
+            size_t   done = 0;
+            while (done < rh.size) {
+                size_t  n   = std::min(sizeof(buffer), rh.size - done);
+                ssize_t got = ::pread(
+                    m_fd,
+                    buffer,
+                    n,
+                    static_cast<off_t>(offset + sizeof(rh) + done)
+                );
+                if (got != static_cast<ssize_t>(n)) {
+                    break;
+                }
+                crc = crc32::update(crc, buffer, n);
+                done += n;
+            }
+            if (done != rh.size || (crc ^ 0xFFFFFFFF) != rh.crc) {
+                break;
+            }
+
+            entry_t* e = this->find(rh.uid);
+            if (e == nullptr) {
+                if (m_count >= m_index.size()) {
+                    // The records are valid; the index is too small.
+                    close();
+                    return false;
+                }
+                e = this->insert(rh.uid);
+            } else {
+                m_live -= _record_size<U>(e->size);
+            }
+            e->offset = offset + sizeof(rh);
+            e->size   = rh.size;
+            m_live += _record_size<U>(rh.size);
+            offset += _record_size<U>(rh.size);
+        }
+
+        // Anything past the last good record is a torn write.
+        m_end = offset;
+        return ::ftruncate(m_fd, static_cast<off_t>(m_end)) == 0;
+    }
+
+    const entry_t* find(uid_value_t uid) const {
+        return const_cast<journal_file*>(this)->find(uid);
+    }
+
+    entry_t* find(uid_value_t uid) {
+        size_t lo = 0;
+        size_t hi = m_count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (m_index[mid].uid < uid) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return (lo < m_count && m_index[lo].uid == uid) ? &m_index[lo]
+                                                        : nullptr;
+    }
+
+    entry_t* insert(uid_value_t uid) {
+        size_t pos = 0;
+        while (pos < m_count && m_index[pos].uid < uid) {
+            ++pos;
+        }
+        for (size_t i = m_count; i > pos; --i) {
+            m_index[i] = m_index[i - 1];
+        }
+        m_index[pos] = entry_t{uid, 0, 0};
+        m_count += 1;
+        return &m_index[pos];
+    }
+};
+
+// journal_storage keeps one journal_file per LUN, opened on first use from a
+// printf-style path pattern taking the LUN as %zu. Compaction runs at
+// commit time once a journal crosses the configured thresholds. With
+// auto_compact off it runs whenever maintain() is called, or on a
+// background thread started with start_compaction().
+//
+// A transaction holds a lock from begin() to commit(), which a background
+// compaction also takes, so commits never pay for compaction but wait while
+// one is running.
+class journal_storage : public storage_i {
+   public:
+    explicit journal_storage(const char* path_pattern, bool auto_compact = true)
+        : m_pattern(path_pattern), m_auto_compact(auto_compact) {
+    }
+    journal_storage(const journal_storage&)            = delete;
+    journal_storage& operator=(const journal_storage&) = delete;
+    ~journal_storage() {
+        stop_compaction();
+    }
+
+    bool begin(size_t lun) override {
+        m_mutex.lock();
+        if (this->file(lun) == nullptr) {
+            m_mutex.unlock();
+            return false;
+        }
+        return true;
+    }
+
+    bool commit(size_t lun) override {
+        journal_file* f  = this->file(lun);
+        const bool    ok = f != nullptr && f->sync();
+        if (ok && m_auto_compact && f->needs_compaction()) {
+            f->compact();
+        }
+        m_mutex.unlock();
+        return ok;
+    }
+
+    bool read(size_t lun, uid_value_t uid, uint8_t* dst, size_t len) override {
+        journal_file* f = this->file(lun);
+        return f != nullptr && f->read(uid, dst, len);
+    }
+
+    bool write(
+        size_t lun, uid_value_t uid, const uint8_t* src, size_t len
+    ) override {
+        journal_file* f = this->file(lun);
+        return f != nullptr && f->write(uid, src, len);
+    }
+
+    // accept_key_version lets journals whose keys follow version be opened
+    // for a migration, see journal_file::accept_key_version().
+    void accept_key_version(uint32_t version) {
+        m_accepted = version;
+    }
+
+    // maintain compacts every open journal that crossed the thresholds.
+    // Call it from an idle task, outside of a transaction on this thread.
+    void maintain() {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        for (auto& f : m_files) {
+            if (f.is_open() && f.needs_compaction()) {
+                f.compact();
+            }
+        }
+    }
+
+    // start_compaction calls maintain() every period on a background
+    // thread until stop_compaction(). Returns false if it already runs.
+    bool start_compaction(std::chrono::milliseconds period) {
+        std::lock_guard<std::mutex> lock(m_worker_mutex);
+        if (m_worker.joinable()) {
+            return false;
+        }
+        m_stop   = false;
+        m_worker = std::thread([this, period]() {
+            std::unique_lock<std::mutex> lock(m_worker_mutex);
+            while (!m_wake.wait_for(lock, period, [this]() {
+                return m_stop;
+            })) {
+                lock.unlock();
+                this->maintain();
+                lock.lock();
+            }
+        });
+        return true;
+    }
+
+    void stop_compaction() {
+        {
+            std::lock_guard<std::mutex> lock(m_worker_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        if (m_worker.joinable()) {
+            m_worker.join();
+        }
+    }
+
+    journal_file* file(size_t lun) {
+        if (lun >= m_files.size()) {
+            return nullptr;
+        }
+        journal_file& f = m_files[lun];
+        if (!f.is_open()) {
+            char path[256];
+            int  n = snprintf(path, sizeof(path), m_pattern, lun);
+            if (n < 0 || static_cast<size_t>(n) >= sizeof(path)) {
+                return nullptr;
+            }
+            f.accept_key_version(m_accepted);
+            if (!f.open(path)) {
+                return nullptr;
+            }
+        }
+        return &f;
+    }
+
+   private:
+    const char*                                              m_pattern;
+    bool                                                     m_auto_compact;
+    std::array<journal_file, CGX_PARAMETER_JOURNAL_MAX_LUNS> m_files;
+
+    uint32_t                m_accepted{cgx::parameter::key_version};
+    // begin() holds m_mutex until commit(). It is recursive so that a
+    // transaction on another LUN can nest, see storage_i::enter().
+    std::recursive_mutex    m_mutex;
+    std::mutex              m_worker_mutex;
+    std::condition_variable m_wake;
+    std::thread             m_worker;
+    bool                    m_stop{false};
+};
+
+}  // namespace cgx::parameter
@@ -0,0 +1,522 @@
+#pragma once
+
+// JSON for value_writer and value_reader. The writer streams through a
+// byte_output; the reader parses a contiguous buffer, such as a file read or
+// mapped into memory, without allocating.
+//
+// Floats are written in their shortest round-trip form. JSON has no NaN or
+// infinity, so they are written as null and read back as NaN. Raw bytes are
+// written as a string of hex digits.
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+#include "codec.hpp"
+#include "format.hpp"
+
+namespace cgx::parameter {
+
+class json_writer final : public value_writer {
+   public:
+    // pretty puts every entry on its own, indented line.
+    explicit json_writer(byte_output& out, bool pretty = false)
+        : m_out(out), m_pretty(pretty) {
+    }
+
+    bool begin_object(size_t) override {
+        return this->open('{');
+    }
+
+    bool key(std::string_view name) override {
+        if (!this->separate() || !this->put_string(name) ||
+            !this->put(m_pretty ? ": " : ":")) {
+            return false;
+        }
+        m_after_key = true;
+        return true;
+    }
+
+    bool end_object() override {
+        return this->close('}');
+    }
+
+    bool begin_array(size_t) override {
+        return this->open('[');
+    }
+
+    bool end_array() override {
+        return this->close(']');
+    }
+
+    bool write_int(int64_t value) override {
+        return this->put_number(value);
+    }
+
+    bool write_uint(uint64_t value) override {
+        return this->put_number(value);
+    }
+
+    bool write_float(float value) override {
+        return std::isfinite(value) ? this->put_number(value)
+                                    : this->write_null();
+    }
+
+    bool write_double(double value) override {
+        return std::isfinite(value) ? this->put_number(value)
+                                    : this->write_null();
+    }
+
+    bool write_bool(bool value) override {
+        return this->separate() && this->put(value ? "true" : "false");
+    }
+
+    bool write_string(std::string_view value) override {
+        return this->separate() && this->put_string(value);
+    }
+
+    bool write_bytes(const uint8_t* data, size_t size) override {
+        if (!this->separate() || !m_out.put(uint8_t{'"'})) {
+            return false;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (!m_out.put(_digits.hex[data[i]], 2)) {
+                return false;
+            }
+        }
+        return m_out.put(uint8_t{'"'});
+    }
+
+   private:
+    byte_output& m_out;
+    bool         m_pretty;
+    size_t       m_depth{0};
+    bool         m_first{true};
+    bool         m_after_key{false};
+
+    bool put(std::string_view text) {
+        return m_out.put(text.data(), text.size());
+    }
+
+    template <typename T>
+    bool put_number(T value) {
+        char       buffer[32];
+        const auto end = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return this->separate() &&
+               m_out.put(buffer, static_cast<size_t>(end.ptr - buffer));
+    }
+
+    bool write_null() {
+        return this->separate() && this->put("null");
+    }
+
+    bool put_string(std::string_view text) {
+        if (!m_out.put(uint8_t{'"'})) {
+            return false;
+        }
+        size_t plain = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const auto c = static_cast<uint8_t>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            if (!m_out.put(text.data() + plain, i - plain)) {
+                return false;
+            }
+            plain = i + 1;
+
+            const char escape[] = {
+                '\\', 'u', '0', '0', _digits.hex[c][0], _digits.hex[c][1]
+            };
+            const bool ok = c == '"'    ? this->put("\\\"")
+                            : c == '\\' ? this->put("\\\\")
+                            : c == '\n' ? this->put("\\n")
+                            : c == '\t' ? this->put("\\t")
+                                        : m_out.put(escape, sizeof(escape));
+            if (!ok) {
+                return false;
+            }
+        }
+        return m_out.put(text.data() + plain, text.size() - plain) &&
+               m_out.put(uint8_t{'"'});
+    }
+
+    // separate writes what goes before a value or key: a comma after the
+    // first entry of a container and, when pretty, a new line.
+    bool separate() {
+        if (m_after_key) {
+            m_after_key = false;
+            return m_out.ok();
+        }
+        if (!m_first && !m_out.put(uint8_t{','})) {
+            return false;
+        }
+        m_first = false;
+        return !m_pretty || m_depth == 0 || this->newline();
+    }
+
+    bool newline() {
+        if (!m_out.put(uint8_t{'\n'})) {
+            return false;
+        }
+        for (size_t i = 0; i < m_depth; ++i) {
+            if (!this->put("  ")) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool open(char bracket) {
+        if (!this->separate() || !m_out.put(static_cast<uint8_t>(bracket))) {
+            return false;
+        }
+        m_depth += 1;
+        m_first = true;
+        return true;
+    }
+
+    bool close(char bracket) {
+        const bool empty = m_first;
+        m_depth -= 1;
+        m_first = false;
+        if (m_pretty && !empty && !this->newline()) {
+            return false;
+        }
+        return m_out.put(static_cast<uint8_t>(bracket));
+    }
+};
+
+class json_reader final : public value_reader {
+   public:
+    json_reader(const char* data, size_t size)
+        : m_pos(data), m_end(data + size) {
+    }
+
+    json_reader(const uint8_t* data, size_t size)
+        : json_reader(reinterpret_cast<const char*>(data), size) {
+    }
+
+    bool read_int(int64_t& value) override {
+        return this->parse_number(value);
+    }
+
+    bool read_uint(uint64_t& value) override {
+        return this->parse_number(value);
+    }
+
+    bool read_double(double& value) override {
+        this->skip_space();
+        if (this->literal("null")) {
+            value = std::numeric_limits<double>::quiet_NaN();
+            return true;
+        }
+        return this->parse_number(value);
+    }
+
+    bool read_bool(bool& value) override {
+        this->skip_space();
+        if (this->literal("true")) {
+            value = true;
+        } else if (this->literal("false")) {
+            value = false;
+        } else {
+            return this->fail();
+        }
+        return true;
+    }
+
+    bool read_string(char* dst, size_t capacity, size_t& size) override {
+        return this->parse_string(dst, capacity, size) && size < capacity;
+    }
+
+    bool read_bytes(uint8_t* dst, size_t size) override {
+        this->skip_space();
+        if (!this->consume('"')) {
+            return this->fail();
+        }
+        for (size_t i = 0; i < size; ++i) {
+            int high, low;
+            if (m_end - m_pos < 2 || (high = _hex_value(m_pos[0])) < 0 ||
+                (low = _hex_value(m_pos[1])) < 0) {
+                return this->fail();
+            }
+            dst[i] = static_cast<uint8_t>(high << 4 | low);
+            m_pos += 2;
+        }
+        return this->consume('"') || this->fail();
+    }
+
+    bool begin_object() override {
+        return this->open('{');
+    }
+
+    bool next_key(char* dst, size_t capacity, size_t& size) override {
+        if (!this->next('}') || !this->parse_string(dst, capacity, size)) {
+            return false;
+        }
+        this->skip_space();
+        return this->consume(':') || this->fail();
+    }
+
+    bool begin_array() override {
+        return this->open('[');
+    }
+
+    bool next_element() override {
+        return this->next(']');
+    }
+
+    // skip matches brackets and steps over strings and scalars without
+    // decoding them.
+    bool skip() override {
+        bool   object[CGX_PARAMETER_CODEC_DEPTH];
+        size_t depth = 0;
+        do {
+            this->skip_space();
+            if (m_pos == m_end) {
+                return this->fail();
+            }
+            const char c = *m_pos;
+            if (c == '{' || c == '[') {
+                if (depth == CGX_PARAMETER_CODEC_DEPTH) {
+                    return this->fail();
+                }
+                object[depth++] = c == '{';
+                m_pos += 1;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0 || object[--depth] != (c == '}')) {
+                    return this->fail();
+                }
+                m_pos += 1;
+            } else if (c == ',' || c == ':') {
+                if (depth == 0) {
+                    return this->fail();
+                }
+                m_pos += 1;
+            } else if (c == '"') {
+                size_t size;
+                if (!this->parse_string(nullptr, 0, size)) {
+                    return false;
+                }
+            } else if (this->token().empty()) {
+                return this->fail();
+            }
+        } while (depth > 0);
+        return true;
+    }
+
+    // finish checks that nothing but white space follows the last value.
+    bool finish() {
+        this->skip_space();
+        return m_ok && m_pos == m_end;
+    }
+
+   private:
+    const char* m_pos;
+    const char* m_end;
+    bool        m_first{true};
+
+    static int _hex_value(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    void skip_space() {
+        while (m_pos != m_end &&
+               (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' ||
+                *m_pos == '\t')) {
+            m_pos += 1;
+        }
+    }
+
+    bool consume(char c) {
+        if (m_pos == m_end || *m_pos != c) {
+            return false;
+        }
+        m_pos += 1;
+        return true;
+    }
+
+    bool literal(std::string_view text) {
+        if (static_cast<size_t>(m_end - m_pos) < text.size() ||
+            std::string_view(m_pos, text.size()) != text) {
+            return false;
+        }
+        m_pos += text.size();
+        return true;
+    }
+
+    // token returns the run of characters that can make up a number or a
+    // literal.
+    std::string_view token() {
+        const char* first = m_pos;
+        while (m_pos != m_end &&
+               ((*m_pos >= '0' && *m_pos <= '9') ||
+                (*m_pos >= 'a' && *m_pos <= 'z') || *m_pos == '-' ||
+                *m_pos == '+' || *m_pos == '.' || *m_pos == 'E')) {
+            m_pos += 1;
+        }
+        return std::string_view(first, static_cast<size_t>(m_pos - first));
+    }
+
+    template <typename T>
+    bool parse_number(T& value) {
+        this->skip_space();
+        const std::string_view text = this->token();
+        const char*            end  = text.data() + text.size();
+        const auto parsed = std::from_chars(text.data(), end, value);
+        if (text.empty() || parsed.ec != std::errc() || parsed.ptr != end) {
+            return this->fail();
+        }
+        return true;
+    }
+
+    bool open(char bracket) {
+        this->skip_space();
+        if (!this->consume(bracket)) {
+            return this->fail();
+        }
+        m_first = true;
+        return true;
+    }
+
+    // next steps to the next entry of the current container, or past its
+    // closing bracket.
+    bool next(char bracket) {
+        this->skip_space();
+        if (this->consume(bracket)) {
+            m_first = false;
+            return false;
+        }
+        if (!m_first) {
+            if (!this->consume(',')) {
+                return this->fail();
+            }
+            this->skip_space();
+        }
+        m_first = false;
+        return m_pos != m_end || this->fail();
+    }
+
+    // parse_string decodes a string into dst like snprintf(): size is the
+    // decoded length and at most capacity - 1 bytes are stored.
+    bool parse_string(char* dst, size_t capacity, size_t& size) {
+        this->skip_space();
+        if (!this->consume('"')) {
+            return this->fail();
+        }
+        size = 0;
+        auto emit = [&](char c) {
+            if (size + 1 < capacity) {
+                dst[size] = c;
+            }
+            size += 1;
+        };
+
+        while (true) {
+            if (m_pos == m_end) {
+                return this->fail();
+            }
+            const char c = *m_pos++;
+            if (c == '"') {
+                break;
+            }
+            if (static_cast<uint8_t>(c) < 0x20) {
+                return this->fail();
+            }
+            if (c != '\\') {
+                emit(c);
+                continue;
+            }
+
+            if (m_pos == m_end) {
+                return this->fail();
+            }
+            switch (*m_pos++) {
+                case '"': emit('"'); break;
+                case '\\': emit('\\'); break;
+                case '/': emit('/'); break;
+                case 'b': emit('\b'); break;
+                case 'f': emit('\f'); break;
+                case 'n': emit('\n'); break;
+                case 'r': emit('\r'); break;
+                case 't': emit('\t'); break;
+                case 'u': {
+                    uint32_t code;
+                    if (!this->parse_code_point(code)) {
+                        return this->fail();
+                    }
+                    if (code < 0x80) {
+                        emit(static_cast<char>(code));
+                    } else if (code < 0x800) {
+                        emit(static_cast<char>(0xC0 | code >> 6));
+                        emit(static_cast<char>(0x80 | (code & 0x3F)));
+                    } else if (code < 0x10000) {
+                        emit(static_cast<char>(0xE0 | code >> 12));
+                        emit(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+                        emit(static_cast<char>(0x80 | (code & 0x3F)));
+                    } else {
+                        emit(static_cast<char>(0xF0 | code >> 18));
+                        emit(static_cast<char>(0x80 | (code >> 12 & 0x3F)));
+                        emit(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+                        emit(static_cast<char>(0x80 | (code & 0x3F)));
+                    }
+                    break;
+                }
+                default: return this->fail();
+            }
+        }
+        if (capacity > 0) {
+            dst[std::min(size, capacity - 1)] = '\0';
+        }
+        return true;
+    }
+
+    bool parse_hex4(uint32_t& value) {
+        if (m_end - m_pos < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int digit = _hex_value(*m_pos++);
+            if (digit < 0) {
+                return false;
+            }
+            value = value << 4 | static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    // parse_code_point reads the digits after "\u", joining surrogate
+    // pairs.
+    bool parse_code_point(uint32_t& code) {
+        if (!this->parse_hex4(code)) {
+            return false;
+        }
+        if (code < 0xD800 || code > 0xDFFF) {
+            return true;
+        }
+        uint32_t low;
+        if (code > 0xDBFF || !this->literal("\\u") ||
+            !this->parse_hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+            return false;
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        return true;
+    }
+};
+
+}  // namespace cgx::parameter
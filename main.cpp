@@ -6,10 +6,10 @@
 #include "my_params.hpp"
 
 bool cgx::parameter::set_bytes(
-    size_t         lun,
-    uint32_t       uid,
-    const uint8_t* src,
-    size_t         len
+    size_t                      lun,
+    cgx::parameter::uid_value_t uid,
+    const uint8_t*              src,
+    size_t                      len
 ) {
     std::cout << "[s] " << "lun: " << lun << " uid: " << std::hex << uid
               << " src: [";
@@ -45,10 +45,10 @@ bool cgx::parameter::set_bytes(
 };
 
 bool cgx::parameter::get_bytes(
-    size_t   lun,
-    uint32_t uid,
-    uint8_t* dst,
-    size_t   len
+    size_t                      lun,
+    cgx::parameter::uid_value_t uid,
+    uint8_t*                    dst,
+    size_t                      len
 ) {
     std::stringstream ss;
     switch (lun) {
@@ -104,15 +104,15 @@ void custom_printer(const char* str) {
 cgx::unique_parameter_list<0, 10> params(custom_printer);
 cgx::unique_parameter_list<1, 10> params2(custom_printer);
 
-auto& integer      = params2.add<0>(42);
-auto& boolean      = params.add<1>(false);
-auto& custom       = params.add<2>(custom_type{1, 2});
-auto& text         = params.add<5>(__DATE__ " " __TIME__);
-auto& array        = params.add<3>(std::array<int, 3>{
+cgx::unique_parameter<int>& integer = params2.add("integer", 42);
+auto& boolean      = params.add("boolean", false);
+auto& custom       = params.add("custom", custom_type{1, 2});
+auto& text         = params.add("text", __DATE__ " " __TIME__);
+auto& array        = params.add("array", std::array<int, 3>{
     1,
     5,
 });
-auto& custom_array = params.add<4>([]() {
+auto& custom_array = params.add("custom_array", []() {
     std::array<custom_type, 2> arr;
     for (size_t i = 0; i < 2; ++i) {
         arr[i] = custom_type{1, static_cast<int>(i)};
@@ -120,7 +120,8 @@ auto& custom_array = params.add<4>([]() {
     return arr;
 }());
 
-auto& complex = params.add<100>(complex_class{});
+cgx::unique_parameter<complex_class>& complex =
+    params.add("complex", complex_class{});
 
 int main() {
     using namespace cgx::parameter;
@@ -144,10 +145,12 @@ int main() {
     custom_array[0] = custom_type{2, 2};
     text            = "good bye";
 
-    complex.value().set_fn([](float value) {
-        std::cout << "custom fn: " << value << std::endl;
+    complex.update([](complex_class& value) {
+        value.set_fn([](float value) {
+            std::cout << "custom fn: " << value << std::endl;
+        });
+        value.set_value(3.14f);
     });
-    complex.value().set_value(3.14f);
 
     for (auto& value : array) {
         value = value + 10;
@@ -170,9 +173,13 @@ int main() {
 
     std::cout << "resetting again:" << std::endl;
     params.reset();
-    complex.value().set_value(2.71f);
+    complex.update([](complex_class& value) {
+        value.set_value(2.71f);
+    });
     complex.print();
-    complex.value().set_fn(nullptr);
+    complex.update([](complex_class& value) {
+        value.set_fn(nullptr);
+    });
     complex.print();
 
     params2.print();
@@ -0,0 +1,360 @@
+#pragma once
+
+// Zero-copy parameters whose value lives directly inside a packed_file
+// mapping. Meant for large trivially copyable types such as calibration
+// tables, where parameter<T> would keep a second copy in RAM.
+
+#include <cstring>
+#include <type_traits>
+
+#include "packed_file_storage.hpp"
+#include "parameter.hpp"
+
+namespace cgx {
+
+// mapped_parameter<T> reads straight from a mapped record and writes in
+// place. Until the record is bound by validate(), retrieve() or a first
+// write, the value is the default held in RAM.
+//
+// The kernel may write a MAP_SHARED page back at any time, so writes never
+// go to the stored record. Each parameter keeps two records: the stored one
+// under its UID and a working copy under ~uid, which reads and writes use.
+// store() seals the working copy with its CRC, msyncs it, then copies it
+// over the stored record. If the process dies between stores, the working
+// copy fails its CRC and the next boot loads the value last stored. If it
+// dies while store() copies, the stored record fails its CRC and the
+// sealed working copy is loaded instead. Mapped values thus take twice
+// their size in the file, but still none in RAM.
+template <typename T>
+class mapped_parameter : public unique_parameter_i {
+    static_assert(
+        std::is_trivially_copyable_v<T>,
+        "mapped parameters must be trivially copyable"
+    );
+    static_assert(
+        alignof(T) <= parameter::packed_file::align,
+        "mapped parameters cannot be more aligned than packed records"
+    );
+
+   public:
+    mapped_parameter(
+        delegate<void(const char*)>     print,
+        size_t                          lun,
+        const parameter::uid_t&         uid,
+        const T&                        value,
+        parameter::packed_file_storage& storage
+    )
+        : unique_parameter_i(lun)
+        , m_storage(storage)
+        , m_default(value)
+        , m_print(print)
+        , m_uid(uid) {
+    }
+    mapped_parameter(const mapped_parameter&) = delete;
+    virtual ~mapped_parameter()               = default;
+
+    bool set_bytes(const uint8_t* src, size_t size) override {
+        if (size != sizeof(T)) {
+            return false;
+        }
+        if (std::memcmp(m_value, src, sizeof(T)) == 0) {
+            return true;
+        }
+        if (!this->bind()) {
+            return false;
+        }
+        std::memcpy(m_value, src, sizeof(T));
+        this->touch();
+        this->notify_changed();
+        return true;
+    }
+
+    bool get_bytes(uint8_t* dst, size_t size) const override {
+        if (size != sizeof(T)) {
+            return false;
+        }
+        std::memcpy(dst, m_value, sizeof(T));
+        return true;
+    }
+
+    const uint8_t* bytes() const override {
+        return reinterpret_cast<const uint8_t*>(m_value);
+    }
+
+    // Ranged writes only mark the written bytes for the next msync.
+    bool
+    set_bytes_at(size_t offset, const uint8_t* src, size_t size) override {
+        if (!parameter::_in_range(offset, size, sizeof(T))) {
+            return false;
+        }
+        if (std::memcmp(
+                reinterpret_cast<const uint8_t*>(m_value) + offset, src, size
+            ) == 0) {
+            return true;
+        }
+        if (!this->bind()) {
+            return false;
+        }
+        auto* bytes = reinterpret_cast<uint8_t*>(m_value);
+        std::memcpy(bytes + offset, src, size);
+        this->mark_dirty();
+        parameter::packed_file* file = m_storage.file(this->get_lun());
+        if (file != nullptr) {
+            file->touch(bytes + offset, size);
+        }
+        this->notify_changed();
+        return true;
+    }
+
+    bool
+    get_bytes_at(size_t offset, uint8_t* dst, size_t size) const override {
+        if (!parameter::_in_range(offset, size, sizeof(T))) {
+            return false;
+        }
+        auto* bytes = reinterpret_cast<const uint8_t*>(m_value);
+        std::memcpy(dst, bytes + offset, size);
+        return true;
+    }
+
+    int to_char(char* dst, size_t size) const override {
+        parameter::text_writer out(dst, size);
+        out.put(type_name<T>().data()).put(' ');
+        out.put(m_uid.get_name()).put(" = <");
+        out.put(m_bound ? "mapped " : "default ").put_uint(sizeof(T));
+        out.put(" bytes>");
+        return out.terminate();
+    }
+
+    void print() const override {
+        this->print_with(m_print);
+    }
+
+    void print(parameter::text_sink& out) const override {
+        this->print_line(out);
+    }
+
+    void reset() override {
+        set_value(m_default);
+    }
+
+    uint32_t get_crc() const override {
+        if (this->m_crc_dirty) {
+            this->m_crc = _calc_crc(
+                _init_crc32(),
+                reinterpret_cast<const uint8_t*>(m_value),
+                sizeof(T)
+            );
+            this->m_crc_dirty = false;
+        }
+        return this->m_crc;
+    }
+
+    bool validate() override {
+        if (this->is_valid()) {
+            return true;
+        }
+
+        if (this->retrieve()) {
+            this->set_valid(true);
+            return true;
+        }
+
+        this->reset();
+        return this->store();
+    }
+
+    // retrieve binds the parameter to a working copy of its stored record
+    // if the record exists and passes its CRC check, and calls on_changed
+    // if the record differs from the value held so far. A stored record
+    // torn by a crash during store() is repaired from the sealed working
+    // copy.
+    bool retrieve() override {
+        parameter::packed_file* file = m_storage.file(this->get_lun());
+        if (file == nullptr) {
+            return false;
+        }
+        const uint8_t* data = file->view(this->uid(), sizeof(T));
+        if (data == nullptr) {
+            data = file->view(this->working_uid(), sizeof(T));
+            if (data == nullptr || !this->seal(*file, data)) {
+                return false;
+            }
+        }
+        uint8_t* working = file->reserve(this->working_uid(), sizeof(T));
+        if (working == nullptr) {
+            return false;
+        }
+        const bool changed = std::memcmp(m_value, data, sizeof(T)) != 0;
+        if (working != data) {
+            std::memmove(working, data, sizeof(T));
+            file->touch(working, sizeof(T));
+        }
+        m_value = reinterpret_cast<T*>(working);
+        m_bound = true;
+        this->mark_dirty();
+        if (changed) {
+            this->notify_changed();
+        }
+        return true;
+    }
+
+    bool store() override {
+        if (!this->bind()) {
+            return false;
+        }
+        parameter::packed_file* file = m_storage.file(this->get_lun());
+        if (!file->update_crc(this->working_uid()) || !file->flush() ||
+            !this->seal(*file, reinterpret_cast<const uint8_t*>(m_value))) {
+            return false;
+        }
+        this->set_valid(true);
+        return true;
+    }
+
+    parameter::uid_value_t uid() const override {
+        return m_uid;
+    }
+
+    std::string_view name() const override {
+        return m_uid.get_name();
+    }
+
+    uint32_t type_id() const override {
+        return parameter::_type_id<T>();
+    }
+
+    size_t byte_size() const override {
+        return sizeof(T);
+    }
+
+    bool encode(parameter::value_writer& out) const override {
+        return parameter::codec<T>::encode(out, *m_value);
+    }
+
+    // decode fills a copy on the stack so that a malformed value leaves the
+    // mapping untouched.
+    bool decode(parameter::value_reader& in) override {
+        T value = *m_value;
+        return parameter::codec<T>::decode(in, value) && this->set_value(value);
+    }
+
+    bool rekey(parameter::uid_value_t old_uid) override {
+        parameter::packed_file* file = m_storage.file(this->get_lun());
+        if (file == nullptr) {
+            return false;
+        }
+        const uint8_t* data = file->view(old_uid, sizeof(T));
+        return data != nullptr && file->write(this->uid(), data, sizeof(T)) &&
+               file->flush();
+    }
+
+    operator const T&() const {
+        return *m_value;
+    }
+
+    mapped_parameter<T>& operator=(const T& value) {
+        set_value(value);
+        return *this;
+    }
+
+    const T& value() const {
+        return *m_value;
+    }
+
+    // update lets f modify the value in place, then marks the cached CRC
+    // and the mapped pages dirty and notifies if the bytes changed. If the
+    // record cannot be created, f is not called and false is returned, so
+    // that the default reset() restores stays as it was.
+    template <typename F>
+    bool update(F&& f) {
+        if (!this->bind()) {
+            return false;
+        }
+        const uint32_t crc = this->get_crc();
+        f(*m_value);
+        this->touch();
+        if (this->get_crc() != crc) {
+            this->notify_changed();
+        }
+        return true;
+    }
+
+    bool set_value(const T& value) {
+        if (std::memcmp(m_value, &value, sizeof(T)) == 0) {
+            return true;
+        }
+        if (!this->bind()) {
+            return false;
+        }
+        std::memcpy(m_value, &value, sizeof(T));
+        this->touch();
+        this->notify_changed();
+        return true;
+    }
+
+    void set_print(delegate<void(const char*)> print) {
+        m_print = print;
+    }
+
+    bool is_bound() const {
+        return m_bound;
+    }
+
+   private:
+    parameter::packed_file_storage& m_storage;
+    T                               m_default;
+    T*                              m_value{&m_default};
+    bool                            m_bound{false};
+    delegate<void(const char*)>     m_print{nullptr};
+    const parameter::uid_t          m_uid;
+
+    // working_uid keys the working copy of the record.
+    parameter::uid_value_t working_uid() const {
+        return ~this->uid();
+    }
+
+    // bind moves the value into its working copy, creating the record from
+    // the current value if needed. The stored record is left as it is.
+    bool bind() {
+        if (m_bound) {
+            return true;
+        }
+        parameter::packed_file* file = m_storage.file(this->get_lun());
+        if (file == nullptr) {
+            return false;
+        }
+        uint8_t* data = file->reserve(this->working_uid(), sizeof(T));
+        if (data == nullptr) {
+            return false;
+        }
+        std::memcpy(data, m_value, sizeof(T));
+        file->touch(data, sizeof(T));
+        m_value = reinterpret_cast<T*>(data);
+        m_bound = true;
+        return true;
+    }
+
+    // seal copies src, whose working copy already passes its CRC check,
+    // over the stored record and flushes it.
+    bool seal(parameter::packed_file& file, const uint8_t* src) {
+        uint8_t* stored = file.reserve(this->uid(), sizeof(T));
+        if (stored == nullptr) {
+            return false;
+        }
+        std::memcpy(stored, src, sizeof(T));
+        return file.update_crc(this->uid()) && file.flush();
+    }
+
+    void touch() {
+        this->mark_dirty();
+        if (!m_bound) {
+            return;
+        }
+        parameter::packed_file* file = m_storage.file(this->get_lun());
+        if (file != nullptr) {
+            file->touch(reinterpret_cast<const uint8_t*>(m_value), sizeof(T));
+        }
+    }
+};
+
+}  // namespace cgx
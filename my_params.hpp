@@ -6,5 +6,5 @@
 extern cgx::unique_parameter_list<0, 10> params;
 extern cgx::unique_parameter_list<1, 10> params2;
 
-extern cgx::unique_parameter<int, 0>&             integer;
-extern cgx::unique_parameter<complex_class, 100>& complex;
+extern cgx::unique_parameter<int>&           integer;
+extern cgx::unique_parameter<complex_class>& complex;
@@ -0,0 +1,41 @@
+// Link this file instead of providing cgx::parameter::set_bytes() and
+// get_bytes() to keep every LUN in a single packed file.
+
+#include "packed_file_storage.hpp"
+
+#ifndef CGX_PARAMETER_PACKED_PATH
+#define CGX_PARAMETER_PACKED_PATH "./stored/lun%zu.bin"
+#endif
+
+namespace {
+
+cgx::parameter::packed_file_storage& packed_storage() {
+    static cgx::parameter::packed_file_storage storage(
+        CGX_PARAMETER_PACKED_PATH
+    );
+    return storage;
+}
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(
+    size_t         lun,
+    uid_value_t    uid,
+    const uint8_t* src,
+    size_t         len
+) {
+    auto& storage = packed_storage();
+    bool  ok      = storage.enter(lun) && storage.write(lun, uid, src, len);
+    return storage.leave() && ok;
+}
+
+bool cgx::parameter::get_bytes(
+    size_t      lun,
+    uid_value_t uid,
+    uint8_t*    dst,
+    size_t      len
+) {
+    auto& storage = packed_storage();
+    bool  ok      = storage.enter(lun) && storage.read(lun, uid, dst, len);
+    return storage.leave() && ok;
+}
@@ -0,0 +1,728 @@
+#pragma once
+
+// Single-file record store: one memory-mapped file per LUN holding a header,
+// a UID-sorted directory and a data area. Requires POSIX mmap.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include "crc.hpp"
+#include "storage.hpp"
+
+#ifndef CGX_PARAMETER_PACKED_MAX_LUNS
+#define CGX_PARAMETER_PACKED_MAX_LUNS 4
+#endif
+
+#ifndef CGX_PARAMETER_PACKED_ENTRIES
+#define CGX_PARAMETER_PACKED_ENTRIES 256
+#endif
+
+#ifndef CGX_PARAMETER_PACKED_DATA_SIZE
+#define CGX_PARAMETER_PACKED_DATA_SIZE (64 * 1024)
+#endif
+
+namespace cgx::parameter {
+
+// mapped_file owns a shared read/write mapping of a whole file.
+class mapped_file {
+   public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&)            = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file() {
+        close();
+    }
+
+    // open maps path, creating it with size bytes if it does not exist.
+    // Returns false if the file could not be mapped. created() tells
+    // whether the file was new.
+    bool open(const char* path, size_t size) {
+        close();
+        int fd = ::open(path, O_RDWR);
+        if (fd < 0) {
+            fd = ::open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (fd < 0) {
+                return false;
+            }
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                ::close(fd);
+                return false;
+            }
+            m_created = true;
+        } else {
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                return false;
+            }
+            size      = static_cast<size_t>(st.st_size);
+            m_created = false;
+        }
+
+        void* data =
+            ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        m_data = static_cast<uint8_t*>(data);
+        m_size = size;
+        return true;
+    }
+
+    void close() {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    // sync flushes the pages covering [offset, offset + size) to the file.
+    bool sync(size_t offset, size_t size) {
+        if (m_data == nullptr || size == 0) {
+            return true;
+        }
+        const size_t page  = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        const size_t first = offset - offset % page;
+        return ::msync(m_data + first, offset + size - first, MS_SYNC) == 0;
+    }
+
+    uint8_t* data() const {
+        return m_data;
+    }
+    size_t size() const {
+        return m_size;
+    }
+    bool is_open() const {
+        return m_data != nullptr;
+    }
+    bool created() const {
+        return m_created;
+    }
+
+   private:
+    uint8_t* m_data{nullptr};
+    size_t   m_size{0};
+    bool     m_created{false};
+};
+
+// packed_file holds all records of one LUN. Records are updated in place
+// when their size is unchanged, when they shrink, and when the last record
+// grows. Any other resized record gets new space at the end of the data
+// area and its old bytes are left unused; see reserve().
+//
+// Version 1 files, which did not record their UID width, and files with
+// 32-bit UIDs opened by a 64-bit build are rewritten in the current layout
+// on open. Their keys are kept, widened, for unique_parameter_list::migrate().
+class packed_file {
+   public:
+    static constexpr uint32_t magic   = 0x50584743;  // "CGXP"
+    static constexpr uint16_t version = 2;
+    static constexpr size_t   align   = 8;
+
+    struct header_t {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t header_size;
+        uint32_t capacity;
+        uint32_t count;
+        uint32_t data_size;
+        uint32_t data_used;
+        uint32_t key_version;  // 0 in files written before it was recorded
+        uint32_t uid_bits;     // width of the directory's UIDs
+        uint32_t reserved;     // pads the header to align the directory
+        uint32_t crc;
+    };
+
+    template <typename U>
+    struct basic_entry_t {
+        U        uid;
+        uint32_t offset;
+        uint32_t size;
+        uint32_t crc;
+    };
+
+    using entry_t = basic_entry_t<uid_value_t>;
+
+    static_assert(
+        sizeof(header_t) % alignof(entry_t) == 0,
+        "the directory must be aligned for entry_t"
+    );
+
+    bool open(
+        const char* path,
+        size_t      capacity  = CGX_PARAMETER_PACKED_ENTRIES,
+        size_t      data_size = CGX_PARAMETER_PACKED_DATA_SIZE
+    ) {
+        data_size = _align(data_size);
+        if (!m_file.open(path, _file_size(capacity, data_size))) {
+            return false;
+        }
+        if (m_file.created()) {
+            header_t h{};
+            h.magic       = magic;
+            h.version     = version;
+            h.header_size = sizeof(header_t);
+            h.capacity    = static_cast<uint32_t>(capacity);
+            h.data_size   = static_cast<uint32_t>(data_size);
+            h.key_version = cgx::parameter::key_version;
+            h.uid_bits    = CGX_PARAMETER_UID_BITS;
+            this->write_header(h);
+            return m_file.sync(0, m_file.size());
+        }
+        if (this->valid()) {
+            return true;
+        }
+        if (!this->upgrade(path)) {
+            m_file.close();
+            return false;
+        }
+        return true;
+    }
+
+    // accept_key_version lets open() take files whose keys follow version
+    // besides the current cgx::parameter::key_version, so that
+    // unique_parameter_list::migrate() can move them. Other files are
+    // refused. Call it before open().
+    void accept_key_version(uint32_t version) {
+        m_accepted = _key_version(version);
+    }
+
+    void close() {
+        m_file.close();
+    }
+
+    bool is_open() const {
+        return m_file.is_open();
+    }
+
+    bool read(uid_value_t uid, uint8_t* dst, size_t len) const {
+        const uint8_t* src = this->view(uid, len);
+        if (src == nullptr) {
+            return false;
+        }
+        std::memcpy(dst, src, len);
+        return true;
+    }
+
+    // view returns the mapped payload of uid if it exists with the given
+    // size and its CRC checks out, or nullptr otherwise.
+    uint8_t* view(uid_value_t uid, size_t len) const {
+        const entry_t* e = this->find(uid);
+        if (e == nullptr || e->size != len) {
+            return nullptr;
+        }
+        uint8_t* data = this->payload(*e);
+        if (_calc_crc(data, len) != e->crc) {
+            return nullptr;
+        }
+        return data;
+    }
+
+    bool write(uid_value_t uid, const uint8_t* src, size_t len) {
+        uint8_t* dst = this->reserve(uid, len);
+        if (dst == nullptr) {
+            return false;
+        }
+        std::memcpy(dst, src, len);
+        return this->update_crc(uid);
+    }
+
+    // read_at and write_at transfer part of an existing record. The record
+    // must pass its CRC check first; write_at then only marks the written
+    // range and the directory entry for the next flush().
+    bool read_at(
+        uid_value_t uid,
+        size_t      offset,
+        uint8_t*    dst,
+        size_t      len
+    ) const {
+        const entry_t* e = this->find(uid);
+        if (e == nullptr || !_in_range(offset, len, e->size)) {
+            return false;
+        }
+        const uint8_t* data = this->payload(*e);
+        if (_calc_crc(data, e->size) != e->crc) {
+            return false;
+        }
+        std::memcpy(dst, data + offset, len);
+        return true;
+    }
+
+    bool write_at(
+        uid_value_t    uid,
+        size_t         offset,
+        const uint8_t* src,
+        size_t         len
+    ) {
+        entry_t* e = this->find(uid);
+        if (e == nullptr || !_in_range(offset, len, e->size)) {
+            return false;
+        }
+        uint8_t* data = this->payload(*e);
+        if (_calc_crc(data, e->size) != e->crc) {
+            return false;
+        }
+        std::memcpy(data + offset, src, len);
+        e->crc = _calc_crc(data, e->size);
+        this->touch(data + offset, len);
+        this->touch(reinterpret_cast<uint8_t*>(e), sizeof(entry_t));
+        return true;
+    }
+
+    // reserve returns the in-file location of uid's payload, creating or
+    // resizing the record as needed. The location stays valid until the
+    // record is resized or the file is closed.
+    //
+    // Space is never compacted: a record that grows while others follow it
+    // moves to the end of the data area and leaves its old bytes unused, so
+    // size the data area for the resizes expected between two files.
+    uint8_t* reserve(uid_value_t uid, size_t len) {
+        if (!is_open()) {
+            return nullptr;
+        }
+        header_t h = this->header();
+        entry_t* e = this->find(uid);
+        if (e != nullptr && e->size == len) {
+            return this->payload(*e);
+        }
+
+        size_t used   = h.data_used;
+        size_t offset = used;
+        if (e != nullptr) {
+            if (e->offset + _align(e->size) == used) {
+                offset = e->offset;
+                used   = e->offset;
+            } else if (_align(len) <= _align(e->size)) {
+                offset = e->offset;
+            }
+        }
+        if (offset + _align(len) > h.data_size) {
+            return nullptr;
+        }
+        if (e == nullptr) {
+            if (h.count >= h.capacity) {
+                return nullptr;
+            }
+            e = this->insert(uid, h.count);
+            h.count += 1;
+        }
+        e->offset   = static_cast<uint32_t>(offset);
+        e->size     = static_cast<uint32_t>(len);
+        e->crc      = _calc_crc(this->payload(*e), len);
+        h.data_used =
+            static_cast<uint32_t>(std::max(used, offset + _align(len)));
+        this->write_header(h);
+
+        this->touch(reinterpret_cast<uint8_t*>(e), sizeof(entry_t));
+        return this->payload(*e);
+    }
+
+    // update_crc refreshes the directory checksum after the payload of uid
+    // was modified in place.
+    bool update_crc(uid_value_t uid) {
+        entry_t* e = this->find(uid);
+        if (e == nullptr) {
+            return false;
+        }
+        e->crc = _calc_crc(this->payload(*e), e->size);
+        this->touch(this->payload(*e), e->size);
+        this->touch(reinterpret_cast<uint8_t*>(e), sizeof(entry_t));
+        return true;
+    }
+
+    // flush writes back every page modified since the last flush.
+    bool flush() {
+        if (m_dirty_end <= m_dirty_begin) {
+            return true;
+        }
+        bool ok       = m_file.sync(m_dirty_begin, m_dirty_end - m_dirty_begin);
+        m_dirty_begin = static_cast<size_t>(-1);
+        m_dirty_end   = 0;
+        return ok;
+    }
+
+    // touch marks [ptr, ptr + size) as modified so the next flush() writes
+    // it back.
+    void touch(const uint8_t* ptr, size_t size) {
+        const size_t begin = static_cast<size_t>(ptr - m_file.data());
+        if (begin < m_dirty_begin) {
+            m_dirty_begin = begin;
+        }
+        if (begin + size > m_dirty_end) {
+            m_dirty_end = begin + size;
+        }
+    }
+
+    size_t count() const {
+        return is_open() ? this->header().count : 0;
+    }
+
+    // key_version tells how the keys in this file were derived from
+    // parameter names, see cgx::parameter::key_version.
+    uint32_t key_version() const {
+        return is_open() ? _key_version(this->header().key_version) : 0;
+    }
+
+    // set_key_version records that the keys now follow version, e.g. after
+    // unique_parameter_list::migrate() moved them to a new hash. Keys wider
+    // than the directory's UIDs are refused.
+    bool set_key_version(uint32_t version) {
+        if (!is_open() || _key_bits(version) > CGX_PARAMETER_UID_BITS) {
+            return false;
+        }
+        header_t h    = this->header();
+        h.key_version = version;
+        this->write_header(h);
+        return this->flush();
+    }
+
+    const entry_t* find(uid_value_t uid) const {
+        return const_cast<packed_file*>(this)->find(uid);
+    }
+
+    entry_t* find(uid_value_t uid) {
+        if (!is_open()) {
+            return nullptr;
+        }
+        entry_t* first = this->entries();
+        size_t   count = this->header().count;
+        // Branchless lower bound over the UID-sorted directory.
+        while (count > 1) {
+            size_t half = count / 2;
+            first       = (first[half - 1].uid < uid) ? first + half : first;
+            count -= half;
+        }
+        if (count == 1 && first->uid < uid) {
+            ++first;
+        }
+        entry_t* end = this->entries() + this->header().count;
+        return (first != end && first->uid == uid) ? first : nullptr;
+    }
+
+   private:
+    // header_v1_t is the header of version 1 files, whose directory starts
+    // right after it.
+    struct header_v1_t {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t header_size;
+        uint32_t capacity;
+        uint32_t count;
+        uint32_t data_size;
+        uint32_t data_used;
+        uint32_t key_version;
+        uint32_t crc;
+    };
+
+    // layout_t describes a file in an older layout for upgrade().
+    struct layout_t {
+        uint32_t bits;
+        uint32_t key_version;
+        uint32_t capacity;
+        uint32_t count;
+        uint32_t data_size;
+        size_t   directory;
+        size_t   data_offset;
+    };
+
+    mapped_file m_file;
+    size_t      m_dirty_begin{static_cast<size_t>(-1)};
+    size_t      m_dirty_end{0};
+    uint32_t    m_accepted{cgx::parameter::key_version};
+
+    static constexpr size_t _align(size_t size) {
+        return (size + align - 1) & ~(align - 1);
+    }
+
+    static constexpr size_t _data_offset(size_t capacity) {
+        return _align(sizeof(header_t) + capacity * sizeof(entry_t));
+    }
+
+    static constexpr size_t _file_size(size_t capacity, size_t data_size) {
+        return _data_offset(capacity) + data_size;
+    }
+
+    static uint32_t _header_crc(const header_t& h) {
+        return _calc_crc(
+            reinterpret_cast<const uint8_t*>(&h), offsetof(header_t, crc)
+        );
+    }
+
+    header_t header() const {
+        header_t h;
+        std::memcpy(&h, m_file.data(), sizeof(h));
+        return h;
+    }
+
+    void write_header(header_t h) {
+        h.crc = _header_crc(h);
+        std::memcpy(m_file.data(), &h, sizeof(h));
+        this->touch(m_file.data(), sizeof(h));
+    }
+
+    // accepts tells whether keys following the stored key version may be
+    // opened with UIDs of bits.
+    bool accepts(uint32_t stored, uint32_t bits) const {
+        const uint32_t keys = _key_version(stored);
+        return (keys == cgx::parameter::key_version || keys == m_accepted) &&
+               _key_bits(keys) <= bits;
+    }
+
+    // valid checks the header and that every directory entry lies within
+    // the data in use, so that payload() stays inside the mapping. A file
+    // with a corrupt entry goes through upgrade(), which keeps the records
+    // that check out.
+    bool valid() const {
+        if (m_file.size() < sizeof(header_t)) {
+            return false;
+        }
+        header_t h = this->header();
+        if (h.magic != magic || h.version != version ||
+            h.header_size != sizeof(header_t) || h.crc != _header_crc(h) ||
+            h.uid_bits != CGX_PARAMETER_UID_BITS ||
+            !this->accepts(h.key_version, h.uid_bits) ||
+            h.count > h.capacity || h.data_used > h.data_size ||
+            _file_size(h.capacity, h.data_size) > m_file.size()) {
+            return false;
+        }
+        const entry_t* e = this->entries();
+        for (size_t i = 0; i < h.count; ++i) {
+            if (!_in_range(e[i].offset, e[i].size, h.data_used)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // old_layout reads the header of a version 1 file, or of a file with
+    // narrower UIDs than this build, into old.
+    bool old_layout(layout_t& old) const {
+        const uint8_t* data = m_file.data();
+        if (m_file.size() < sizeof(header_t)) {
+            return false;
+        }
+        header_v1_t h1;
+        header_t    h2;
+        std::memcpy(&h1, data, sizeof(h1));
+        std::memcpy(&h2, data, sizeof(h2));
+        if (h1.magic != magic) {
+            return false;
+        }
+        if (h1.version == 1) {
+            const uint32_t crc = _calc_crc(data, offsetof(header_v1_t, crc));
+            if (h1.header_size != sizeof(h1) || h1.crc != crc) {
+                return false;
+            }
+            old = layout_t{
+                _key_bits(h1.key_version),
+                h1.key_version,
+                h1.capacity,
+                h1.count,
+                h1.data_size,
+                sizeof(h1),
+                0,
+            };
+        } else if (h2.version == version) {
+            if (h2.header_size != sizeof(h2) || h2.crc != _header_crc(h2)) {
+                return false;
+            }
+            old = layout_t{
+                h2.uid_bits,
+                h2.key_version,
+                h2.capacity,
+                h2.count,
+                h2.data_size,
+                sizeof(h2),
+                0,
+            };
+        } else {
+            return false;
+        }
+        if ((old.bits != 32 && old.bits != 64) ||
+            old.bits > CGX_PARAMETER_UID_BITS ||
+            !this->accepts(old.key_version, old.bits) ||
+            old.count > old.capacity) {
+            return false;
+        }
+        const size_t stride = old.bits == 64 ? sizeof(basic_entry_t<uint64_t>)
+                                             : sizeof(basic_entry_t<uint32_t>);
+        old.data_offset = _align(old.directory + old.capacity * stride);
+        return old.data_offset + old.data_size <= m_file.size();
+    }
+
+    // copy_entries writes every record of the old layout whose CRC checks
+    // out into next.
+    template <typename U>
+    bool copy_entries(const layout_t& old, packed_file& next) const {
+        const uint8_t* data = m_file.data();
+        for (size_t i = 0; i < old.count; ++i) {
+            basic_entry_t<U> e;
+            std::memcpy(&e, data + old.directory + i * sizeof(e), sizeof(e));
+            if (!_in_range(e.offset, e.size, old.data_size)) {
+                continue;
+            }
+            const uint8_t* payload = data + old.data_offset + e.offset;
+            if (_calc_crc(payload, e.size) != e.crc) {
+                continue;
+            }
+            if (!next.write(e.uid, payload, e.size)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // upgrade rewrites a file in an older layout, or one whose directory
+    // failed valid(), into the current one next to it, keeping its keys and
+    // the records that check out, and replaces it with rename().
+    bool upgrade(const char* path) {
+        layout_t old;
+        if (!this->old_layout(old)) {
+            return false;
+        }
+        char tmp[256 + 4];
+        int  n = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+        if (n < 0 || static_cast<size_t>(n) >= sizeof(tmp)) {
+            return false;
+        }
+        ::unlink(tmp);
+
+        bool ok;
+        {
+            packed_file next;
+            ok = next.open(tmp, old.capacity, old.data_size) &&
+                 (old.bits == 64 ? this->copy_entries<uint64_t>(old, next)
+                                 : this->copy_entries<uint32_t>(old, next));
+            if (ok) {
+                header_t h    = next.header();
+                h.key_version = old.key_version;
+                next.write_header(h);
+                ok = next.flush();
+            }
+        }
+        m_file.close();
+        if (!ok || ::rename(tmp, path) != 0) {
+            ::unlink(tmp);
+            return false;
+        }
+        return m_file.open(path, 0) && this->valid();
+    }
+
+    entry_t* entries() const {
+        return reinterpret_cast<entry_t*>(m_file.data() + sizeof(header_t));
+    }
+
+    uint8_t* payload(const entry_t& e) const {
+        return m_file.data() + _data_offset(this->header().capacity) + e.offset;
+    }
+
+    entry_t* insert(uid_value_t uid, size_t count) {
+        entry_t* e   = this->entries();
+        size_t   pos = 0;
+        while (pos < count && e[pos].uid < uid) {
+            ++pos;
+        }
+        std::memmove(e + pos + 1, e + pos, (count - pos) * sizeof(entry_t));
+        e[pos] = entry_t{uid, 0, 0, 0};
+        this->touch(
+            reinterpret_cast<uint8_t*>(e + pos),
+            (count - pos + 1) * sizeof(entry_t)
+        );
+        return e + pos;
+    }
+};
+
+// packed_file_storage keeps one packed_file per LUN, opened on first use
+// from a printf-style path pattern taking the LUN as %zu.
+class packed_file_storage : public storage_i {
+   public:
+    explicit packed_file_storage(const char* path_pattern)
+        : m_pattern(path_pattern) {
+    }
+
+    // accept_key_version lets files whose keys follow version be opened for
+    // a migration, see packed_file::accept_key_version().
+    void accept_key_version(uint32_t version) {
+        m_accepted = version;
+    }
+
+    bool begin(size_t lun) override {
+        return this->file(lun) != nullptr;
+    }
+
+    bool commit(size_t lun) override {
+        packed_file* f = this->file(lun);
+        return f != nullptr && f->flush();
+    }
+
+    bool read(size_t lun, uid_value_t uid, uint8_t* dst, size_t len) override {
+        packed_file* f = this->file(lun);
+        return f != nullptr && f->read(uid, dst, len);
+    }
+
+    bool write(
+        size_t lun, uid_value_t uid, const uint8_t* src, size_t len
+    ) override {
+        packed_file* f = this->file(lun);
+        return f != nullptr && f->write(uid, src, len);
+    }
+
+    bool read_at(
+        size_t      lun,
+        uid_value_t uid,
+        size_t      offset,
+        uint8_t*    dst,
+        size_t      len
+    ) override {
+        packed_file* f = this->file(lun);
+        return f != nullptr && f->read_at(uid, offset, dst, len);
+    }
+
+    bool write_at(
+        size_t         lun,
+        uid_value_t    uid,
+        size_t         offset,
+        const uint8_t* src,
+        size_t         len
+    ) override {
+        packed_file* f = this->file(lun);
+        return f != nullptr && f->write_at(uid, offset, src, len);
+    }
+
+    packed_file* file(size_t lun) {
+        if (lun >= m_files.size()) {
+            return nullptr;
+        }
+        packed_file& f = m_files[lun];
+        if (!f.is_open()) {
+            char path[256];
+            int  n = snprintf(path, sizeof(path), m_pattern, lun);
+            if (n < 0 || static_cast<size_t>(n) >= sizeof(path)) {
+                return nullptr;
+            }
+            f.accept_key_version(m_accepted);
+            if (!f.open(path)) {
+                return nullptr;
+            }
+        }
+        return &f;
+    }
+
+   private:
+    const char*                                             m_pattern;
+    std::array<packed_file, CGX_PARAMETER_PACKED_MAX_LUNS> m_files;
+
+    uint32_t m_accepted{cgx::parameter::key_version};
+};
+
+}  // namespace cgx::parameter
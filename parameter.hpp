@@ -1,12 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
-#include <functional>
 #include <memory>
-
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "codec.hpp"
+#include "crc.hpp"
+#include "delegate.hpp"
+#include "format.hpp"
+#include "snapshot.hpp"
+#include "storage.hpp"
+#include "subscription.hpp"
 #include "type_name.hpp"
 #include "uid.hpp"
 
@@ -14,146 +26,331 @@
 #define CGX_PARAMETER_PRINT_BUFFER_SIZE 128
 #endif
 
+// Lines printed by a whole list are batched into chunks of this size.
+#ifndef CGX_PARAMETER_PRINT_CHUNK_SIZE
+#define CGX_PARAMETER_PRINT_CHUNK_SIZE 1024
+#endif
+
+// Stack buffer used to move ranged stores and retrieves to the backend.
+#ifndef CGX_PARAMETER_CHUNK_SIZE
+#define CGX_PARAMETER_CHUNK_SIZE 64
+#endif
+
+// init() and store_all() of a list hand records to the backend's
+// read_many()/write_many() in batches of up to this many records. Batched
+// reads go through a stack buffer of CGX_PARAMETER_BATCH_SIZE bytes; larger
+// values are retrieved on their own.
+#ifndef CGX_PARAMETER_BATCH_RECORDS
+#define CGX_PARAMETER_BATCH_RECORDS 16
+#endif
+
+#ifndef CGX_PARAMETER_BATCH_SIZE
+#define CGX_PARAMETER_BATCH_SIZE 256
+#endif
+
+// Values larger than this are never copied to the stack by store(),
+// retrieve() and rekey(); they move in place or in chunks instead.
+#ifndef CGX_PARAMETER_STACK_LIMIT
+#define CGX_PARAMETER_STACK_LIMIT 256
+#endif
+
+// Budgets checked at compile time for every unique_parameter<T> in use,
+// see unique_parameter::stack_usage() and ram_usage(). Unlimited by default.
+#ifndef CGX_PARAMETER_STACK_BUDGET
+#define CGX_PARAMETER_STACK_BUDGET SIZE_MAX
+#endif
+
+#ifndef CGX_PARAMETER_RAM_BUDGET
+#define CGX_PARAMETER_RAM_BUDGET SIZE_MAX
+#endif
+
 namespace cgx {
 
-constexpr uint32_t _crc32_single_byte(uint32_t byte) {
-    uint32_t crc = byte;
-    for (int i = 0; i < 8; ++i) {
-        crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
-    }
-    return crc;
-}
+namespace parameter {
 
-constexpr std::array<uint32_t, 256> _generate_crc32_table() {
-    std::array<uint32_t, 256> table{};
-    for (uint32_t i = 0; i < 256; ++i) {
-        table[i] = _crc32_single_byte(i);
-    }
-    return table;
+// _value_to_char formats a value and its default. User types provide a
+// to_char(dst, size) member; built-in types are overloaded below.
+template <typename T>
+inline int
+_value_to_char(char* dst, size_t size, const T& value, const T& default_value) {
+    (void)default_value;
+    return value.to_char(dst, size);
 }
 
-constexpr uint32_t _init_crc32() {
-    return 0xFFFFFFFF;
+inline int
+_value_to_char(char* dst, size_t size, int value, int default_value) {
+    text_writer out(dst, size);
+    out.put_int(value).put(" (").put_int(default_value).put(')');
+    return out.terminate();
 }
 
-constexpr std::array<uint32_t, 256> _crc32_table = _generate_crc32_table();
+inline int
+_value_to_char(char* dst, size_t size, float value, float default_value) {
+    text_writer out(dst, size);
+    out.put_float(value).put(" (").put_float(default_value).put(')');
+    return out.terminate();
+}
 
-constexpr uint32_t _calc_crc(const uint8_t* data, size_t size) {
-    uint32_t crc = _init_crc32();
-    for (size_t i = 0; i < size; ++i) {
-        uint8_t byte = data[i];
-        crc          = (crc >> 8) ^ _crc32_table[(crc ^ byte) & 0xFF];
-    }
-    return crc ^ 0xFFFFFFFF;
+inline int
+_value_to_char(char* dst, size_t size, bool value, bool default_value) {
+    text_writer out(dst, size);
+    out.put_bool(value).put(" (").put_bool(default_value).put(')');
+    return out.terminate();
 }
 
-constexpr uint32_t _calc_crc(uint32_t crc, const uint8_t* data, size_t size) {
-    for (size_t i = 0; i < size; ++i) {
-        uint8_t byte = data[i];
-        crc          = (crc >> 8) ^ _crc32_table[(crc ^ byte) & 0xFF];
-    }
-    return crc ^ 0xFFFFFFFF;
+// _type_id fingerprints T by the CRC of its type name.
+template <typename T>
+constexpr uint32_t _type_id() {
+    return _calc_crc(type_name<T>());
 }
 
-namespace parameter {
+// _kind gives every parameter class an address of its own. Lists record it
+// per slot to reach the concrete class without RTTI or a virtual call.
+template <typename P>
+inline constexpr char _kind = 0;
 
 class parameter_i {
    public:
     virtual ~parameter_i() = default;
 
+    // set_bytes writes the byte image of the value. A write that changes
+    // the value notifies like set_value(): on_changed fires and typed
+    // subscribers get the old value, so retrieve(), restore() and remote
+    // writes are seen like any other change.
     virtual bool set_bytes(const uint8_t* src, size_t size) = 0;
     virtual bool get_bytes(uint8_t* dst, size_t size) const = 0;
 
+    // set_bytes_at and get_bytes_at copy size bytes at offset inside the
+    // value, e.g. one entry of a table, and notify as set_bytes() does.
+    // Implementations that cannot address part of their value keep these
+    // defaults, which fail.
+    virtual bool
+    set_bytes_at(size_t offset, const uint8_t* src, size_t size) {
+        (void)offset;
+        (void)src;
+        (void)size;
+        return false;
+    }
+    virtual bool
+    get_bytes_at(size_t offset, uint8_t* dst, size_t size) const {
+        (void)offset;
+        (void)dst;
+        (void)size;
+        return false;
+    }
+
+    // bytes points at the get_bytes() image when the value is held as is
+    // in memory, so it can be sent without a copy, and is nullptr
+    // otherwise. The bytes change with the value.
+    virtual const uint8_t* bytes() const {
+        return nullptr;
+    }
+
     virtual int  to_char(char* dst, size_t size) const = 0;
     virtual void print() const                         = 0;
 
+    // print(out) formats the same lines as print() into a shared sink, so
+    // a whole list reaches the printer in a few large chunks.
+    virtual void print(text_sink& out) const = 0;
+
     virtual void reset() = 0;
 
     virtual uint32_t get_crc() const = 0;
 
-    virtual void on_changed(std::function<void()> callback) {
+    virtual void on_changed(delegate<void()> callback) {
         m_on_changed = callback;
     }
 
+    // on_dirty is called whenever the value may have changed, including
+    // through update(). Owners use it to know which cached CRCs are stale
+    // without rehashing every parameter.
+    virtual void on_dirty(delegate<void()> callback) {
+        m_on_dirty = callback;
+    }
+
+    // hold defers on_changed until release(). However often the value
+    // changes in between, the callback fires at most once.
+    void hold() {
+        m_held = true;
+    }
+
+    // release ends a hold. With notify unset a held change is dropped, e.g.
+    // after the value was rolled back.
+    void release(bool notify = true) {
+        m_held             = false;
+        const bool pending = m_pending.exchange(false);
+        if (notify && pending && m_on_changed) {
+            m_on_changed();
+        }
+        this->release_subscribers(notify);
+    }
+
    protected:
-    std::function<void()> m_on_changed;
+    delegate<void()> m_on_changed;
+    delegate<void()> m_on_dirty;
+
+    // The flags are atomic because concurrent<T> writers mark and notify
+    // from their own threads while the list holds and releases.
+    mutable uint32_t          m_crc{0};
+    mutable std::atomic<bool> m_crc_dirty{true};
+
+    std::atomic<bool> m_held{false};
+    std::atomic<bool> m_pending{false};
+
+    parameter_i() = default;
+    parameter_i(const parameter_i& other)
+        : m_on_changed(other.m_on_changed)
+        , m_on_dirty(other.m_on_dirty)
+        , m_crc(other.m_crc)
+        , m_crc_dirty(other.m_crc_dirty.load())
+        , m_held(other.m_held.load())
+        , m_pending(other.m_pending.load()) {
+    }
+    parameter_i& operator=(const parameter_i& other) {
+        m_on_changed = other.m_on_changed;
+        m_on_dirty   = other.m_on_dirty;
+        m_crc        = other.m_crc;
+        m_crc_dirty  = other.m_crc_dirty.load();
+        m_held       = other.m_held.load();
+        m_pending    = other.m_pending.load();
+        return *this;
+    }
+
+    // print_with runs print(out) over a stack buffer flushed to print.
+    void print_with(const delegate<void(const char*)>& print) const {
+        if (!print) {
+            return;
+        }
+        char      buffer[CGX_PARAMETER_PRINT_BUFFER_SIZE];
+        text_sink out(buffer, sizeof(buffer), print);
+        this->print(out);
+    }
+
+    // print_line writes to_char() as one line of out.
+    void print_line(text_sink& out) const {
+        out.line([this](text_writer& line) {
+            line.append([this](char* dst, size_t size) {
+                return this->to_char(dst, size);
+            });
+        });
+    }
+
+    // release_subscribers lets typed parameters hand release() on to their
+    // subscriptions.
+    virtual void release_subscribers(bool notify) {
+        (void)notify;
+    }
+
+    // notify_changed fires on_changed, or marks it pending while held. A
+    // release() between the two loads of m_held may miss the pending flag;
+    // whichever side takes the flag back fires the callback.
+    void notify_changed() {
+        if (m_held) {
+            m_pending = true;
+            if (m_held || !m_pending.exchange(false)) {
+                return;
+            }
+        }
+        if (m_on_changed) {
+            m_on_changed();
+        }
+    }
+
+    void mark_dirty() {
+        m_crc_dirty = true;
+        if (m_on_dirty) {
+            m_on_dirty();
+        }
+    }
 };
 
 template <typename T>
 class parameter : virtual public parameter_i {
    public:
     parameter() = default;
-    parameter(std::function<void(const char*)> print, const T& default_value)
+    parameter(delegate<void(const char*)> print, const T& default_value)
         : m_default(default_value), m_print(print) {
     }
     parameter(const parameter&) = default;
     virtual ~parameter()        = default;
 
+    // Subscribers are handed the old value of a change from a copy on the
+    // stack. Values above CGX_PARAMETER_STACK_LIMIT are saved into the
+    // subscriptions instead, which keep a copy anyway.
+    static constexpr bool save_old = sizeof(T) > CGX_PARAMETER_STACK_LIMIT;
+
+    // Budget figures for unique_parameter::stack_usage(): the value is one
+    // block that may be stored and retrieved in place, a change copies the
+    // old value for subscribers unless save_old is set, and
+    // decode_in_place() needs nothing beyond that.
+    static constexpr bool   in_place           = true;
+    static constexpr size_t value_stack        = save_old ? 0 : sizeof(T);
+    static constexpr size_t decode_place_stack = 0;
+
     bool set_bytes(const uint8_t* src, size_t size) override {
-        if (size != sizeof(T)) {
+        return size == sizeof(T) && this->set_bytes_at(0, src, size);
+    }
+
+    bool get_bytes(uint8_t* dst, size_t size) const override {
+        return size == sizeof(T) && this->get_bytes_at(0, dst, size);
+    }
+
+    const uint8_t* bytes() const override {
+        return reinterpret_cast<const uint8_t*>(&m_value);
+    }
+
+    bool
+    set_bytes_at(size_t offset, const uint8_t* src, size_t size) override {
+        if (!_in_range(offset, size, sizeof(T))) {
             return false;
         }
-        std::memcpy(&m_value, src, sizeof(T));
+        auto* bytes = reinterpret_cast<uint8_t*>(&m_value);
+        if (std::memcmp(bytes + offset, src, size) == 0) {
+            return true;
+        }
+        this->change([this, bytes, offset, src, size]() {
+            std::memcpy(bytes + offset, src, size);
+            this->mark_dirty();
+            return true;
+        });
         return true;
     }
 
-    bool get_bytes(uint8_t* dst, size_t size) const override {
-        if (size != sizeof(T)) {
+    bool
+    get_bytes_at(size_t offset, uint8_t* dst, size_t size) const override {
+        if (!_in_range(offset, size, sizeof(T))) {
             return false;
         }
-        std::memcpy(dst, &m_value, sizeof(T));
+        auto* bytes = reinterpret_cast<const uint8_t*>(&m_value);
+        std::memcpy(dst, bytes + offset, size);
         return true;
     }
 
     int to_char(char* dst, size_t size) const override {
-        return m_value.to_char(dst, size);
+        return _value_to_char(dst, size, m_value, m_default);
     }
 
     uint32_t get_crc() const override {
-        uint32_t crc = _init_crc32();
-
-        crc = _calc_crc(
-            crc, reinterpret_cast<const uint8_t*>(&m_value), sizeof(T)
-        );
-
-        return crc;
+        if (this->m_crc_dirty) {
+            this->m_crc = _calc_crc(
+                _init_crc32(),
+                reinterpret_cast<const uint8_t*>(&m_value),
+                sizeof(T)
+            );
+            this->m_crc_dirty = false;
+        }
+        return this->m_crc;
     }
 
     void print() const override {
-        if (m_print == nullptr) {
-            return;
-        }
-        char buffer[CGX_PARAMETER_PRINT_BUFFER_SIZE];
-        to_char(buffer, sizeof(buffer));
-        m_print(buffer);
-
-        uint8_t bytes[sizeof(T)];
-        if (this->get_bytes(bytes, sizeof(bytes))) {
-            constexpr size_t group_size = 8;
-            char             dst[3 * group_size + 6];
-            int              n = 0;
-            for (size_t i = 0; i < sizeof(T); ++i) {
-                if (i % group_size == 0) {
-                    n += snprintf(dst + n, sizeof(dst) - n, "   + ");
-                    if (n < 0 || static_cast<size_t>(n) >= sizeof(dst)) {
-                        m_print("error");
-                        break;
-                    }
-                }
-                n += snprintf(dst + n, sizeof(dst) - n, " %02X", bytes[i]);
-                if (n < 0 || static_cast<size_t>(n) >= sizeof(dst)) {
-                    m_print("error");
-                    break;
-                }
-                if (i % group_size == group_size - 1) {
-                    m_print(dst);
-                    n = 0;
-                }
-            }
-            if (n > 0) {
-                m_print(dst);
-            }
-        }
+        this->print_with(m_print);
+    }
+
+    void print(text_sink& out) const override {
+        this->print_line(out);
+        _print_hex(
+            out, "   + ", reinterpret_cast<const uint8_t*>(&m_value), sizeof(T)
+        );
     }
 
     operator T() const {
@@ -168,18 +365,32 @@ class parameter : virtual public parameter_i {
     const T& value() const {
         return m_value;
     }
-    T& value() {
-        return m_value;
+
+    // update lets f modify the value where it lives, e.g. to call a member
+    // of a class type, then invalidates the cached CRC and notifies if the
+    // bytes changed. There is no mutable value(): a CRC taken while the
+    // caller still held the reference would be cached stale, and store()
+    // would then skip the write.
+    template <typename F>
+    void update(F&& f) {
+        const uint32_t crc = this->get_crc();
+        this->change([this, &f, crc]() {
+            f(m_value);
+            this->mark_dirty();
+            return this->get_crc() != crc;
+        });
     }
 
+    // set_value hands subscribers the old value as described at save_old.
     bool set_value(const T& value) {
         if (m_value == value) {
             return true;
         }
-        m_value = value;
-        if (m_on_changed) {
-            m_on_changed();
-        }
+        this->change([this, &value]() {
+            m_value = value;
+            this->mark_dirty();
+            return true;
+        });
         return true;
     }
 
@@ -187,172 +398,298 @@ class parameter : virtual public parameter_i {
         set_value(m_default);
     }
 
-    void set_print(std::function<void(const char*)> print) {
+    void set_print(delegate<void(const char*)> print) {
         m_print = print;
     }
 
+    // subscribe adds sub to the subscribers of this parameter. It stays
+    // subscribed until it is destroyed or unsubscribe() is called.
+    void subscribe(subscription<T>& sub) {
+        m_subscribers.add(sub, *this, m_value);
+    }
+
    protected:
-    T                                m_default{};
-    T                                m_value{m_default};
-    std::function<void(const char*)> m_print{nullptr};
-};
+    T                           m_default{};
+    T                           m_value{m_default};
+    delegate<void(const char*)> m_print{nullptr};
+    _subscribers<T>             m_subscribers;
+
+    // change runs apply(), which changes the value in place, marks it
+    // dirty and returns whether it changed, then notifies. Subscribers get
+    // the old value as described at save_old.
+    template <typename F>
+    bool change(F&& apply) {
+        if (!m_subscribers) {
+            if (!apply()) {
+                return false;
+            }
+            this->notify_changed();
+        } else if constexpr (save_old) {
+            m_subscribers.save(m_value);
+            if (!apply()) {
+                return false;
+            }
+            this->notify_changed();
+            m_subscribers.publish(this->m_held);
+        } else {
+            const T old_value = m_value;
+            if (!apply()) {
+                return false;
+            }
+            this->notify_changed();
+            m_subscribers.publish(this->m_held, old_value);
+        }
+        return true;
+    }
 
-template <>
-inline int parameter<int>::to_char(char* dst, size_t size) const {
-    return snprintf(dst, size, "%d (%d)", m_value, m_default);
-}
+    // load_in_place lets load(bytes) overwrite the value where it lives,
+    // e.g. from a backend, and notifies as set_bytes() does. Putting back
+    // the old value after a load that failed part way would need a copy
+    // that streamed values do not fit on the stack, so such a load leaves
+    // the default instead, with or without subscribers. A load that fails
+    // before writing leaves the value unchanged.
+    template <typename F>
+    bool load_in_place(F&& load) {
+        const uint32_t crc = this->get_crc();
+        bool           ok  = false;
+        this->change([this, &load, &ok, crc]() {
+            ok = load(reinterpret_cast<uint8_t*>(&m_value));
+            this->mark_dirty();
+            if (!ok && this->get_crc() != crc) {
+                m_value = m_default;
+                this->mark_dirty();
+            }
+            return this->get_crc() != crc;
+        });
+        return ok;
+    }
 
-template <>
-inline int parameter<float>::to_char(char* dst, size_t size) const {
-    return snprintf(dst, size, "%f (%f)", m_value, m_default);
-}
+    // decode_in_place decodes over the live value instead of into a copy,
+    // for values too large for the stack. A failed decode is handled as by
+    // load_in_place().
+    bool decode_in_place(value_reader& in) {
+        return this->load_in_place([this, &in](uint8_t*) {
+            return codec<T>::decode(in, m_value);
+        });
+    }
+
+    void release_subscribers(bool notify) override {
+        m_subscribers.release(notify);
+    }
+};
 
-template <>
-inline int parameter<bool>::to_char(char* dst, size_t size) const {
-    return snprintf(
-        dst,
-        size,
-        "%s (%s)",
-        m_value ? "true" : "false",
-        m_default ? "true" : "false"
-    );
-}
 
+// Arrays keep their values and defaults in two contiguous std::array<T, N>
+// and share the callbacks in parameter_i. Elements are reached through the
+// lightweight element proxy, so bulk copies and the CRC work on one block.
 template <typename T, size_t N>
 class parameter<std::array<T, N>> : virtual public parameter_i {
    public:
+    // element refers to one entry of the array. Writes through it compare,
+    // assign and notify like parameter<T>::set_value().
+    class element {
+       public:
+        element(parameter<std::array<T, N>>& owner, size_t index)
+            : m_owner(&owner), m_index(index) {
+        }
+        element(const element&) = default;
+
+        operator const T&() const {
+            return this->value();
+        }
+
+        element& operator=(const T& value) {
+            set_value(value);
+            return *this;
+        }
+
+        element& operator=(const element& other) {
+            set_value(other.value());
+            return *this;
+        }
+
+        const T& value() const {
+            return m_owner->m_value[m_index];
+        }
+
+        bool set_value(const T& value) {
+            return m_owner->set_value(m_index, value);
+        }
+
+        void reset() {
+            set_value(m_owner->m_default[m_index]);
+        }
+
+        int to_char(char* dst, size_t size) const {
+            return _value_to_char(
+                dst, size, this->value(), m_owner->m_default[m_index]
+            );
+        }
+
+        bool get_bytes(uint8_t* dst, size_t size) const {
+            return m_owner->get_bytes(m_index, dst, size);
+        }
+
+       private:
+        friend class parameter<std::array<T, N>>;
+
+        parameter<std::array<T, N>>* m_owner;
+        size_t                       m_index;
+    };
+
+    // iterator keeps the element it points at, so that range-for loops can
+    // bind `auto&` to it.
+    class iterator {
+       public:
+        iterator(parameter<std::array<T, N>>& owner, size_t index)
+            : m_element(owner, index) {
+        }
+
+        element& operator*() {
+            return m_element;
+        }
+        element* operator->() {
+            return &m_element;
+        }
+
+        iterator& operator++() {
+            ++m_element.m_index;
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const {
+            return m_element.m_index == other.m_element.m_index;
+        }
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+
+       private:
+        element m_element;
+    };
+
     parameter() = default;
-    parameter(std::function<void(const char*)> print, const T& default_value)
+    parameter(delegate<void(const char*)> print, const T& default_value)
         : m_print(print) {
-        std::fill(
-            m_value.begin(), m_value.end(), parameter<T>(m_print, default_value)
-        );
+        m_default.fill(default_value);
+        m_value = m_default;
     }
     parameter(
-        std::function<void(const char*)> print,
-        const std::array<T, N>&          default_value
+        delegate<void(const char*)> print,
+        const std::array<T, N>&     default_value
     )
-        : m_print(print) {
-        size_t i = 0;
-        for (auto& value : m_value) {
-            value = parameter<T>(m_print, default_value[i++]);
-        }
+        : m_default(default_value), m_value(default_value), m_print(print) {
     }
     parameter(const parameter&) = default;
     virtual ~parameter()        = default;
 
+    // Budget figures for unique_parameter::stack_usage(). Subscribers get
+    // changed ranges, so set_value() copies nothing, and decode_in_place()
+    // keeps one element.
+    static constexpr bool   in_place           = true;
+    static constexpr size_t value_stack        = 0;
+    static constexpr size_t decode_place_stack = sizeof(T);
+
     bool set_bytes(const uint8_t* src, size_t size) override {
-        (void)src;
-        (void)size;
-        // if (size != sizeof(std::array<T, N>)) {
-        //     return false;
-        // }
-        // set_value(*reinterpret_cast<const std::array<T, N>*>(src));
-        return true;
+        return size == sizeof(std::array<T, N>) &&
+               this->set_bytes_at(0, src, size);
     }
 
     bool get_bytes(uint8_t* dst, size_t size) const override {
-        if (size != sizeof(std::array<T, N>)) {
+        return size == sizeof(std::array<T, N>) &&
+               this->get_bytes_at(0, dst, size);
+    }
+
+    const uint8_t* bytes() const override {
+        return reinterpret_cast<const uint8_t*>(m_value.data());
+    }
+
+    bool get_bytes(size_t index, uint8_t* dst, size_t size) const {
+        return index < N && size == sizeof(T) &&
+               this->get_bytes_at(index * sizeof(T), dst, size);
+    }
+
+    // The ranged overloads copy the elements [first, last), which take
+    // (last - first) * sizeof(T) bytes.
+    bool
+    set_bytes(size_t first, size_t last, const uint8_t* src, size_t size) {
+        if (first > last || last > N || size != (last - first) * sizeof(T)) {
+            return false;
+        }
+        return this->set_bytes_at(first * sizeof(T), src, size);
+    }
+
+    bool
+    get_bytes(size_t first, size_t last, uint8_t* dst, size_t size) const {
+        if (first > last || last > N || size != (last - first) * sizeof(T)) {
+            return false;
+        }
+        return this->get_bytes_at(first * sizeof(T), dst, size);
+    }
+
+    bool
+    set_bytes_at(size_t offset, const uint8_t* src, size_t size) override {
+        if (!_in_range(offset, size, sizeof(std::array<T, N>))) {
             return false;
         }
-        for (auto& value : m_value) {
-            value.get_bytes(dst, sizeof(T));
-            dst += sizeof(T);
+        auto* bytes = reinterpret_cast<uint8_t*>(m_value.data());
+        if (size == 0 || std::memcmp(bytes + offset, src, size) == 0) {
+            return true;
         }
+        std::memcpy(bytes + offset, src, size);
+        this->changed(
+            offset / sizeof(T), (offset + size - 1) / sizeof(T) + 1
+        );
         return true;
     }
 
-    bool get_bytes(size_t index, uint8_t* dst, size_t size) const {
-        if (index >= N) {
+    bool
+    get_bytes_at(size_t offset, uint8_t* dst, size_t size) const override {
+        if (!_in_range(offset, size, sizeof(std::array<T, N>))) {
             return false;
         }
-        return m_value[index].get_bytes(dst, size);
+        auto* bytes = reinterpret_cast<const uint8_t*>(m_value.data());
+        std::memcpy(dst, bytes + offset, size);
+        return true;
     }
 
     uint32_t get_crc() const override {
-        uint32_t crc = _init_crc32();
-
-        for (const auto& value : m_value) {
-            crc = _calc_crc(
-                crc, reinterpret_cast<const uint8_t*>(&value), sizeof(T)
+        if (this->m_crc_dirty) {
+            this->m_crc = _calc_crc(
+                _init_crc32(),
+                reinterpret_cast<const uint8_t*>(m_value.data()),
+                sizeof(std::array<T, N>)
             );
+            this->m_crc_dirty = false;
         }
-
-        return crc;
+        return this->m_crc;
     }
 
     int to_char(char* dst, size_t size) const override {
-        int n = snprintf(dst, size, "array<%zu>", N);
-        if (n < 0) {
-            return n;
-        }
-        if (n >= size) {
-            return n;
-        }
-        return n;
+        text_writer out(dst, size);
+        out.put("array<").put_uint(N).put('>');
+        return out.terminate();
     }
 
     void print() const override {
-        if (m_print == nullptr) {
-            return;
-        }
-        [&]() {
-            char buffer[CGX_PARAMETER_PRINT_BUFFER_SIZE];
-            int  n = this->to_char(buffer, sizeof(buffer));
-            if (n < 0) {
-                m_print("error");
-                return;
-            }
-            if (n >= sizeof(buffer)) {
-                m_print("buffer overflow");
-                return;
-            }
-            m_print(buffer);
-        }();
+        this->print_with(m_print);
+    }
 
-        char buffer[CGX_PARAMETER_PRINT_BUFFER_SIZE];
+    void print(text_sink& out) const override {
+        this->print_line(out);
         for (size_t i = 0; i < N; ++i) {
-            int n = snprintf(
-                buffer, sizeof(buffer), "  |- [%*zu] ", N <= 10 ? 1 : 2, i
+            out.line([this, i](text_writer& line) {
+                line.put("  |- [").put_uint(i, N <= 10 ? 1 : 2).put("] ");
+                line.append([this, i](char* dst, size_t size) {
+                    return _value_to_char(dst, size, m_value[i], m_default[i]);
+                });
+            });
+            _print_hex(
+                out,
+                "  |   + ",
+                reinterpret_cast<const uint8_t*>(&m_value[i]),
+                sizeof(T)
             );
-            if (n < 0 || n >= sizeof(buffer)) {
-                continue;
-            }
-
-            n += m_value[i].to_char(buffer + n, sizeof(buffer) - n);
-            if (n < 0 || n >= sizeof(buffer)) {
-                continue;
-            }
-
-            m_print(buffer);
-
-            uint8_t bytes[sizeof(T)];
-            if (m_value[i].get_bytes(bytes, sizeof(bytes))) {
-                constexpr size_t group_size = 8;
-                char             dst[3 * group_size + 9];
-                int              n = 0;
-                for (size_t i = 0; i < sizeof(T); ++i) {
-                    if (i % group_size == 0) {
-                        n += snprintf(dst + n, sizeof(dst) - n, "  |   + ");
-                        if (n < 0 || n >= sizeof(dst)) {
-                            m_print("error");
-                            break;
-                        }
-                    }
-                    n += snprintf(dst + n, sizeof(dst) - n, " %02X", bytes[i]);
-                    if (n < 0 || n >= sizeof(dst)) {
-                        m_print("error");
-                        break;
-                    }
-                    if (i % group_size == group_size - 1) {
-                        m_print(dst);
-                        n = 0;
-                    }
-                }
-                if (n > 0) {
-                    m_print(dst);
-                }
-            }
         }
     }
 
@@ -370,20 +707,24 @@ class parameter<std::array<T, N>> : virtual public parameter_i {
         return *this;
     }
 
-    parameter<T>& operator[](size_t index) {
+    element operator[](size_t index) {
+        assert(index < N);
+        return element(*this, index);
+    }
+    const T& operator[](size_t index) const {
         assert(index < N);
         return m_value[index];
     }
 
-    auto begin() {
-        return m_value.begin();
+    iterator begin() {
+        return iterator(*this, 0);
     }
     auto begin() const {
         return m_value.begin();
     }
 
-    auto end() {
-        return m_value.end();
+    iterator end() {
+        return iterator(*this, N);
     }
     auto end() const {
         return m_value.end();
@@ -392,46 +733,140 @@ class parameter<std::array<T, N>> : virtual public parameter_i {
     const std::array<T, N>& value() const {
         return m_value;
     }
-    std::array<T, N>& value() {
-        return m_value;
+
+    // update works as parameter<T>::update(). Subscribers are told the
+    // whole array changed.
+    template <typename F>
+    void update(F&& f) {
+        const uint32_t crc = this->get_crc();
+        f(m_value);
+        this->mark_dirty();
+        if (this->get_crc() != crc) {
+            this->changed(0, N);
+        }
+    }
+
+    bool set_value(size_t index, const T& value) {
+        if (index >= N) {
+            return false;
+        }
+        if (m_value[index] == value) {
+            return true;
+        }
+        m_value[index] = value;
+        this->changed(index, index + 1);
+        return true;
     }
 
     bool set_value(const std::array<T, N>& value) {
+        size_t first = N;
+        size_t last  = 0;
         for (size_t i = 0; i < N; ++i) {
-            m_value[i] = value[i];
+            if (!(m_value[i] == value[i])) {
+                m_value[i] = value[i];
+                first      = std::min(first, i);
+                last       = i + 1;
+            }
+        }
+        if (first < last) {
+            this->changed(first, last);
         }
         return true;
     }
 
     bool set_value(const T& value) {
+        size_t first = N;
+        size_t last  = 0;
         for (size_t i = 0; i < N; ++i) {
-            m_value[i] = value;
+            if (!(m_value[i] == value)) {
+                m_value[i] = value;
+                first      = std::min(first, i);
+                last       = i + 1;
+            }
+        }
+        if (first < last) {
+            this->changed(first, last);
         }
         return true;
     }
 
     void reset() override {
-        for (auto& value : m_value) {
-            value.reset();
+        set_value(m_default);
+    }
+
+    void set_print(delegate<void(const char*)> print) {
+        m_print = print;
+    }
+
+    // subscribe adds sub to the subscribers of this parameter. Array
+    // subscriptions are told which range of elements changed.
+    void subscribe(subscription<std::array<T, N>>& sub) {
+        m_subscribers.add(sub, *this);
+    }
+
+   protected:
+    std::array<T, N>               m_default{};
+    std::array<T, N>               m_value{};
+    delegate<void(const char*)>    m_print{nullptr};
+    _subscribers<std::array<T, N>> m_subscribers;
+
+    void changed(size_t first, size_t last) {
+        this->mark_dirty();
+        this->notify_changed();
+        m_subscribers.publish(this->m_held, first, last);
+    }
+
+    // load_in_place is parameter<T>::load_in_place() without the copy:
+    // subscribers are told the whole array changed.
+    template <typename F>
+    bool load_in_place(F&& load) {
+        const uint32_t crc = this->get_crc();
+        const bool     ok  = load(reinterpret_cast<uint8_t*>(m_value.data()));
+        this->mark_dirty();
+        if (!ok && this->get_crc() != crc) {
+            m_value = m_default;
+            this->mark_dirty();
+        }
+        if (this->get_crc() != crc) {
+            this->changed(0, N);
         }
+        return ok;
     }
 
-    void on_changed(std::function<void()> callback) override {
-        for (auto& value : m_value) {
-            value.on_changed(callback);
+    // decode_in_place decodes one element at a time through
+    // set_value(index, element), holding the parameter so that the array
+    // notifies once. A malformed element leaves the ones before it decoded.
+    bool decode_in_place(value_reader& in) {
+        if (!in.begin_array()) {
+            return false;
+        }
+        const bool held = this->m_held;
+        bool       ok   = true;
+        this->hold();
+        for (size_t i = 0; i < N; ++i) {
+            T element = m_value[i];
+            if (!in.next_element() || !codec<T>::decode(in, element)) {
+                ok = false;
+                break;
+            }
+            this->set_value(i, element);
         }
+        if (!held) {
+            this->release();
+        }
+        return ok && !in.next_element() && in.ok();
     }
 
-   protected:
-    std::function<void(const char*)> m_print{nullptr};
-    std::array<parameter<T>, N>      m_value;
+    void release_subscribers(bool notify) override {
+        m_subscribers.release(notify);
+    }
 };
 
 template <size_t N>
 class parameter<char[N]> : virtual public parameter_i {
    public:
     parameter() = default;
-    parameter(std::function<void(const char*)> print, const char* default_value)
+    parameter(delegate<void(const char*)> print, const char* default_value)
         : m_print(print) {
         std::copy(default_value, default_value + N, m_default);
         set_value(default_value);
@@ -439,6 +874,13 @@ class parameter<char[N]> : virtual public parameter_i {
     parameter(const parameter&) = default;
     virtual ~parameter()        = default;
 
+    // Budget figures for unique_parameter::stack_usage(), as for
+    // parameter<T>.
+    static constexpr bool   save_old           = N > CGX_PARAMETER_STACK_LIMIT;
+    static constexpr bool   in_place           = true;
+    static constexpr size_t value_stack        = save_old ? 0 : N;
+    static constexpr size_t decode_place_stack = 0;
+
     bool set_bytes(const uint8_t* src, size_t size) override {
         if (size != N) {
             return false;
@@ -451,57 +893,67 @@ class parameter<char[N]> : virtual public parameter_i {
         if (size != N) {
             return false;
         }
-        std::copy(m_value, m_value + N, dst);
+        std::memcpy(dst, m_value, N);
         return true;
     }
 
-    int to_char(char* dst, size_t size) const override {
-        return snprintf(dst, size, "%s (%s)", m_value, m_default);
+    const uint8_t* bytes() const override {
+        return reinterpret_cast<const uint8_t*>(m_value);
     }
 
-    uint32_t get_crc() const override {
-        uint32_t crc = _init_crc32();
+    bool
+    set_bytes_at(size_t offset, const uint8_t* src, size_t size) override {
+        if (!_in_range(offset, size, N)) {
+            return false;
+        }
+        // The last byte stays the terminator.
+        const size_t n = size > 0 && offset + size == N ? size - 1 : size;
+        if (std::memcmp(m_value + offset, src, n) == 0) {
+            return true;
+        }
+        this->change([this, offset, src, n]() {
+            std::memcpy(m_value + offset, src, n);
+            this->mark_dirty();
+            return true;
+        });
+        return true;
+    }
 
-        crc = _calc_crc(crc, reinterpret_cast<const uint8_t*>(m_value), N);
+    bool
+    get_bytes_at(size_t offset, uint8_t* dst, size_t size) const override {
+        if (!_in_range(offset, size, N)) {
+            return false;
+        }
+        std::copy(m_value + offset, m_value + offset + size, dst);
+        return true;
+    }
 
-        return crc;
+    int to_char(char* dst, size_t size) const override {
+        text_writer out(dst, size);
+        out.put(m_value).put(" (");
+        out.put(std::string_view(m_default, strnlen(m_default, N))).put(')');
+        return out.terminate();
     }
 
-    void print() const override {
-        if (m_print == nullptr) {
-            return;
-        }
-        char buffer[CGX_PARAMETER_PRINT_BUFFER_SIZE];
-        to_char(buffer, sizeof(buffer));
-        m_print(buffer);
-
-        uint8_t bytes[N];
-        if (this->get_bytes(bytes, sizeof(bytes))) {
-            constexpr size_t group_size = 8;
-            char             dst[3 * group_size + 6];
-            int              n = 0;
-            for (size_t i = 0; i < N; ++i) {
-                if (i % group_size == 0) {
-                    n += snprintf(dst + n, sizeof(dst) - n, "   + ");
-                    if (n < 0 || static_cast<size_t>(n) >= sizeof(dst)) {
-                        m_print("error");
-                        break;
-                    }
-                }
-                n += snprintf(dst + n, sizeof(dst) - n, " %02X", bytes[i]);
-                if (n < 0 || static_cast<size_t>(n) >= sizeof(dst)) {
-                    m_print("error");
-                    break;
-                }
-                if (i % group_size == group_size - 1) {
-                    m_print(dst);
-                    n = 0;
-                }
-            }
-            if (n > 0) {
-                m_print(dst);
-            }
+    uint32_t get_crc() const override {
+        if (this->m_crc_dirty) {
+            this->m_crc = _calc_crc(
+                _init_crc32(), reinterpret_cast<const uint8_t*>(m_value), N
+            );
+            this->m_crc_dirty = false;
         }
+        return this->m_crc;
+    }
+
+    void print() const override {
+        this->print_with(m_print);
+    }
+
+    void print(text_sink& out) const override {
+        this->print_line(out);
+        _print_hex(
+            out, "   + ", reinterpret_cast<const uint8_t*>(m_value), N
+        );
     }
 
     operator const char*() const {
@@ -517,19 +969,22 @@ class parameter<char[N]> : virtual public parameter_i {
         return m_value;
     }
 
+    // set_value hands subscribers the old string as
+    // parameter<T>::set_value() does.
     bool set_value(const char* value) {
         if (strcmp(m_value, value) == 0) {
             return true;
         }
-        size_t len = strlen(value);
-        if (len >= N) {
-            len = N - 1;
-        }
-        std::copy(value, value + len + 1, m_value);
-        m_value[N - 1] = '\0';
-        if (m_on_changed) {
-            m_on_changed();
-        }
+        this->change([this, value]() {
+            size_t len = strlen(value);
+            if (len >= N) {
+                len = N - 1;
+            }
+            std::copy(value, value + len + 1, m_value);
+            m_value[N - 1] = '\0';
+            this->mark_dirty();
+            return true;
+        });
         return true;
     }
 
@@ -537,14 +992,105 @@ class parameter<char[N]> : virtual public parameter_i {
         set_value(m_default);
     }
 
+    void subscribe(subscription<char[N]>& sub) {
+        m_subscribers.add(sub, *this, m_value);
+    }
+
    protected:
-    char                             m_default[N]{};
-    char                             m_value[N]{};
-    std::function<void(const char*)> m_print{nullptr};
+    char                        m_default[N]{};
+    char                        m_value[N]{};
+    delegate<void(const char*)> m_print{nullptr};
+    _subscribers<char[N]>       m_subscribers;
+
+    void release_subscribers(bool notify) override {
+        m_subscribers.release(notify);
+    }
+
+    // change works as parameter<T>::change().
+    template <typename F>
+    bool change(F&& apply) {
+        if (!m_subscribers) {
+            if (!apply()) {
+                return false;
+            }
+            this->notify_changed();
+        } else if constexpr (save_old) {
+            m_subscribers.save(m_value);
+            if (!apply()) {
+                return false;
+            }
+            this->notify_changed();
+            m_subscribers.publish(this->m_held);
+        } else {
+            char old_value[N];
+            std::memcpy(old_value, m_value, N);
+            if (!apply()) {
+                return false;
+            }
+            this->notify_changed();
+            m_subscribers.publish(this->m_held, old_value);
+        }
+        return true;
+    }
+
+    // load_in_place works as parameter<T>::load_in_place(). The loaded
+    // string is terminated like set_bytes_at() terminates it.
+    template <typename F>
+    bool load_in_place(F&& load) {
+        const uint32_t crc = this->get_crc();
+        bool           ok  = false;
+        this->change([this, &load, &ok, crc]() {
+            ok             = load(reinterpret_cast<uint8_t*>(m_value));
+            m_value[N - 1] = '\0';
+            this->mark_dirty();
+            if (!ok && this->get_crc() != crc) {
+                std::memcpy(m_value, m_default, N);
+                this->mark_dirty();
+            }
+            return this->get_crc() != crc;
+        });
+        return ok;
+    }
+
+    // decode_in_place reads the string over the live value, as
+    // parameter<T>::decode_in_place() does.
+    bool decode_in_place(value_reader& in) {
+        return this->load_in_place([this, &in](uint8_t*) {
+            size_t size;
+            return in.read_string(m_value, N, size);
+        });
+    }
 };
 
-extern bool set_bytes(size_t lun, uint32_t uid, const uint8_t* src, size_t len);
-extern bool get_bytes(size_t lun, uint32_t uid, uint8_t* dst, size_t len);
+// _encode_value and _decode_value pass a parameter's value through its
+// codec. Decoding goes through a copy and set_value(), so a value is only
+// changed, and subscribers notified, once it decoded completely.
+template <typename T>
+bool _encode_value(value_writer& out, const parameter<T>& param) {
+    using value_t = std::decay_t<decltype(param.value())>;
+    return codec<value_t>::encode(out, param.value());
+}
+
+template <typename T>
+bool _decode_value(value_reader& in, parameter<T>& param) {
+    const parameter<T>& current = param;
+    using value_t               = std::decay_t<decltype(current.value())>;
+    value_t value               = current.value();
+    return codec<value_t>::decode(in, value) && param.set_value(value);
+}
+
+template <size_t N>
+bool _encode_value(value_writer& out, const parameter<char[N]>& param) {
+    const char* value = param.value();
+    return out.write_string(std::string_view(value, strnlen(value, N)));
+}
+
+template <size_t N>
+bool _decode_value(value_reader& in, parameter<char[N]>& param) {
+    char   value[N];
+    size_t size;
+    return in.read_string(value, N, size) && param.set_value(value);
+}
 
 }  // namespace parameter
 
@@ -585,35 +1131,117 @@ class unique_parameter_i
    public:
     unique_parameter_i(size_t lun) : storable_parameter_i(lun) {
     }
-    virtual ~unique_parameter_i() = default;
-    virtual uint32_t uid() const  = 0;
+    virtual ~unique_parameter_i()                = default;
+    virtual parameter::uid_value_t uid() const = 0;
+    virtual std::string_view       name() const = 0;
+
+    // type_id fingerprints the value type and byte_size is the length
+    // exchanged by get_bytes()/set_bytes(). Snapshots use both to reject
+    // records of another type.
+    virtual uint32_t type_id() const   = 0;
+    virtual size_t   byte_size() const = 0;
+
+    // encode writes the value through its parameter::codec and decode reads
+    // it back, see export_values() and import_values().
+    virtual bool encode(parameter::value_writer& out) const = 0;
+    virtual bool decode(parameter::value_reader& in)        = 0;
+
+    // rekey copies the value stored under old_uid to uid(), leaving the
+    // value in RAM untouched. Returns false if there is nothing to copy.
+    virtual bool rekey(parameter::uid_value_t old_uid) = 0;
+
+    // Batched transfers for a list's init() and store_all(). pending_store
+    // fills r with the record store() would write and pending_retrieve the
+    // uid and size of the record retrieve() would read. Either returns false
+    // when the parameter has to be stored or retrieved on its own, which
+    // these defaults always do. The list then calls stored() or loaded()
+    // with the record after the backend transferred it; loaded() returns
+    // false if the record could not be applied.
+    virtual bool pending_store(parameter::const_record_t& r) const {
+        (void)r;
+        return false;
+    }
+    virtual void stored(const parameter::const_record_t& r) {
+        (void)r;
+    }
+    virtual bool pending_retrieve(parameter::record_t& r) const {
+        (void)r;
+        return false;
+    }
+    virtual bool loaded(const parameter::record_t& r) {
+        (void)r;
+        return false;
+    }
 };
 
+// unique_parameter is final so that calls on a unique_parameter<T>& are
+// bound statically; see static_parameter_list::for_each().
 template <typename T>
-class unique_parameter
+class unique_parameter final
     : public unique_parameter_i
     , public parameter::parameter<T> {
    public:
     unique_parameter() = default;
     unique_parameter(
-        std::function<void(const char*)> print,
-        const parameter::uid_t&          uid,
-        const T&                         value
+        delegate<void(const char*)> print,
+        const parameter::uid_t&     uid,
+        const T&                    value
     )
         : parameter::parameter<T>(print, value), m_uid(uid) {
     }
     unique_parameter(
-        std::function<void(const char*)> print,
-        size_t                           lun,
-        const parameter::uid_t&          uid,
-        const T&                         value
+        delegate<void(const char*)> print,
+        size_t                      lun,
+        const parameter::uid_t&     uid,
+        const T&                    value
     )
         : unique_parameter_i(lun)
         , parameter::parameter<T>(print, value)
         , m_uid(uid) {
     }
     unique_parameter(const unique_parameter&) = default;
-    virtual ~unique_parameter()               = default;
+
+    // The budgets are checked here, as the destructor is instantiated for
+    // every parameter type in use.
+    virtual ~unique_parameter() {
+        static_assert(
+            stack_usage() <= CGX_PARAMETER_STACK_BUDGET,
+            "parameter exceeds CGX_PARAMETER_STACK_BUDGET"
+        );
+        static_assert(
+            ram_usage() <= CGX_PARAMETER_RAM_BUDGET,
+            "parameter exceeds CGX_PARAMETER_RAM_BUDGET"
+        );
+    }
+
+    // Values above CGX_PARAMETER_STACK_LIMIT are stored and retrieved in
+    // place and copied between records in chunks; see store(), retrieve()
+    // and rekey().
+    static constexpr bool streamed = parameter::parameter<T>::in_place &&
+                                     sizeof(T) > CGX_PARAMETER_STACK_LIMIT;
+
+    // stack_usage is the worst case of the buffers the library keeps on the
+    // stack during one call on this parameter: value copies, transfer
+    // chunks and print buffers. Call frames are not included; -fstack-usage
+    // reports those. ram_usage is the size of the parameter, which a list
+    // places in its arena or on the heap.
+    //
+    //   static_assert(cgx::unique_parameter<table_t>::stack_usage() <= 512);
+    static constexpr size_t stack_usage() {
+        constexpr size_t copy = streamed ? 0 : sizeof(T);
+        return parameter::parameter<T>::value_stack +
+               std::max({
+                   // retrieve_range() falling back to retrieve(), or rekey()
+                   CGX_PARAMETER_CHUNK_SIZE + copy,
+                   // decode() into a copy, or in place
+                   decode_stack(),
+                   static_cast<size_t>(CGX_PARAMETER_PRINT_BUFFER_SIZE),
+               });
+    }
+
+    static constexpr size_t ram_usage() {
+        return sizeof(unique_parameter);
+    }
 
     using parameter::parameter<T>::operator=;
     using parameter::parameter<T>::value;
@@ -636,143 +1264,823 @@ class unique_parameter
         return this->store();
     }
 
+    // retrieve loads into a copy on the stack, so a failed load leaves the
+    // value untouched. Streamed values are loaded in place instead; see
+    // retrieve_in_place().
     bool retrieve() override {
-        uint8_t buffer[sizeof(T)];
-        if (!cgx::parameter::get_bytes(
-                this->get_lun(), this->uid(), buffer, sizeof(T)
-            )) {
-            return false;
+        if constexpr (streamed) {
+            return this->retrieve_in_place();
+        } else {
+            uint8_t buffer[sizeof(T)];
+            if (!cgx::parameter::load(
+                    this->get_lun(), this->uid(), buffer, sizeof(T)
+                )) {
+                return false;
+            }
+            if (!this->set_bytes(buffer, sizeof(T))) {
+                return false;
+            }
+            this->remember_stored();
+            return true;
         }
-        return this->set_bytes(buffer, sizeof(T));
     }
 
+    // store only writes when the value differs from the last one retrieved
+    // or stored, which is tracked by its CRC. The backend is never read.
+    // Streamed values are handed to the backend where they live.
     bool store() override {
-        uint8_t on_store[sizeof(T)];
-        bool    ok = cgx::parameter::get_bytes(
-            this->get_lun(), this->uid(), on_store, sizeof(T)
-        );
+        if (m_stored && m_stored_crc == this->get_crc()) {
+            return true;
+        }
 
-        uint8_t buffer[sizeof(T)];
-        if (!this->get_bytes(buffer, sizeof(T))) {
+        if constexpr (streamed) {
+            if (!cgx::parameter::save(
+                    this->get_lun(), this->uid(), this->bytes(), sizeof(T)
+                )) {
+                return false;
+            }
+        } else {
+            uint8_t buffer[sizeof(T)];
+            if (!this->get_bytes(buffer, sizeof(T)) ||
+                !cgx::parameter::save(
+                    this->get_lun(), this->uid(), buffer, sizeof(T)
+                )) {
+                return false;
+            }
+        }
+        this->remember_stored();
+        this->set_valid(true);
+        return true;
+    }
+
+    // store_range persists len bytes at offset of the value, e.g. one entry
+    // of a large table, without rewriting the rest of the record. The old
+    // bytes of the range are read back as they are overwritten, which gives
+    // the CRC of the record before the write: if it matches the last value
+    // stored, only this range had changed and the value counts as stored.
+    // Otherwise other bytes changed too, and the next store() writes the
+    // whole record. Falls back to store() when nothing was stored or
+    // retrieved yet, or when the backend cannot address part of a record.
+    bool store_range(size_t offset, size_t len) {
+        if (!parameter::_in_range(offset, len, sizeof(T))) {
             return false;
         }
+        if (!m_stored) {
+            return this->store();
+        }
+        if (m_stored_crc == this->get_crc()) {
+            return true;
+        }
 
-        if (ok) {
-            for (size_t i = 0; i < sizeof(T); i++) {
-                if (buffer[i] != on_store[i]) {
-                    ok = false;
-                    break;
-                }
+        const size_t lun = this->get_lun();
+        uint32_t     crc = _init_crc32();
+        uint8_t      chunk[CGX_PARAMETER_CHUNK_SIZE];
+        auto         fold = [this, &crc, &chunk](size_t from, size_t to) {
+            for (size_t done = from; done < to;) {
+                const size_t n = std::min(to - done, sizeof(chunk));
+                this->get_bytes_at(done, chunk, n);
+                crc   = crc32::update(crc, chunk, n);
+                done += n;
             }
-            if (ok) {
-                return true;
+        };
+
+        fold(0, offset);
+        for (size_t done = 0; done < len;) {
+            const size_t n = std::min(len - done, sizeof(chunk));
+            if (!cgx::parameter::load_at(
+                    lun, this->uid(), offset + done, chunk, n
+                )) {
+                this->forget_stored();
+                return this->store();
             }
+            crc = crc32::update(crc, chunk, n);
+            if (!this->get_bytes_at(offset + done, chunk, n) ||
+                !cgx::parameter::save_at(
+                    lun, this->uid(), offset + done, chunk, n
+                )) {
+                this->forget_stored();
+                return this->store();
+            }
+            done += n;
+        }
+        fold(offset + len, sizeof(T));
+
+        if ((crc ^ 0xFFFFFFFF) == m_stored_crc) {
+            this->remember_stored();
+        } else {
+            this->forget_stored();
         }
+        return true;
+    }
 
-        if (!cgx::parameter::set_bytes(
-                this->get_lun(), this->uid(), buffer, sizeof(T)
-            )) {
+    // retrieve_range reloads len bytes at offset of the value from the
+    // backend and notifies once for the whole range, falling back to
+    // retrieve() when the backend cannot read part of a record.
+    bool retrieve_range(size_t offset, size_t len) {
+        if (!parameter::_in_range(offset, len, sizeof(T))) {
             return false;
         }
-        this->set_valid(true);
+
+        // The chunks are applied under a hold, so the range notifies once
+        // unless the caller already holds the parameter.
+        const bool   held   = this->m_held;
+        const bool   synced = this->is_stored();
+        const size_t lun    = this->get_lun();
+        uint8_t      chunk[CGX_PARAMETER_CHUNK_SIZE];
+        bool         ok = true;
+        this->hold();
+        for (size_t done = 0; done < len;) {
+            const size_t n = std::min(len - done, sizeof(chunk));
+            if (!cgx::parameter::load_at(
+                    lun, this->uid(), offset + done, chunk, n
+                ) ||
+                !this->set_bytes_at(offset + done, chunk, n)) {
+                ok = false;
+                break;
+            }
+            done += n;
+        }
+        if (!held) {
+            this->release();
+        }
+        if (!ok) {
+            return this->retrieve();
+        }
+        if (synced) {
+            this->remember_stored();
+        }
         return true;
     }
 
-    uint32_t uid() const override {
-        return m_uid;
+    // The record to write points at the value in RAM, so values without a
+    // byte image there are stored on their own. Unchanged values are left
+    // to store(), which skips them.
+    bool pending_store(parameter::const_record_t& r) const override {
+        const uint8_t* data = this->bytes();
+        if (data == nullptr || (m_stored && m_stored_crc == this->get_crc())) {
+            return false;
+        }
+        r = {this->uid(), data, sizeof(T), false};
+        return true;
     }
 
-    int to_char(char* dst, size_t size) const override {
-        int n = snprintf(
-            dst, size, "%s %s = ", type_name<T>().data(), this->m_uid.data()
-        );
-        if (n < 0) {
-            return n;
+    void stored(const parameter::const_record_t& r) override {
+        if (r.ok) {
+            this->remember_stored();
+            this->set_valid(true);
         }
-        if (n >= static_cast<int>(size)) {
-            return n;
+    }
+
+    bool pending_retrieve(parameter::record_t& r) const override {
+        if constexpr (streamed) {
+            (void)r;
+            return false;
+        } else {
+            r = {this->uid(), nullptr, sizeof(T), false};
+            return true;
         }
+    }
 
-        n += parameter::parameter<T>::to_char(dst + n, size - n);
-        if (n < 0) {
-            return n;
+    bool loaded(const parameter::record_t& r) override {
+        if (!r.ok || !this->set_bytes(r.data, sizeof(T))) {
+            return false;
         }
-        if (n >= static_cast<int>(size)) {
-            return n;
+        this->remember_stored();
+        this->set_valid(true);
+        return true;
+    }
+
+    // Streamed values are copied in chunks, which needs a backend that can
+    // address part of a record; see rekey_chunked().
+    bool rekey(parameter::uid_value_t old_uid) override {
+        if constexpr (streamed) {
+            return this->rekey_chunked(old_uid);
+        } else {
+            const size_t lun = this->get_lun();
+            uint8_t      buffer[sizeof(T)];
+            if (!cgx::parameter::load(lun, old_uid, buffer, sizeof(T)) ||
+                !cgx::parameter::save(lun, this->uid(), buffer, sizeof(T))) {
+                return false;
+            }
+            this->forget_stored();
+            return true;
         }
+    }
+
+    // forget_stored makes the next store() write unconditionally, e.g. after
+    // the backend was modified behind the parameter's back.
+    void forget_stored() {
+        m_stored = false;
+    }
+
+    bool is_stored() const {
+        return m_stored && m_stored_crc == this->get_crc();
+    }
+
+    parameter::uid_value_t uid() const override {
+        return m_uid;
+    }
+
+    std::string_view name() const override {
+        return m_uid.get_name();
+    }
+
+    uint32_t type_id() const override {
+        return parameter::_type_id<T>();
+    }
+
+    size_t byte_size() const override {
+        return sizeof(T);
+    }
 
-        return n;
+    bool encode(parameter::value_writer& out) const override {
+        return parameter::_encode_value(out, *this);
+    }
+
+    // Streamed values are decoded in place; see decode_in_place() of
+    // parameter<T>.
+    bool decode(parameter::value_reader& in) override {
+        if constexpr (streamed) {
+            return this->decode_in_place(in);
+        } else {
+            return parameter::_decode_value(in, *this);
+        }
+    }
+
+    int to_char(char* dst, size_t size) const override {
+        parameter::text_writer out(dst, size);
+        out.put(type_name<T>().data()).put(' ');
+        out.put(m_uid.get_name()).put(" = ");
+        out.append([this](char* value, size_t room) {
+            return parameter::parameter<T>::to_char(value, room);
+        });
+        return out.terminate();
     }
 
    private:
     const parameter::uid_t m_uid{"unnamed"};
+
+    uint32_t m_stored_crc{0};
+    bool     m_stored{false};
+
+    void remember_stored() {
+        m_stored_crc = this->get_crc();
+        m_stored     = true;
+    }
+
+    static constexpr size_t decode_stack() {
+        if constexpr (streamed) {
+            return parameter::parameter<T>::decode_place_stack;
+        } else {
+            return sizeof(T);
+        }
+    }
+
+    // retrieve_in_place loads a streamed value where it lives. If the
+    // backend can read part of a record, the record is first checked to
+    // hold exactly sizeof(T) bytes, so a missing or resized one fails with
+    // the value untouched. Otherwise read() is relied on to fail before
+    // writing in those cases. A read that fails part way, e.g. on an I/O
+    // error, is handled by load_in_place().
+    bool retrieve_in_place() {
+        const size_t lun = this->get_lun();
+        uint8_t      byte;
+        if (cgx::parameter::load_at(lun, this->uid(), 0, &byte, 1) &&
+            !cgx::parameter::_record_has_size(lun, this->uid(), sizeof(T))) {
+            return false;
+        }
+        const bool ok = this->load_in_place([this, lun](uint8_t* dst) {
+            return cgx::parameter::load(lun, this->uid(), dst, sizeof(T));
+        });
+        if (ok) {
+            this->remember_stored();
+        }
+        return ok;
+    }
+
+    // rekey_chunked first writes the value in RAM under uid(), so that
+    // save_at() has a record of the right size, then copies the old record
+    // over it chunk by chunk. If the copy fails part way, the new record is
+    // written from RAM again.
+    bool rekey_chunked(parameter::uid_value_t old_uid) {
+        const size_t lun = this->get_lun();
+        uint8_t      chunk[CGX_PARAMETER_CHUNK_SIZE];
+        // The old record must end exactly at sizeof(T).
+        if (!cgx::parameter::_record_has_size(lun, old_uid, sizeof(T))) {
+            return false;
+        }
+        if (!cgx::parameter::save(lun, this->uid(), this->bytes(), sizeof(T))) {
+            return false;
+        }
+        this->forget_stored();
+        for (size_t done = 0; done < sizeof(T);) {
+            const size_t n = std::min(sizeof(T) - done, sizeof(chunk));
+            if (!cgx::parameter::load_at(lun, old_uid, done, chunk, n) ||
+                !cgx::parameter::save_at(lun, this->uid(), done, chunk, n)) {
+                cgx::parameter::save(
+                    lun, this->uid(), this->bytes(), sizeof(T)
+                );
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
 };
 
-template <size_t LUN, size_t N>
-class unique_parameter_list {
+// _crc_tracker folds (uid, crc) pairs of N slots into one list CRC with
+// XOR. Only slots marked dirty since the last fold are rehashed, so polling
+// an unchanged list reads one word per 64 slots. mark_dirty() may be called
+// from any thread, e.g. by concurrent<T> parameters; fold() from one at a
+// time.
+template <size_t N>
+class _crc_tracker {
    public:
-    unique_parameter_list() = delete;
-    unique_parameter_list(std::function<void(const char*)> print)
-        : m_print(print) {
+    void mark_dirty(size_t slot) {
+        m_dirty[slot / 64].fetch_or(
+            uint64_t{1} << (slot % 64), std::memory_order_release
+        );
     }
 
-    bool init() {
-        for (const auto& param : m_params) {
-            if (!param) {
-                continue;
+    // fold rehashes the dirty slots. param_at(slot) returns the parameter
+    // in a slot, or nullptr for an empty one.
+    template <typename F>
+    uint32_t fold(F&& param_at) {
+        for (size_t word = 0; word < m_dirty.size(); ++word) {
+            uint64_t bits =
+                m_dirty[word].exchange(0, std::memory_order_acquire);
+            for (size_t bit = 0; bits != 0; ++bit, bits >>= 1) {
+                if (bits & 1) {
+                    this->rehash(word * 64 + bit, param_at);
+                }
             }
-            if (!param->validate()) {
-                return false;
+        }
+        return m_crc;
+    }
+
+   private:
+    std::array<uint32_t, N>                          m_crcs{};
+    std::array<std::atomic<uint64_t>, (N + 63) / 64> m_dirty{};
+    uint32_t                                         m_crc{0};
+
+    template <typename F>
+    void rehash(size_t slot, F& param_at) {
+        m_crc ^= m_crcs[slot];
+        m_crcs[slot] = 0;
+
+        const unique_parameter_i* param = param_at(slot);
+        if (param != nullptr) {
+            const parameter::uid_value_t uid = param->uid();
+            const uint32_t               crc = param->get_crc();
+
+            uint8_t entry[sizeof(uid) + sizeof(crc)];
+            std::memcpy(entry, &uid, sizeof(uid));
+            std::memcpy(entry + sizeof(uid), &crc, sizeof(crc));
+            m_crcs[slot] = _calc_crc(entry, sizeof(entry));
+        }
+        m_crc ^= m_crcs[slot];
+    }
+};
+
+// _snapshot_size returns the bytes _write_snapshot() needs for the
+// parameters param_at(0..count) returns, skipping empty slots.
+template <typename F>
+size_t _snapshot_size(size_t count, F&& param_at) {
+    size_t size = parameter::snapshot_writer::overhead;
+    for (size_t i = 0; i < count; ++i) {
+        const unique_parameter_i* param = param_at(i);
+        if (param != nullptr) {
+            size += parameter::snapshot_writer::record_size(param->byte_size());
+        }
+    }
+    return size;
+}
+
+// _write_snapshot serializes the same parameters into buffer. Returns the
+// blob size, or 0 if it does not fit.
+template <typename F>
+size_t
+_write_snapshot(size_t count, F&& param_at, uint8_t* buffer, size_t size) {
+    parameter::snapshot_writer writer(buffer, size);
+    for (size_t i = 0; i < count; ++i) {
+        const unique_parameter_i* param = param_at(i);
+        if (param == nullptr) {
+            continue;
+        }
+        const size_t bytes = param->byte_size();
+        uint8_t*     payload =
+            writer.append(param->uid(), param->type_id(), bytes);
+        if (payload == nullptr || !param->get_bytes(payload, bytes)) {
+            return 0;
+        }
+    }
+    return writer.finish();
+}
+
+// _write_manifest writes a CRC manifest of the parameters, the compact
+// base a peer sends to ask for a delta. Returns its size, or 0 if it does
+// not fit.
+template <typename F>
+size_t
+_write_manifest(size_t count, F&& param_at, uint8_t* buffer, size_t size) {
+    parameter::snapshot_writer writer(buffer, size, parameter::manifest_magic);
+    for (size_t i = 0; i < count; ++i) {
+        const unique_parameter_i* param = param_at(i);
+        if (param == nullptr) {
+            continue;
+        }
+        const uint32_t crc = param->get_crc();
+        uint8_t*       payload =
+            writer.append(param->uid(), param->type_id(), sizeof(crc));
+        if (payload == nullptr) {
+            return 0;
+        }
+        std::memcpy(payload, &crc, sizeof(crc));
+    }
+    return writer.finish();
+}
+
+// _write_delta writes a snapshot of only the parameters that differ from
+// base, which is either a CRC manifest or a snapshot. Parameters missing
+// from base or stored with another type are always included. Returns the
+// delta size, or 0 if base is invalid or the delta does not fit.
+template <typename F>
+size_t _write_delta(
+    size_t         count,
+    F&&            param_at,
+    const uint8_t* base,
+    size_t         base_size,
+    uint8_t*       buffer,
+    size_t         size
+) {
+    parameter::snapshot_reader reader;
+    const bool                 manifest =
+        reader.open(base, base_size, parameter::manifest_magic);
+    if (!manifest && !reader.open(base, base_size)) {
+        return 0;
+    }
+
+    parameter::snapshot_writer           writer(buffer, size);
+    parameter::snapshot_reader::record_t record;
+    for (size_t i = 0; i < count; ++i) {
+        const unique_parameter_i* param = param_at(i);
+        if (param == nullptr) {
+            continue;
+        }
+        const size_t bytes = param->byte_size();
+        const bool   known = reader.find(param->uid(), record) &&
+                           record.type == param->type_id();
+
+        if (known && manifest) {
+            uint32_t crc;
+            if (record.size == sizeof(crc)) {
+                std::memcpy(&crc, record.data, sizeof(crc));
+                if (crc == param->get_crc()) {
+                    continue;
+                }
+            }
+        }
+
+        uint8_t* payload = writer.append(param->uid(), param->type_id(), bytes);
+        if (payload == nullptr || !param->get_bytes(payload, bytes)) {
+            return 0;
+        }
+        // Against a snapshot the bytes are compared directly; the record
+        // is dropped again when they match.
+        if (known && !manifest && record.size == bytes &&
+            std::memcmp(payload, record.data, bytes) == 0) {
+            writer.drop();
+        }
+    }
+    return writer.finish();
+}
+
+// _restore_snapshot validates the whole blob before touching any value:
+// every record must name a parameter find(uid) knows, with the same type
+// and size. Only then are the payloads applied with set_bytes().
+template <typename F>
+bool _restore_snapshot(const uint8_t* buffer, size_t size, F&& find) {
+    parameter::snapshot_reader reader;
+    if (!reader.open(buffer, size)) {
+        return false;
+    }
+
+    parameter::snapshot_reader::record_t record;
+    while (reader.next(record)) {
+        const unique_parameter_i* param = find(record.uid);
+        if (param == nullptr || param->type_id() != record.type ||
+            param->byte_size() != record.size) {
+            return false;
+        }
+    }
+
+    reader.rewind();
+    bool ok = true;
+    while (reader.next(record)) {
+        ok = find(record.uid)->set_bytes(record.data, record.size) && ok;
+    }
+    return ok;
+}
+
+// _export_values writes the parameters param_at(0..count) returns as one
+// object keyed by name, skipping empty slots.
+template <typename F>
+bool _export_values(
+    size_t                   count,
+    F&&                      param_at,
+    parameter::value_writer& out
+) {
+    size_t size = 0;
+    for (size_t slot = 0; slot < count; ++slot) {
+        size += param_at(slot) != nullptr ? 1 : 0;
+    }
+    if (!out.begin_object(size)) {
+        return false;
+    }
+    for (size_t slot = 0; slot < count; ++slot) {
+        const unique_parameter_i* param = param_at(slot);
+        if (param != nullptr &&
+            (!out.key(param->name()) || !param->encode(out))) {
+            return false;
+        }
+    }
+    return out.end_object();
+}
+
+// _import_values decodes an object written by _export_values() straight
+// into the parameters find(uid) returns. Names that hash to no parameter,
+// or collide with another one's UID, are skipped.
+template <typename F>
+bool _import_values(parameter::value_reader& in, F&& find) {
+    if (!in.begin_object()) {
+        return false;
+    }
+    char   name[CGX_PARAMETER_NAME_SIZE];
+    size_t size;
+    while (in.next_key(name, sizeof(name), size)) {
+        unique_parameter_i* param = nullptr;
+        if (size < sizeof(name)) {
+            const std::string_view key(name, size);
+            param = find(parameter::uid_t::hash(key));
+            if (param != nullptr && param->name() != key) {
+                param = nullptr;
             }
         }
+        if (param != nullptr ? !param->decode(in) : !in.skip()) {
+            return false;
+        }
+    }
+    return in.ok();
+}
+
+// _store_batched stores the parameters param_at(slot) returns for which
+// pick(param) holds, handing their records to the installed backend's
+// write_many() in batches. Parameters without a pending record, or every
+// parameter when no backend is installed, are stored one by one. Call it
+// within a transaction on lun.
+template <typename F, typename Pick>
+bool _store_batched(size_t lun, size_t count, F&& param_at, Pick&& pick) {
+    parameter::storage_i* storage = parameter::get_storage();
+
+    parameter::const_record_t records[CGX_PARAMETER_BATCH_RECORDS];
+    unique_parameter_i*       owners[CGX_PARAMETER_BATCH_RECORDS];
+    size_t                    n  = 0;
+    bool                      ok = true;
+
+    auto flush = [&]() {
+        storage->write_many(lun, records, n);
+        for (size_t i = 0; i < n; ++i) {
+            owners[i]->stored(records[i]);
+            ok = ok && records[i].ok;
+        }
+        n = 0;
+    };
 
+    for (size_t slot = 0; slot < count; ++slot) {
+        unique_parameter_i* param = param_at(slot);
+        if (param == nullptr || !pick(*param)) {
+            continue;
+        }
+        if (storage == nullptr || !param->pending_store(records[n])) {
+            ok = param->store() && ok;
+            continue;
+        }
+        owners[n++] = param;
+        if (n == CGX_PARAMETER_BATCH_RECORDS) {
+            flush();
+        }
+    }
+    if (n > 0) {
+        flush();
+    }
+    return ok;
+}
+
+// _init_batched validates the parameters param_at(slot) returns. Records
+// of parameters not yet valid are gathered into read_many() batches; those
+// that fail to load are reset and written back with _store_batched(). The
+// rest, or every parameter when no backend is installed, go through
+// validate(). Call it within a transaction on lun.
+template <typename F>
+bool _init_batched(size_t lun, size_t count, F&& param_at) {
+    parameter::storage_i* storage = parameter::get_storage();
+    if (storage == nullptr) {
+        for (size_t slot = 0; slot < count; ++slot) {
+            unique_parameter_i* param = param_at(slot);
+            if (param != nullptr && !param->validate()) {
+                return false;
+            }
+        }
         return true;
     }
 
-    void print() const {
-        for (const auto& param : m_params) {
-            if (param) {
-                param->print();
+    parameter::record_t records[CGX_PARAMETER_BATCH_RECORDS];
+    unique_parameter_i* owners[CGX_PARAMETER_BATCH_RECORDS];
+    uint8_t             buffer[CGX_PARAMETER_BATCH_SIZE];
+    size_t              n    = 0;
+    size_t              used = 0;
+
+    auto flush = [&]() {
+        storage->read_many(lun, records, n);
+        for (size_t i = 0; i < n; ++i) {
+            if (!owners[i]->loaded(records[i])) {
+                owners[i]->reset();
+            }
+        }
+        n    = 0;
+        used = 0;
+    };
+
+    for (size_t slot = 0; slot < count; ++slot) {
+        unique_parameter_i* param = param_at(slot);
+        if (param == nullptr || param->is_valid()) {
+            continue;
+        }
+        parameter::record_t r{};
+        if (!param->pending_retrieve(r) || r.size > sizeof(buffer)) {
+            if (!param->validate()) {
+                return false;
             }
+            continue;
+        }
+        if (r.size > sizeof(buffer) - used) {
+            flush();
+        }
+        r.data      = buffer + used;
+        used       += r.size;
+        records[n]  = r;
+        owners[n++] = param;
+        if (n == CGX_PARAMETER_BATCH_RECORDS) {
+            flush();
         }
     }
+    if (n > 0) {
+        flush();
+    }
 
-    uint32_t get_crc() const {
-        uint32_t crc = _init_crc32();
+    return _store_batched(lun, count, param_at, [](unique_parameter_i& p) {
+        return !p.is_valid();
+    });
+}
 
+// _batch_stack_usage is the stack _init_batched() and _store_batched() keep
+// while a parameter is stored or retrieved on its own.
+constexpr size_t _batch_stack_usage() {
+    return CGX_PARAMETER_BATCH_RECORDS *
+               (sizeof(parameter::record_t) + sizeof(void*)) +
+           CGX_PARAMETER_BATCH_SIZE;
+}
+
+// arena_size_for returns the arena bytes a unique_parameter_list needs to
+// hold one parameter of each implementation type Ps.
+template <typename... Ps>
+constexpr size_t arena_size_for() {
+    constexpr size_t align = alignof(std::max_align_t);
+    return (size_t{0} + ... + ((sizeof(Ps) + align - 1) / align * align));
+}
+
+// arena_size returns the arena bytes for one unique_parameter<T> per type,
+// e.g. unique_parameter_list<0, 2, arena_size<int, char[16]>()>.
+template <typename... Ts>
+constexpr size_t arena_size() {
+    return arena_size_for<unique_parameter<Ts>...>();
+}
+
+// _list_stack_usage adds the buffers of a list to the largest stack_usage()
+// of its parameters: print() batches lines in a chunk, import_values()
+// holds a key while a parameter decodes and init() and store_all() hold
+// batched records.
+constexpr size_t _list_stack_usage(size_t params) {
+    return std::max<size_t>({
+        CGX_PARAMETER_PRINT_CHUNK_SIZE,
+        CGX_PARAMETER_NAME_SIZE + params,
+        _batch_stack_usage() + params,
+    });
+}
+
+// unique_parameter_list owns up to N parameters stored on LUN. With the
+// default ArenaSize of 0 parameters are heap allocated; otherwise they are
+// constructed in an in-place arena of ArenaSize bytes and the list never
+// allocates.
+template <size_t LUN, size_t N, size_t ArenaSize = 0>
+class unique_parameter_list {
+   public:
+    unique_parameter_list() = delete;
+    unique_parameter_list(delegate<void(const char*)> print)
+        : m_print(print) {
+    }
+
+    // Parameters hold callbacks into the list, so it must stay in place.
+    unique_parameter_list(const unique_parameter_list&)            = delete;
+    unique_parameter_list& operator=(const unique_parameter_list&) = delete;
+
+    // init retrieves every parameter not yet valid, storing the defaults
+    // of those that fail to load, in a single backend transaction with
+    // batched reads and writes.
+    bool init() {
+        parameter::transaction batch(LUN);
+
+        const bool ok = _init_batched(LUN, m_size, [this](size_t slot) {
+            return m_params[slot].get();
+        });
+
+        return batch.commit() && ok;
+    }
+
+    // store_all persists every parameter in a single backend transaction
+    // with batched writes.
+    bool store_all() {
+        parameter::transaction batch(LUN);
+
+        const bool ok = _store_batched(
+            LUN,
+            m_size,
+            [this](size_t slot) {
+                return m_params[slot].get();
+            },
+            [](unique_parameter_i&) {
+                return true;
+            }
+        );
+
+        return batch.commit() && ok;
+    }
+
+    // print batches the lines of all parameters into chunks of
+    // CGX_PARAMETER_PRINT_CHUNK_SIZE bytes joined by '\n'.
+    void print() const {
+        char                 buffer[CGX_PARAMETER_PRINT_CHUNK_SIZE];
+        parameter::text_sink out(buffer, sizeof(buffer), m_print);
+        this->print(out);
+    }
+
+    void print(parameter::text_sink& out) const {
         for (const auto& param : m_params) {
             if (param) {
-                crc = _calc_crc(
-                    crc,
-                    reinterpret_cast<const uint8_t*>(param.get()),
-                    sizeof(*param)
-                );
+                param->print(out);
             }
         }
+    }
 
-        return crc;
+    // get_crc folds the per-parameter value CRCs together with XOR. Only
+    // parameters that reported a change since the last call are rehashed, so
+    // polling an unchanged list is O(1).
+    uint32_t get_crc() const {
+        return m_crc.fold([this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot].get());
+        });
     }
 
     template <typename T>
     auto& add(const std::string_view& name, const T& value) {
+        return this->emplace<unique_parameter<T>>(name, value);
+    }
+
+    // emplace adds a parameter of any unique_parameter_i implementation P.
+    // P is constructed from (print, LUN, uid, args...).
+    template <typename P, typename... Args>
+    P& emplace(const std::string_view& name, Args&&... args) {
         parameter::uid_t uid(name);
         if (m_size >= m_params.size()) {
             m_size -= 1;
+            this->unindex(m_params[m_size]->uid(), m_size);
             m_params[m_size++] =
-                std::make_unique<unique_parameter<T>>(m_print, LUN, uid, value);
+                this->template create<P>(uid, std::forward<Args>(args)...);
+            this->template attach<P>(m_size - 1);
+            this->index(uid, m_size - 1);
             if (m_print) {
                 m_print("parameter list full when adding:");
                 m_params[m_size - 1]->print();
             }
             assert("parameter list full" && m_size < m_params.size());
-            return *reinterpret_cast<unique_parameter<T>*>(
-                m_params[m_size - 1].get()
-            );
+            return *static_cast<P*>(m_params[m_size - 1].get());
         }
 
         auto p = this->find(uid);
         m_params[m_size++] =
-            std::make_unique<unique_parameter<T>>(m_print, LUN, uid, value);
+            this->template create<P>(uid, std::forward<Args>(args)...);
+        this->template attach<P>(m_size - 1);
+        this->index(uid, m_size - 1);
 
         if (p != nullptr) {
             if (m_print) {
@@ -781,16 +2089,17 @@ class unique_parameter_list {
                 m_params[m_size - 1]->print();
             }
             assert("UID already exists" && p == nullptr);
-            return *reinterpret_cast<unique_parameter<T>*>(
-                m_params[m_size - 1].get()
-            );
+            return *static_cast<P*>(m_params[m_size - 1].get());
         }
 
-        return *reinterpret_cast<unique_parameter<T>*>(m_params[m_size - 1].get(
-        ));
+        return *static_cast<P*>(m_params[m_size - 1].get());
     }
 
+    // reset runs in one backend transaction, so that whatever on_changed
+    // callbacks store goes out in a single batch.
     void reset() {
+        parameter::transaction batch(LUN);
+
         for (auto& param : m_params) {
             if (param) {
                 param->reset();
@@ -798,30 +2107,530 @@ class unique_parameter_list {
         }
     }
 
-    bool uid_exists(uint32_t uid) const {
+    // begin starts a list transaction. Until commit() or rollback(),
+    // on_changed callbacks and stores are held back and the values from
+    // before are kept in buffer, which must hold snapshot_size() bytes.
+    // Parameters added meanwhile join the transaction.
+    bool begin(uint8_t* buffer, size_t size) {
+        assert("nested list transaction" && m_rollback == nullptr);
+        const size_t n = this->snapshot(buffer, size);
+        if (n == 0) {
+            return false;
+        }
+        m_rollback       = buffer;
+        m_rollback_size  = n;
+        m_rollback_count = m_size;
+        for (size_t slot = 0; slot < m_size; ++slot) {
+            m_params[slot]->hold();
+        }
+        return true;
+    }
+
+    // commit persists the changes in one backend transaction, or hands them
+    // to the write-behind queue, then fires on_changed once per changed
+    // parameter. If storing fails the values are rolled back and stored
+    // again, and no callback fires.
+    bool commit() {
+        if (m_rollback == nullptr) {
+            return false;
+        }
+
+        if (m_enqueue) {
+            for (size_t slot = 0; slot < m_size; ++slot) {
+                if (m_held_dirty[slot]) {
+                    m_enqueue(m_queue, slot, m_params[slot].get());
+                }
+            }
+        } else if (!this->store_all()) {
+            this->rollback();
+            this->store_all();
+            return false;
+        }
+
+        m_rollback = nullptr;
+        for (size_t slot = 0; slot < m_size; ++slot) {
+            m_held_dirty[slot] = false;
+            m_params[slot]->release();
+        }
+        return true;
+    }
+
+    // rollback restores the values from begin() and drops held callbacks.
+    // Parameters added since begin() go back to the value they were added
+    // with.
+    void rollback() {
+        if (m_rollback == nullptr) {
+            return;
+        }
+        this->restore(m_rollback, m_rollback_size);
+        for (size_t slot = m_rollback_count; slot < m_size; ++slot) {
+            m_params[slot]->reset();
+        }
+
+        m_rollback = nullptr;
+        for (size_t slot = 0; slot < m_size; ++slot) {
+            m_held_dirty[slot] = false;
+            m_params[slot]->release(false);
+        }
+    }
+
+    bool in_transaction() const {
+        return m_rollback != nullptr;
+    }
+
+    // migrate moves stored values from the keys old_hash derives from the
+    // parameter names to their current UIDs, e.g. after changing
+    // CGX_PARAMETER_UID_HASH or CGX_PARAMETER_UID_BITS. Every parameter is
+    // tried; false is returned if any value could not be moved, including
+    // values missing under the old key. Those parameters keep the value in
+    // RAM, which init() then stores under the new key. Call it before
+    // init(), with the backend accepting the old key_version:
+    //
+    //   storage.accept_key_version(old_version);
+    //   params.migrate(old_hash);
+    //   storage.file(lun)->set_key_version(cgx::parameter::key_version);
+    bool migrate(parameter::uid_value_t (*old_hash)(std::string_view)) {
+        parameter::transaction batch(LUN);
+
+        bool ok = true;
         for (const auto& param : m_params) {
-            if (param && param->uid() == uid) {
-                return true;
+            if (!param) {
+                continue;
+            }
+            const parameter::uid_value_t old_uid = old_hash(param->name());
+            if (old_uid != param->uid() && !param->rekey(old_uid)) {
+                ok = false;
             }
         }
-        return false;
+
+        return batch.commit() && ok;
+    }
+
+    // snapshot_size returns the buffer size snapshot() needs.
+    size_t snapshot_size() const {
+        return _snapshot_size(m_size, [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot].get());
+        });
+    }
+
+    // snapshot serializes every parameter into one versioned blob, see
+    // snapshot.hpp. Returns the bytes written, or 0 if buffer is too small.
+    size_t snapshot(uint8_t* buffer, size_t size) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot].get());
+        };
+        return _write_snapshot(m_size, param_at, buffer, size);
+    }
+
+    // manifest writes the CRC of every parameter, keyed by UID, for a peer
+    // to build a delta() against. manifest_size() is the buffer it needs.
+    size_t manifest_size() const {
+        return parameter::snapshot_writer::manifest_size(m_size);
+    }
+
+    size_t manifest(uint8_t* buffer, size_t size) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot].get());
+        };
+        return _write_manifest(m_size, param_at, buffer, size);
+    }
+
+    // delta writes a snapshot of only the parameters that differ from base,
+    // a manifest() or snapshot() of the peer. The peer applies it with
+    // restore(). Returns the bytes written, or 0 on an invalid base or a
+    // small buffer; snapshot_size() is always enough.
+    size_t delta(
+        const uint8_t* base,
+        size_t         base_size,
+        uint8_t*       buffer,
+        size_t         size
+    ) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot].get());
+        };
+        return _write_delta(m_size, param_at, base, base_size, buffer, size);
+    }
+
+    // restore loads a blob written by snapshot() or delta(). Nothing is
+    // changed unless the blob is intact and each record matches a parameter
+    // by UID, type and size. Values are not stored; call store_all() to
+    // persist them.
+    bool restore(const uint8_t* buffer, size_t size) {
+        return _restore_snapshot(buffer, size, [this](auto uid) {
+            return this->find(uid);
+        });
+    }
+
+    // export_values writes every value as one object keyed by parameter
+    // name, e.g. through a json_writer or cbor_writer:
+    //
+    //   uint8_t                      chunk[256];
+    //   cgx::parameter::byte_output  out(chunk, sizeof(chunk), write_file);
+    //   cgx::parameter::json_writer  json(out);
+    //   params.export_values(json) && out.flush();
+    bool export_values(parameter::value_writer& out) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot].get());
+        };
+        return _export_values(m_size, param_at, out);
+    }
+
+    // import_values reads an object written by export_values() straight
+    // into the parameters. Unknown names are skipped. Import stops at the
+    // first malformed or mismatching value, leaving the values before it
+    // applied; run it inside a list_transaction to undo a failed import.
+    // Values are not stored; call store_all() to persist them.
+    bool import_values(parameter::value_reader& in) {
+        return _import_values(in, [this](auto uid) {
+            return this->find(uid);
+        });
+    }
+
+    bool uid_exists(parameter::uid_value_t uid) const {
+        return this->lookup(uid) != npos;
+    }
+
+    unique_parameter_i* find(parameter::uid_value_t uid) {
+        size_t slot = this->lookup(uid);
+        return slot == npos ? nullptr : m_params[slot].get();
+    }
+
+    const unique_parameter_i* find(parameter::uid_value_t uid) const {
+        size_t slot = this->lookup(uid);
+        return slot == npos ? nullptr : m_params[slot].get();
+    }
+
+    // size is the number of slots in use and at() the parameter in a slot,
+    // or nullptr for an empty one, for walking the list in order.
+    size_t size() const {
+        return m_size;
+    }
+
+    const unique_parameter_i* at(size_t slot) const {
+        return slot < m_size ? m_params[slot].get() : nullptr;
+    }
+
+    // for_each calls f with every parameter in slot order. Parameters added
+    // as unique_parameter<T> for one of the value types Ts are passed as
+    // that class, which is final, so f binds to them statically and their
+    // get_bytes(), set_bytes() and get_crc() can inline. The slot records
+    // the class, so picking it takes one compare per type instead of a
+    // virtual call. Other parameters are passed as unique_parameter_i&.
+    //
+    //   uint32_t crc = 0;
+    //   params.for_each<int, float>([&crc](const auto& param) {
+    //       crc ^= param.get_crc();
+    //   });
+    template <typename... Ts, typename F>
+    void for_each(F&& f) {
+        for (size_t slot = 0; slot < m_size; ++slot) {
+            this->template visit<Ts...>(m_params[slot].get(), slot, f);
+        }
+    }
+
+    template <typename... Ts, typename F>
+    void for_each(F&& f) const {
+        for (size_t slot = 0; slot < m_size; ++slot) {
+            const unique_parameter_i* param = m_params[slot].get();
+            this->template visit<Ts...>(param, slot, f);
+        }
+    }
+
+    // set_write_behind routes every change to queue instead of requiring
+    // explicit store() calls. Pass nullptr to go back to manual stores.
+    template <typename Q>
+    void set_write_behind(Q* queue) {
+        m_queue   = queue;
+        m_enqueue = nullptr;
+        if (queue != nullptr) {
+            m_enqueue = [](void* q, size_t slot, unique_parameter_i* param) {
+                static_cast<Q*>(q)->enqueue(slot, param);
+            };
+        }
+    }
+
+    // arena_used returns the arena bytes taken by the parameters added so
+    // far, to size ArenaSize from a running program.
+    size_t arena_used() const {
+        return m_arena_used;
+    }
+
+    // Budgets of the list when it holds parameters of the value types Ts,
+    // added in that order; see unique_parameter::stack_usage(). ram_usage is
+    // the list itself, arena included, and heap_usage the bytes add()
+    // allocates for the parameters that do not fit the arena.
+    //
+    //   static_assert(decltype(params)::heap_usage<int, table_t>() == 0);
+    template <typename... Ts>
+    static constexpr size_t stack_usage() {
+        return _list_stack_usage(
+            std::max({size_t{0}, unique_parameter<Ts>::stack_usage()...})
+        );
+    }
+
+    static constexpr size_t ram_usage() {
+        return sizeof(unique_parameter_list);
+    }
+
+    // heap_usage places the parameters the way create() does.
+    template <typename... Ts>
+    static constexpr size_t heap_usage() {
+        constexpr size_t sizes[]  = {sizeof(unique_parameter<Ts>)..., 0};
+        constexpr size_t aligns[] = {alignof(unique_parameter<Ts>)..., 1};
+        size_t           used     = 0;
+        size_t           heap     = 0;
+        for (size_t i = 0; i < sizeof...(Ts); ++i) {
+            const size_t offset =
+                (used + aligns[i] - 1) / aligns[i] * aligns[i];
+            if (ArenaSize > 0 && offset + sizes[i] <= ArenaSize) {
+                used = offset + sizes[i];
+            } else {
+                heap += sizes[i];
+            }
+        }
+        return heap;
     }
 
    private:
-    std::array<std::unique_ptr<unique_parameter_i>, N> m_params;
+    // deleter destroys arena parameters in place and deletes heap ones.
+    struct deleter {
+        bool in_arena{false};
+
+        void operator()(unique_parameter_i* param) const {
+            if (in_arena) {
+                param->~unique_parameter_i();
+            } else {
+                delete param;
+            }
+        }
+    };
 
-    size_t m_size = 0;
+    using param_ptr = std::unique_ptr<unique_parameter_i, deleter>;
 
-    std::function<void(const char*)> m_print{nullptr};
+    static constexpr size_t _arena_capacity = ArenaSize > 0 ? ArenaSize : 1;
 
-    unique_parameter_i* find(uint32_t uid) {
-        for (auto& param : m_params) {
-            if (param && param->uid() == uid) {
-                return param.get();
+    // The arena is declared before m_params so it outlives the parameters.
+    alignas(std::max_align_t) unsigned char m_arena[_arena_capacity];
+    size_t                                  m_arena_used{0};
+    std::array<param_ptr, N>                m_params;
+    std::array<const char*, N>              m_kinds{};
+
+    template <typename P, typename... Args>
+    param_ptr create(const parameter::uid_t& uid, Args&&... args) {
+        if constexpr (ArenaSize > 0) {
+            static_assert(
+                alignof(P) <= alignof(std::max_align_t),
+                "over-aligned parameters cannot be placed in the arena"
+            );
+            const size_t offset =
+                (m_arena_used + alignof(P) - 1) / alignof(P) * alignof(P);
+            if (offset + sizeof(P) <= ArenaSize) {
+                m_arena_used = offset + sizeof(P);
+                P* param     = ::new (static_cast<void*>(m_arena + offset))
+                    P(m_print, LUN, uid, std::forward<Args>(args)...);
+                return param_ptr(param, deleter{true});
             }
+            if (m_print) {
+                m_print("parameter arena full, falling back to the heap");
+            }
+            assert("parameter arena full" && offset + sizeof(P) <= ArenaSize);
         }
-        return nullptr;
+        return param_ptr(
+            new P(m_print, LUN, uid, std::forward<Args>(args)...),
+            deleter{false}
+        );
+    }
+
+    // UID index: open addressing with linear probing, kept at most half full
+    // so lookups stay O(1). UIDs are cached here to avoid a virtual call per
+    // probe.
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    static constexpr size_t _index_bits() {
+        size_t bits = 1;
+        while ((size_t{1} << bits) < 2 * N) {
+            ++bits;
+        }
+        return bits;
+    }
+
+    static constexpr size_t _index_capacity() {
+        return size_t{1} << _index_bits();
+    }
+
+    struct index_entry {
+        parameter::uid_value_t uid;
+        uint32_t               slot;  // slot + 1, 0 marks an empty entry
+    };
+
+    std::array<index_entry, _index_capacity()> m_index{};
+
+    static size_t _index_home(parameter::uid_value_t uid) {
+        // Fibonacci hashing spreads the weak low bits of uid_t::hash.
+        const uint64_t mixed =
+            static_cast<uint64_t>(uid) * 11400714819323198485ull;
+        return static_cast<size_t>(mixed >> (64 - _index_bits()));
+    }
+
+    size_t lookup(parameter::uid_value_t uid) const {
+        for (size_t i = _index_home(uid);; i = (i + 1) & (m_index.size() - 1)) {
+            const auto& entry = m_index[i];
+            if (entry.slot == 0) {
+                return npos;
+            }
+            if (entry.uid == uid) {
+                return entry.slot - 1;
+            }
+        }
+    }
+
+    void index(parameter::uid_value_t uid, size_t slot) {
+        for (size_t i = _index_home(uid);; i = (i + 1) & (m_index.size() - 1)) {
+            auto& entry = m_index[i];
+            if (entry.slot == 0) {
+                entry = {uid, static_cast<uint32_t>(slot + 1)};
+                return;
+            }
+            if (entry.uid == uid) {
+                return;
+            }
+        }
+    }
+
+    void unindex(parameter::uid_value_t uid, size_t slot) {
+        const size_t mask = m_index.size() - 1;
+        size_t       i    = _index_home(uid);
+        for (;; i = (i + 1) & mask) {
+            if (m_index[i].slot == 0) {
+                return;
+            }
+            if (m_index[i].uid == uid && m_index[i].slot == slot + 1) {
+                break;
+            }
+        }
+        // Backward-shift deletion keeps probe chains intact without
+        // tombstones.
+        for (size_t j = (i + 1) & mask; m_index[j].slot != 0;
+             j        = (j + 1) & mask) {
+            size_t home = _index_home(m_index[j].uid);
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                m_index[i] = m_index[j];
+                i          = j;
+            }
+        }
+        m_index[i] = {};
     }
+
+    size_t m_size = 0;
+
+    delegate<void(const char*)> m_print{nullptr};
+
+    mutable _crc_tracker<N> m_crc;
+
+    // Type-erased hook into an optional write_behind queue, so this header
+    // does not depend on write_behind.hpp.
+    void (*m_enqueue)(void*, size_t, unique_parameter_i*){nullptr};
+    void* m_queue{nullptr};
+
+    // Rollback state of an open list transaction. Changes made during it
+    // reach the write-behind queue on commit().
+    uint8_t*            m_rollback{nullptr};
+    size_t              m_rollback_size{0};
+    size_t              m_rollback_count{0};
+    std::array<bool, N> m_held_dirty{};
+
+    void changed(size_t slot) {
+        m_crc.mark_dirty(slot);
+        if (m_rollback != nullptr) {
+            m_held_dirty[slot] = true;
+            return;
+        }
+        if (m_enqueue) {
+            m_enqueue(m_queue, slot, m_params[slot].get());
+        }
+    }
+
+    // visit passes param to f as the first unique_parameter<T> of Ts its
+    // slot records, or as it is.
+    template <typename... Ts, typename I, typename F>
+    void visit(I* param, size_t slot, F& f) const {
+        (void)slot;
+        if (param != nullptr &&
+            !(... || this->template visit_as<Ts>(param, slot, f))) {
+            f(*param);
+        }
+    }
+
+    template <typename T, typename I, typename F>
+    bool visit_as(I* param, size_t slot, F& f) const {
+        using P = unique_parameter<T>;
+        if (m_kinds[slot] != &parameter::_kind<P>) {
+            return false;
+        }
+        if constexpr (std::is_const_v<I>) {
+            f(*static_cast<const P*>(param));
+        } else {
+            f(*static_cast<P*>(param));
+        }
+        return true;
+    }
+
+    template <typename P>
+    void attach(size_t slot) {
+        m_kinds[slot] = &parameter::_kind<P>;
+        m_params[slot]->on_dirty([this, slot]() {
+            this->changed(slot);
+        });
+        m_crc.mark_dirty(slot);
+        if (m_rollback != nullptr) {
+            m_params[slot]->hold();
+        }
+    }
+};
+
+// list_transaction scopes List::begin() and commit(). If it goes out of
+// scope without a successful commit(), the changes are rolled back.
+//
+//   uint8_t buffer[1024];
+//   cgx::list_transaction update(params, buffer, sizeof(buffer));
+//   kp = 1.2f;
+//   ki = 0.1f;
+//   update.commit();
+template <typename List>
+class list_transaction {
+   public:
+    list_transaction(List& list, uint8_t* buffer, size_t size)
+        : m_list(list), m_open(list.begin(buffer, size)) {
+    }
+    list_transaction(const list_transaction&)            = delete;
+    list_transaction& operator=(const list_transaction&) = delete;
+    ~list_transaction() {
+        this->rollback();
+    }
+
+    bool commit() {
+        if (!m_open) {
+            return false;
+        }
+        m_open = false;
+        return m_list.commit();
+    }
+
+    void rollback() {
+        if (m_open) {
+            m_open = false;
+            m_list.rollback();
+        }
+    }
+
+    // ok is false when begin() failed, e.g. because buffer was too small.
+    bool ok() const {
+        return m_open;
+    }
+
+   private:
+    List& m_list;
+    bool  m_open;
 };
 
 }  // namespace cgx
@@ -0,0 +1,700 @@
+#pragma once
+
+// Binary request/response protocol for reading and writing parameters by
+// UID, e.g. from tuning tools. Every message is a frame:
+//
+//   rpc_header_t, then size bytes of body
+//
+// A request carries a batch of count entries for one operation:
+//
+//   GET   count x uid_value_t
+//   SET   count x { rpc_entry_t, payload[size] }
+//   CRC   count x uid_value_t
+//   LIST  uint32_t first slot, count is the most entries to return
+//
+// and its response echoes id and op, with one entry per request entry:
+//
+//   GET   count x { rpc_entry_t, payload[size] }
+//   SET   count x rpc_entry_t
+//   CRC   uint32_t list CRC, count x { rpc_entry_t, uint32_t crc }
+//   LIST  uint32_t next slot, count x { rpc_info_t, name[name_size] }
+//
+// A request that cannot be served at all gets an rpc_error frame whose body
+// is one uint32_t rpc_status_t. Fields are in native byte order and packed
+// without padding, like snapshots; both ends must use the same key_version.
+//
+// This header holds the wire format and the transport-independent parts;
+// rpc_socket.hpp serves it over Unix-domain and loopback TCP sockets.
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "parameter.hpp"
+
+// Most iovecs and scratch bytes the responses of one server pass may use.
+// A request whose response cannot fit in them is answered with
+// rpc_too_large.
+#ifndef CGX_PARAMETER_RPC_IOV
+#define CGX_PARAMETER_RPC_IOV 256
+#endif
+
+#ifndef CGX_PARAMETER_RPC_SCRATCH_SIZE
+#define CGX_PARAMETER_RPC_SCRATCH_SIZE 8192
+#endif
+
+// Values up to this size are copied into the response rather than
+// referenced, which is cheaper than an extra iovec.
+#ifndef CGX_PARAMETER_RPC_COPY_SIZE
+#define CGX_PARAMETER_RPC_COPY_SIZE 64
+#endif
+
+namespace cgx::parameter {
+
+struct rpc_header_t {
+    uint32_t size;  // body bytes after the header
+    uint32_t id;    // chosen by the client, echoed in the response
+    uint16_t key_version;
+    uint16_t op;
+    uint32_t count;
+};
+
+struct rpc_entry_t {
+    uid_value_t uid;
+    uint32_t    status;
+    uint32_t    size;
+};
+
+struct rpc_info_t {
+    uid_value_t uid;
+    uint32_t    type;  // _type_id<T>() of the value
+    uint32_t    size;
+    uint32_t    name_size;
+    uint32_t    reserved;
+};
+
+enum rpc_op_t : uint16_t {
+    rpc_get   = 1,
+    rpc_set   = 2,
+    rpc_list  = 3,
+    rpc_crc   = 4,
+    rpc_error = 0xFFFF,
+};
+
+enum rpc_status_t : uint32_t {
+    rpc_ok          = 0,
+    rpc_not_found   = 1,  // no parameter with this UID
+    rpc_bad_size    = 2,  // SET payload size differs from the value's
+    rpc_rejected    = 3,  // the parameter refused the value
+    rpc_bad_request = 4,  // malformed frame or unknown op
+    rpc_bad_version = 5,  // key_version differs from the server's
+    rpc_too_large   = 6,  // response exceeds the server's limits
+    rpc_not_applied = 7,  // valid SET entry dropped as another one failed
+};
+
+// rpc_output gathers a response as iovecs: headers and small values are
+// written to a scratch buffer and large values are referenced where they
+// live, so sendmsg() sends them without copying.
+class rpc_output {
+   public:
+    rpc_output(iovec* iov, size_t iov_size, uint8_t* scratch, size_t size)
+        : m_iov(iov)
+        , m_iov_size(iov_size)
+        , m_scratch(scratch)
+        , m_scratch_size(size) {
+    }
+
+    // fits tells whether iovs more iovecs and bytes more scratch bytes are
+    // available.
+    bool fits(size_t iovs, size_t bytes) const {
+        return m_count + iovs <= m_iov_size &&
+               m_used + bytes <= m_scratch_size;
+    }
+
+    // fits_empty tells whether they would be once the output is sent.
+    bool fits_empty(size_t iovs, size_t bytes) const {
+        return iovs <= m_iov_size && bytes <= m_scratch_size;
+    }
+
+    // copy takes size scratch bytes, queued for sending, and returns them
+    // for the caller to fill.
+    uint8_t* copy(size_t size) {
+        uint8_t* data = m_scratch + m_used;
+        m_used += size;
+        this->add(data, size);
+        return data;
+    }
+
+    void copy(const void* data, size_t size) {
+        std::memcpy(this->copy(size), data, size);
+    }
+
+    // reference queues size bytes at data, which must stay unchanged until
+    // the output is sent.
+    void reference(const void* data, size_t size) {
+        this->add(data, size);
+    }
+
+    iovec* iov() {
+        return m_iov;
+    }
+
+    size_t count() const {
+        return m_count;
+    }
+
+    // size is the number of bytes queued.
+    size_t size() const {
+        return m_size;
+    }
+
+    void clear() {
+        m_count = 0;
+        m_used  = 0;
+        m_size  = 0;
+    }
+
+   private:
+    iovec*   m_iov;
+    size_t   m_iov_size;
+    uint8_t* m_scratch;
+    size_t   m_scratch_size;
+    size_t   m_count{0};
+    size_t   m_used{0};
+    size_t   m_size{0};
+
+    void add(const void* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        m_size += size;
+        if (m_count > 0) {
+            iovec& last = m_iov[m_count - 1];
+            if (static_cast<const uint8_t*>(last.iov_base) + last.iov_len ==
+                data) {
+                last.iov_len += size;
+                return;
+            }
+        }
+        m_iov[m_count++] = iovec{const_cast<void*>(data), size};
+    }
+};
+
+// rpc_handler serves request frames against a parameter list, such as a
+// unique_parameter_list or static_parameter_list. Each frame is checked
+// before it is applied, so a malformed SET changes nothing, and so is each
+// SET entry: if one names an unknown UID or has the wrong size, none is
+// applied and the others report rpc_not_applied. A parameter may still
+// refuse its value when it is applied, which only that entry reports as
+// rpc_rejected. SET changes the values in RAM through set_bytes(), which
+// notifies on_changed and subscribers; they are persisted by store_all()
+// or a write-behind queue like any other change.
+template <typename List>
+class rpc_handler {
+   public:
+    enum result_t {
+        rpc_handled,  // the response was added to the output
+        rpc_full,     // send the output and call handle() again
+    };
+
+    explicit rpc_handler(List& list) : m_list(list) {
+    }
+
+    // handle serves one whole frame, as framed by rpc_frame_size().
+    result_t handle(const uint8_t* frame, rpc_output& out) {
+        rpc_header_t request;
+        std::memcpy(&request, frame, sizeof(request));
+        const uint8_t* body = frame + sizeof(request);
+
+        size_t iovs, bytes;
+        rpc_status_t status = this->measure(request, body, iovs, bytes);
+        if (status == rpc_ok && !out.fits_empty(iovs, bytes)) {
+            status = rpc_too_large;
+        }
+        if (status != rpc_ok) {
+            if (!out.fits(1, sizeof(rpc_header_t) + sizeof(uint32_t))) {
+                return rpc_full;
+            }
+            this->error(request, status, out);
+            return rpc_handled;
+        }
+        // Responses may reference values, so a SET waits until the ones
+        // before it are sent.
+        if (!out.fits(iovs, bytes) || (request.op == rpc_set && out.size())) {
+            return rpc_full;
+        }
+
+        switch (request.op) {
+            case rpc_get: this->get(request, body, out); break;
+            case rpc_set: this->set(request, body, out); break;
+            case rpc_crc: this->crc(request, body, out); break;
+            case rpc_list: this->list(request, body, out); break;
+        }
+        return rpc_handled;
+    }
+
+   private:
+    List& m_list;
+
+    static bool _referenced(const unique_parameter_i& param) {
+        return param.bytes() != nullptr &&
+               param.byte_size() > CGX_PARAMETER_RPC_COPY_SIZE;
+    }
+
+    static rpc_header_t _reply(const rpc_header_t& request, size_t size) {
+        return rpc_header_t{
+            static_cast<uint32_t>(size),
+            request.id,
+            static_cast<uint16_t>(key_version),
+            request.op,
+            request.count,
+        };
+    }
+
+    // measure validates a request and works out the iovecs and scratch
+    // bytes its response needs.
+    rpc_status_t measure(
+        const rpc_header_t& request,
+        const uint8_t*      body,
+        size_t&             iovs,
+        size_t&             bytes
+    ) const {
+        if (_key_version(request.key_version) != key_version) {
+            return rpc_bad_version;
+        }
+        iovs  = 1;
+        bytes = sizeof(rpc_header_t);
+
+        const size_t count = request.count;
+        switch (request.op) {
+            case rpc_get:
+                if (request.size != count * sizeof(uid_value_t)) {
+                    return rpc_bad_request;
+                }
+                bytes += count * sizeof(rpc_entry_t);
+                for (size_t i = 0; i < count; ++i) {
+                    uid_value_t uid;
+                    std::memcpy(&uid, body + i * sizeof(uid), sizeof(uid));
+                    const unique_parameter_i* param = m_list.find(uid);
+                    if (param == nullptr) {
+                        continue;
+                    }
+                    // A referenced value and the scratch bytes after it
+                    // take one iovec each.
+                    if (_referenced(*param)) {
+                        iovs += 2;
+                    } else {
+                        bytes += param->byte_size();
+                    }
+                }
+                return rpc_ok;
+
+            case rpc_set: {
+                size_t offset = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    rpc_entry_t entry;
+                    if (request.size - offset < sizeof(entry)) {
+                        return rpc_bad_request;
+                    }
+                    std::memcpy(&entry, body + offset, sizeof(entry));
+                    offset += sizeof(entry);
+                    if (request.size - offset < entry.size) {
+                        return rpc_bad_request;
+                    }
+                    offset += entry.size;
+                }
+                if (offset != request.size) {
+                    return rpc_bad_request;
+                }
+                bytes += count * sizeof(rpc_entry_t);
+                return rpc_ok;
+            }
+
+            case rpc_crc:
+                if (request.size != count * sizeof(uid_value_t)) {
+                    return rpc_bad_request;
+                }
+                bytes += sizeof(uint32_t) +
+                         count * (sizeof(rpc_entry_t) + sizeof(uint32_t));
+                return rpc_ok;
+
+            case rpc_list: {
+                if (request.size != sizeof(uint32_t)) {
+                    return rpc_bad_request;
+                }
+                uint32_t first;
+                std::memcpy(&first, body, sizeof(first));
+                // Names are short, so they are copied along with the
+                // entries.
+                bytes += sizeof(uint32_t);
+                size_t listed = 0;
+                for (size_t slot = first;
+                     slot < m_list.size() && listed < count;
+                     ++slot) {
+                    const unique_parameter_i* param = m_list.at(slot);
+                    if (param != nullptr) {
+                        bytes += sizeof(rpc_info_t) + param->name().size();
+                        listed += 1;
+                    }
+                }
+                return rpc_ok;
+            }
+
+            default: return rpc_bad_request;
+        }
+    }
+
+    void error(const rpc_header_t& request, uint32_t status, rpc_output& out) {
+        rpc_header_t reply = _reply(request, sizeof(status));
+        reply.op           = rpc_error;
+        reply.count        = 0;
+        out.copy(&reply, sizeof(reply));
+        out.copy(&status, sizeof(status));
+    }
+
+    void get(
+        const rpc_header_t& request,
+        const uint8_t*      body,
+        rpc_output&         out
+    ) {
+        uint8_t* header = out.copy(sizeof(rpc_header_t));
+        size_t   size   = 0;
+        for (size_t i = 0; i < request.count; ++i) {
+            rpc_entry_t entry{0, rpc_ok, 0};
+            std::memcpy(&entry.uid, body, sizeof(entry.uid));
+            body += sizeof(entry.uid);
+
+            const unique_parameter_i* param = m_list.find(entry.uid);
+            if (param == nullptr) {
+                entry.status = rpc_not_found;
+                out.copy(&entry, sizeof(entry));
+            } else {
+                entry.size = static_cast<uint32_t>(param->byte_size());
+                out.copy(&entry, sizeof(entry));
+                if (_referenced(*param)) {
+                    out.reference(param->bytes(), entry.size);
+                } else {
+                    param->get_bytes(out.copy(entry.size), entry.size);
+                }
+            }
+            size += sizeof(entry) + entry.size;
+        }
+        const rpc_header_t reply = _reply(request, size);
+        std::memcpy(header, &reply, sizeof(reply));
+    }
+
+    void set(
+        const rpc_header_t& request,
+        const uint8_t*      body,
+        rpc_output&         out
+    ) {
+        const rpc_header_t reply =
+            _reply(request, request.count * sizeof(rpc_entry_t));
+        out.copy(&reply, sizeof(reply));
+
+        // Every entry is checked before any is applied.
+        bool valid = true;
+        _for_each_entry(request, body, [&](const rpc_entry_t& entry, auto) {
+            valid = _check(m_list.find(entry.uid), entry) == rpc_ok && valid;
+        });
+
+        _for_each_entry(request, body, [&](rpc_entry_t entry, auto payload) {
+            unique_parameter_i* param = m_list.find(entry.uid);
+            entry.status              = _check(param, entry);
+            if (entry.status == rpc_ok) {
+                if (!valid) {
+                    entry.status = rpc_not_applied;
+                } else if (!param->set_bytes(payload, entry.size)) {
+                    entry.status = rpc_rejected;
+                }
+            }
+            entry.size = 0;
+            out.copy(&entry, sizeof(entry));
+        });
+    }
+
+    // _check tells whether a SET entry names a parameter of its size.
+    static rpc_status_t
+    _check(const unique_parameter_i* param, const rpc_entry_t& entry) {
+        if (param == nullptr) {
+            return rpc_not_found;
+        }
+        return param->byte_size() == entry.size ? rpc_ok : rpc_bad_size;
+    }
+
+    // _for_each_entry calls f(entry, payload) for the entries of a SET
+    // body that measure() accepted.
+    template <typename F>
+    static void
+    _for_each_entry(const rpc_header_t& request, const uint8_t* body, F&& f) {
+        for (size_t i = 0; i < request.count; ++i) {
+            rpc_entry_t entry;
+            std::memcpy(&entry, body, sizeof(entry));
+            const uint8_t* payload = body + sizeof(entry);
+            body                   = payload + entry.size;
+            f(entry, payload);
+        }
+    }
+
+    void crc(
+        const rpc_header_t& request,
+        const uint8_t*      body,
+        rpc_output&         out
+    ) {
+        const size_t entry_size = sizeof(rpc_entry_t) + sizeof(uint32_t);
+        const rpc_header_t reply =
+            _reply(request, sizeof(uint32_t) + request.count * entry_size);
+        out.copy(&reply, sizeof(reply));
+        const uint32_t list_crc = m_list.get_crc();
+        out.copy(&list_crc, sizeof(list_crc));
+
+        for (size_t i = 0; i < request.count; ++i) {
+            rpc_entry_t entry{0, rpc_ok, sizeof(uint32_t)};
+            std::memcpy(&entry.uid, body, sizeof(entry.uid));
+            body += sizeof(entry.uid);
+            const unique_parameter_i* param = m_list.find(entry.uid);
+            uint32_t                  crc   = 0;
+            if (param == nullptr) {
+                entry.status = rpc_not_found;
+            } else {
+                crc = param->get_crc();
+            }
+            out.copy(&entry, sizeof(entry));
+            out.copy(&crc, sizeof(crc));
+        }
+    }
+
+    void list(
+        const rpc_header_t& request,
+        const uint8_t*      body,
+        rpc_output&         out
+    ) {
+        uint32_t first;
+        std::memcpy(&first, body, sizeof(first));
+
+        uint8_t* header = out.copy(sizeof(rpc_header_t));
+        uint8_t* next   = out.copy(sizeof(uint32_t));
+        size_t   size   = sizeof(uint32_t);
+        uint32_t listed = 0;
+        size_t   slot   = first;
+        for (; slot < m_list.size() && listed < request.count; ++slot) {
+            const unique_parameter_i* param = m_list.at(slot);
+            if (param == nullptr) {
+                continue;
+            }
+            const std::string_view name = param->name();
+            const rpc_info_t       info{
+                param->uid(),
+                param->type_id(),
+                static_cast<uint32_t>(param->byte_size()),
+                static_cast<uint32_t>(name.size()),
+                0,
+            };
+            out.copy(&info, sizeof(info));
+            out.copy(name.data(), name.size());
+            size += sizeof(info) + name.size();
+            listed += 1;
+        }
+
+        rpc_header_t reply = _reply(request, size);
+        reply.count        = listed;
+        std::memcpy(header, &reply, sizeof(reply));
+        const auto resume = static_cast<uint32_t>(slot);
+        std::memcpy(next, &resume, sizeof(resume));
+    }
+};
+
+// rpc_frame_size returns the size of the frame at the start of data once
+// it is complete, or 0 while more bytes are needed.
+inline size_t rpc_frame_size(const uint8_t* data, size_t size) {
+    rpc_header_t header;
+    if (size < sizeof(header)) {
+        return 0;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    const size_t frame = sizeof(header) + header.size;
+    return size >= frame ? frame : 0;
+}
+
+// rpc_request builds one request frame in a caller-provided buffer:
+//
+//   uint8_t                          buffer[256];
+//   cgx::parameter::rpc_request      request(buffer, sizeof(buffer));
+//   request.begin(cgx::parameter::rpc_get, 1);
+//   request.add(gain.uid());
+//   request.add(offset.uid());
+//   client.send(buffer, request.finish());
+class rpc_request {
+   public:
+    rpc_request(uint8_t* buffer, size_t size)
+        : m_buffer(buffer), m_size(size) {
+    }
+
+    void begin(rpc_op_t op, uint32_t id) {
+        m_header = rpc_header_t{
+            0, id, static_cast<uint16_t>(key_version), op, 0
+        };
+        m_used   = sizeof(rpc_header_t);
+        m_ok     = m_size >= m_used;
+    }
+
+    // add appends a GET or CRC entry.
+    bool add(uid_value_t uid) {
+        m_header.count += 1;
+        return this->put(&uid, sizeof(uid));
+    }
+
+    // add appends a SET entry.
+    bool add(uid_value_t uid, const void* data, size_t size) {
+        const rpc_entry_t entry{uid, rpc_ok, static_cast<uint32_t>(size)};
+        m_header.count += 1;
+        return this->put(&entry, sizeof(entry)) && this->put(data, size);
+    }
+
+    // list asks for up to count entries starting at slot first.
+    bool list(uint32_t first, uint32_t count) {
+        m_header.count = count;
+        return this->put(&first, sizeof(first));
+    }
+
+    // finish writes the header and returns the frame size, or 0 if the
+    // buffer was too small.
+    size_t finish() {
+        if (!m_ok) {
+            return 0;
+        }
+        m_header.size = static_cast<uint32_t>(m_used - sizeof(rpc_header_t));
+        std::memcpy(m_buffer, &m_header, sizeof(m_header));
+        return m_used;
+    }
+
+   private:
+    uint8_t*     m_buffer;
+    size_t       m_size;
+    size_t       m_used{0};
+    rpc_header_t m_header{};
+    bool         m_ok{false};
+
+    bool put(const void* data, size_t size) {
+        if (!m_ok || m_size - m_used < size) {
+            m_ok = false;
+            return false;
+        }
+        std::memcpy(m_buffer + m_used, data, size);
+        m_used += size;
+        return true;
+    }
+};
+
+// rpc_response walks the entries of a response frame. The data pointers
+// point into the frame.
+class rpc_response {
+   public:
+    struct entry_t {
+        uid_value_t    uid;
+        uint32_t       status;
+        size_t         size;
+        const uint8_t* data;
+    };
+
+    struct info_t {
+        uid_value_t      uid;
+        uint32_t         type;
+        size_t           size;
+        std::string_view name;
+    };
+
+    // open checks the frame, which must be complete, and reads the leading
+    // list CRC or next slot of CRC and LIST responses.
+    bool open(const uint8_t* frame, size_t size) {
+        m_offset = m_end = 0;
+        if (rpc_frame_size(frame, size) != size) {
+            return false;
+        }
+        std::memcpy(&m_header, frame, sizeof(m_header));
+        m_frame  = frame;
+        m_offset = sizeof(m_header);
+        m_end    = size;
+        m_status = rpc_ok;
+        m_value  = 0;
+        if (m_header.op == rpc_error) {
+            return this->read(&m_status, sizeof(m_status));
+        }
+        if (m_header.op == rpc_crc || m_header.op == rpc_list) {
+            return this->read(&m_value, sizeof(m_value));
+        }
+        return true;
+    }
+
+    const rpc_header_t& header() const {
+        return m_header;
+    }
+
+    // status is rpc_ok unless the whole request failed.
+    rpc_status_t status() const {
+        return static_cast<rpc_status_t>(m_status);
+    }
+
+    // list_crc is the list CRC of a CRC response and next_slot where a LIST
+    // continues; it equals the list size once every slot was listed.
+    uint32_t list_crc() const {
+        return m_value;
+    }
+
+    uint32_t next_slot() const {
+        return m_value;
+    }
+
+    // next returns the next GET, SET or CRC entry. A CRC entry's data is
+    // the parameter's uint32_t CRC.
+    bool next(entry_t& out) {
+        rpc_entry_t entry;
+        if (!this->read(&entry, sizeof(entry)) ||
+            m_end - m_offset < entry.size) {
+            return false;
+        }
+        out = entry_t{entry.uid, entry.status, entry.size, m_frame + m_offset};
+        m_offset += entry.size;
+        return true;
+    }
+
+    bool next(info_t& out) {
+        rpc_info_t info;
+        if (!this->read(&info, sizeof(info)) ||
+            m_end - m_offset < info.name_size) {
+            return false;
+        }
+        out = info_t{
+            info.uid,
+            info.type,
+            info.size,
+            std::string_view(
+                reinterpret_cast<const char*>(m_frame + m_offset),
+                info.name_size
+            ),
+        };
+        m_offset += info.name_size;
+        return true;
+    }
+
+   private:
+    const uint8_t* m_frame{nullptr};
+    size_t         m_offset{0};
+    size_t         m_end{0};
+    rpc_header_t   m_header{};
+    uint32_t       m_status{rpc_ok};
+    uint32_t       m_value{0};
+
+    bool read(void* dst, size_t size) {
+        if (m_end - m_offset < size) {
+            return false;
+        }
+        std::memcpy(dst, m_frame + m_offset, size);
+        m_offset += size;
+        return true;
+    }
+};
+
+}  // namespace cgx::parameter
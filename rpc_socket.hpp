@@ -0,0 +1,495 @@
+#pragma once
+
+// Socket transport for the rpc.hpp protocol: a poll()-driven server on a
+// Unix-domain or loopback TCP socket, and a blocking client. Requires POSIX
+// sockets.
+//
+//   cgx::parameter::rpc_server server(params);
+//   server.listen_unix("/tmp/params.sock");
+//   while (running) {
+//       server.poll(10);
+//       ...
+//   }
+//
+// The server runs on the caller's thread, so requests are served between
+// the list's other uses and need no locking.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <iterator>
+
+#include "rpc.hpp"
+
+#ifndef CGX_PARAMETER_RPC_CLIENTS
+#define CGX_PARAMETER_RPC_CLIENTS 4
+#endif
+
+// Largest request frame a server connection can take.
+#ifndef CGX_PARAMETER_RPC_BUFFER_SIZE
+#define CGX_PARAMETER_RPC_BUFFER_SIZE 4096
+#endif
+
+// How long a server waits on a client that does not read its responses
+// before dropping it.
+#ifndef CGX_PARAMETER_RPC_TIMEOUT_MS
+#define CGX_PARAMETER_RPC_TIMEOUT_MS 1000
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define CGX_PARAMETER_RPC_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define CGX_PARAMETER_RPC_SEND_FLAGS 0
+#endif
+
+namespace cgx::parameter {
+
+// _rpc_send writes count iovecs in as few calls as the socket allows. On a
+// non-blocking socket it waits for room up to the timeout.
+inline bool _rpc_send(int fd, iovec* iov, size_t count) {
+    while (count > 0) {
+        msghdr message{};
+        message.msg_iov    = iov;
+        message.msg_iovlen = count;
+
+        const ssize_t sent =
+            ::sendmsg(fd, &message, CGX_PARAMETER_RPC_SEND_FLAGS);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            pollfd writable{fd, POLLOUT, 0};
+            if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+                ::poll(&writable, 1, CGX_PARAMETER_RPC_TIMEOUT_MS) <= 0) {
+                return false;
+            }
+            continue;
+        }
+
+        auto done = static_cast<size_t>(sent);
+        while (count > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            iov += 1;
+            count -= 1;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+    return true;
+}
+
+template <typename List, size_t Clients = CGX_PARAMETER_RPC_CLIENTS>
+class rpc_server {
+   public:
+    explicit rpc_server(List& list) : m_handler(list) {
+    }
+    rpc_server(const rpc_server&)            = delete;
+    rpc_server& operator=(const rpc_server&) = delete;
+    ~rpc_server() {
+        this->close();
+    }
+
+    // listen_unix serves on a Unix-domain socket at path, replacing a
+    // stale socket file.
+    bool listen_unix(const char* path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        std::strcpy(addr.sun_path, path);
+
+        this->close();
+        ::unlink(path);
+        if (!this->listen_on(
+                AF_UNIX, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)
+            )) {
+            return false;
+        }
+        std::strcpy(m_path, path);
+        return true;
+    }
+
+    // listen_tcp serves on 127.0.0.1:port. Port 0 picks a free port, which
+    // port() returns.
+    bool listen_tcp(uint16_t port) {
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        this->close();
+        return this->listen_on(
+            AF_INET, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)
+        );
+    }
+
+    uint16_t port() const {
+        sockaddr_in addr{};
+        socklen_t   size = sizeof(addr);
+        auto*       name = reinterpret_cast<sockaddr*>(&addr);
+        if (m_listen < 0 || ::getsockname(m_listen, name, &size) != 0 ||
+            addr.sin_family != AF_INET) {
+            return 0;
+        }
+        return ntohs(addr.sin_port);
+    }
+
+    // poll accepts connections and serves every complete request that has
+    // arrived, waiting up to timeout_ms for one. Returns false if the
+    // server is not listening.
+    bool poll(int timeout_ms = 0) {
+        if (m_listen < 0) {
+            return false;
+        }
+
+        pollfd                      fds[Clients + 1];
+        std::array<size_t, Clients> owners;
+        size_t                      count = 0;
+        fds[count++] = pollfd{m_listen, POLLIN, 0};
+        for (size_t i = 0; i < Clients; ++i) {
+            if (m_clients[i].fd >= 0) {
+                owners[count - 1] = i;
+                fds[count++]      = pollfd{m_clients[i].fd, POLLIN, 0};
+            }
+        }
+
+        const int ready = ::poll(fds, count, timeout_ms);
+        if (ready <= 0) {
+            return ready == 0 || errno == EINTR;
+        }
+        for (size_t i = 1; i < count; ++i) {
+            if (fds[i].revents != 0) {
+                this->serve(m_clients[owners[i - 1]]);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            this->accept();
+        }
+        return true;
+    }
+
+    // clients is the number of open connections.
+    size_t clients() const {
+        size_t count = 0;
+        for (const auto& client : m_clients) {
+            count += client.fd >= 0 ? 1 : 0;
+        }
+        return count;
+    }
+
+    void close() {
+        for (auto& client : m_clients) {
+            this->drop(client);
+        }
+        if (m_listen >= 0) {
+            ::close(m_listen);
+            m_listen = -1;
+        }
+        if (m_path[0] != '\0') {
+            ::unlink(m_path);
+            m_path[0] = '\0';
+        }
+    }
+
+   private:
+    struct connection_t {
+        int     fd{-1};
+        size_t  used{0};
+        uint8_t buffer[CGX_PARAMETER_RPC_BUFFER_SIZE];
+    };
+
+    rpc_handler<List>                 m_handler;
+    int                               m_listen{-1};
+    char                              m_path[sizeof(sockaddr_un{}.sun_path)]{};
+    std::array<connection_t, Clients> m_clients;
+    iovec                             m_iov[CGX_PARAMETER_RPC_IOV];
+    uint8_t                           m_scratch[CGX_PARAMETER_RPC_SCRATCH_SIZE];
+
+    bool listen_on(int family, const sockaddr* addr, socklen_t size) {
+        const int fd = ::socket(family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        const int on = 1;
+        if (family == AF_INET) {
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        }
+        if (::bind(fd, addr, size) != 0 || ::listen(fd, Clients) != 0 ||
+            ::fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+            ::close(fd);
+            return false;
+        }
+        m_listen = fd;
+        return true;
+    }
+
+    void accept() {
+        const int fd = ::accept(m_listen, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        for (auto& client : m_clients) {
+            if (client.fd < 0) {
+                // Fails harmlessly on Unix-domain sockets.
+                const int on = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                ::fcntl(fd, F_SETFL, O_NONBLOCK);
+                client.fd   = fd;
+                client.used = 0;
+                return;
+            }
+        }
+        ::close(fd);
+    }
+
+    void drop(connection_t& client) {
+        if (client.fd >= 0) {
+            ::close(client.fd);
+            client.fd   = -1;
+            client.used = 0;
+        }
+    }
+
+    // serve reads what has arrived and answers every complete frame. The
+    // responses to pipelined frames are gathered and sent together.
+    void serve(connection_t& client) {
+        const ssize_t received = ::read(
+            client.fd,
+            client.buffer + client.used,
+            sizeof(client.buffer) - client.used
+        );
+        if (received <= 0) {
+            if (received < 0 && (errno == EAGAIN || errno == EINTR)) {
+                return;
+            }
+            this->drop(client);
+            return;
+        }
+        client.used += static_cast<size_t>(received);
+
+        rpc_output out(m_iov, std::size(m_iov), m_scratch, sizeof(m_scratch));
+        size_t     offset = 0;
+        while (true) {
+            const uint8_t* frame = client.buffer + offset;
+            const size_t   size  = rpc_frame_size(frame, client.used - offset);
+            if (size == 0) {
+                break;
+            }
+            if (m_handler.handle(frame, out) == rpc_handler<List>::rpc_full) {
+                if (!_rpc_send(client.fd, out.iov(), out.count())) {
+                    this->drop(client);
+                    return;
+                }
+                out.clear();
+                continue;
+            }
+            offset += size;
+        }
+        if (out.count() > 0 &&
+            !_rpc_send(client.fd, out.iov(), out.count())) {
+            this->drop(client);
+            return;
+        }
+
+        std::memmove(
+            client.buffer, client.buffer + offset, client.used - offset
+        );
+        client.used -= offset;
+
+        // A frame that can never fit the buffer ends the connection.
+        rpc_header_t header;
+        if (client.used >= sizeof(header)) {
+            std::memcpy(&header, client.buffer, sizeof(header));
+            if (header.size > sizeof(client.buffer) - sizeof(header)) {
+                this->drop(client);
+            }
+        }
+    }
+};
+
+// rpc_client talks to an rpc_server over a blocking socket. Requests may
+// be pipelined: send any number of frames, then receive their responses,
+// which arrive in order.
+class rpc_client {
+   public:
+    rpc_client() = default;
+    rpc_client(const rpc_client&)            = delete;
+    rpc_client& operator=(const rpc_client&) = delete;
+    ~rpc_client() {
+        this->close();
+    }
+
+    bool connect_unix(const char* path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        std::strcpy(addr.sun_path, path);
+        return this->connect_to(
+            AF_UNIX, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)
+        );
+    }
+
+    // connect_tcp connects to a server on 127.0.0.1:port.
+    bool connect_tcp(uint16_t port) {
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (!this->connect_to(
+                AF_INET, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)
+            )) {
+            return false;
+        }
+        const int on = 1;
+        ::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return true;
+    }
+
+    bool is_connected() const {
+        return m_fd >= 0;
+    }
+
+    void close() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    // send writes one request frame, e.g. built by rpc_request.
+    bool send(const uint8_t* frame, size_t size) {
+        iovec iov{const_cast<uint8_t*>(frame), size};
+        return m_fd >= 0 && size > 0 && _rpc_send(m_fd, &iov, 1);
+    }
+
+    // receive reads the next response frame into buffer. Returns its size,
+    // or 0 on an error or if it does not fit, which closes the connection
+    // since the stream cannot be resynchronized.
+    size_t receive(uint8_t* buffer, size_t size) {
+        rpc_header_t header;
+        if (size < sizeof(header) || !this->read(buffer, sizeof(header))) {
+            this->close();
+            return 0;
+        }
+        std::memcpy(&header, buffer, sizeof(header));
+        const size_t frame = sizeof(header) + header.size;
+        if (frame > size ||
+            !this->read(buffer + sizeof(header), header.size)) {
+            this->close();
+            return 0;
+        }
+        return frame;
+    }
+
+    // get and set exchange a single value of type T; status() tells why
+    // they failed.
+    template <typename T>
+    bool get(uid_value_t uid, T& value) {
+        uint8_t buffer[sizeof(rpc_header_t) + sizeof(rpc_entry_t) + sizeof(T)];
+        rpc_request request(buffer, sizeof(buffer));
+        request.begin(rpc_get, ++m_id);
+        request.add(uid);
+
+        rpc_response::entry_t entry;
+        if (!this->call(buffer, request.finish(), sizeof(buffer), entry)) {
+            return false;
+        }
+        if (entry.size != sizeof(T)) {
+            m_status = rpc_bad_size;
+            return false;
+        }
+        std::memcpy(&value, entry.data, sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool set(uid_value_t uid, const T& value) {
+        uint8_t buffer[sizeof(rpc_header_t) + sizeof(rpc_entry_t) + sizeof(T)];
+        rpc_request request(buffer, sizeof(buffer));
+        request.begin(rpc_set, ++m_id);
+        request.add(uid, &value, sizeof(T));
+
+        rpc_response::entry_t entry;
+        return this->call(buffer, request.finish(), sizeof(buffer), entry);
+    }
+
+    rpc_status_t status() const {
+        return m_status;
+    }
+
+   private:
+    int          m_fd{-1};
+    uint32_t     m_id{0};
+    rpc_status_t m_status{rpc_ok};
+
+    bool connect_to(int family, const sockaddr* addr, socklen_t size) {
+        this->close();
+        const int fd = ::socket(family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        if (::connect(fd, addr, size) != 0) {
+            ::close(fd);
+            return false;
+        }
+        m_fd = fd;
+        return true;
+    }
+
+    bool read(uint8_t* dst, size_t size) {
+        while (size > 0) {
+            const ssize_t n = ::read(m_fd, dst, size);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            dst += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // call sends the single-entry request in buffer and reads its response
+    // back into buffer.
+    bool call(
+        uint8_t*               buffer,
+        size_t                 frame,
+        size_t                 size,
+        rpc_response::entry_t& entry
+    ) {
+        m_status = rpc_bad_request;
+        rpc_response response;
+        if (!this->send(buffer, frame)) {
+            return false;
+        }
+        const size_t received = this->receive(buffer, size);
+        if (received == 0 || !response.open(buffer, received)) {
+            return false;
+        }
+        m_status = response.status();
+        if (response.header().id != m_id || m_status != rpc_ok ||
+            !response.next(entry)) {
+            return false;
+        }
+        m_status = static_cast<rpc_status_t>(entry.status);
+        return m_status == rpc_ok;
+    }
+};
+
+}  // namespace cgx::parameter
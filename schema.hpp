@@ -0,0 +1,487 @@
+#pragma once
+
+// Compile-time parameter schemas. A whole parameter set is declared as one
+// constexpr object:
+//
+//   constexpr auto my_schema = cgx::make_schema(
+//       cgx::field{"gain", 1.0f},
+//       cgx::field{"name", "device"},
+//       cgx::field{"limits", std::array<int, 2>{-10, 10}}
+//   );
+//   cgx::static_parameter_list<0, my_schema> params(printer);
+//
+// UID collisions, capacity and storage size are checked with static_assert,
+// the UID lookup table is constexpr data, and the parameters are members of
+// the list, so nothing is registered or allocated at startup. Field values
+// must be literal types.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include "parameter.hpp"
+
+namespace cgx {
+
+template <typename T>
+struct field {
+    constexpr field(std::string_view name, const T& value)
+        : name(name), value(value) {
+    }
+
+    std::string_view name;
+    T                value;
+};
+
+template <size_t N>
+struct field<char[N]> {
+    constexpr field(std::string_view name, const char (&value)[N])
+        : name(name) {
+        for (size_t i = 0; i < N; ++i) {
+            this->value[i] = value[i];
+        }
+    }
+
+    std::string_view name;
+    char             value[N]{};
+};
+
+// schema_entry describes one field. Entries of a schema table are sorted by
+// UID; offset is the position of the value in a packed image of all values
+// in declaration order.
+struct schema_entry {
+    parameter::uid_value_t uid;
+    uint32_t               type;   // parameter::_type_id<T>()
+    size_t                 index;  // declaration order, as used by get<I>()
+    size_t                 offset;
+    size_t                 size;
+};
+
+template <typename... Ts>
+struct schema {
+    static constexpr size_t size = sizeof...(Ts);
+
+    std::tuple<field<Ts>...> fields;
+
+    // storage_size returns the bytes needed to store every value.
+    static constexpr size_t storage_size() {
+        return (size_t{0} + ... + sizeof(Ts));
+    }
+
+    constexpr std::array<std::string_view, size> names() const {
+        return this->names(std::index_sequence_for<Ts...>{});
+    }
+
+    // index_of returns the declaration index of name, or size if the schema
+    // has no such field.
+    constexpr size_t index_of(std::string_view name) const {
+        const auto all = this->names();
+        for (size_t i = 0; i < size; ++i) {
+            if (all[i] == name) {
+                return i;
+            }
+        }
+        return size;
+    }
+
+    constexpr std::array<schema_entry, size> table() const {
+        // The extra element keeps the arrays valid for an empty schema.
+        constexpr size_t   sizes[size + 1] = {sizeof(Ts)..., 0};
+        constexpr uint32_t types[size + 1] = {parameter::_type_id<Ts>()..., 0};
+
+        std::array<schema_entry, size> entries{};
+        const auto                     all    = this->names();
+        size_t                         offset = 0;
+        for (size_t i = 0; i < size; ++i) {
+            const auto uid = parameter::uid_t(all[i]).get_uid();
+            entries[i]     = schema_entry{uid, types[i], i, offset, sizes[i]};
+            offset += sizes[i];
+        }
+
+        for (size_t i = 1; i < size; ++i) {
+            const schema_entry entry = entries[i];
+            size_t             j     = i;
+            for (; j > 0 && entries[j - 1].uid > entry.uid; --j) {
+                entries[j] = entries[j - 1];
+            }
+            entries[j] = entry;
+        }
+        return entries;
+    }
+
+    // has_collision reports whether two fields hash to the same UID.
+    constexpr bool has_collision() const {
+        const auto entries = this->table();
+        for (size_t i = 1; i < size; ++i) {
+            if (entries[i - 1].uid == entries[i].uid) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+   private:
+    template <size_t... Is>
+    constexpr std::array<std::string_view, size>
+    names(std::index_sequence<Is...>) const {
+        return {std::get<Is>(fields).name...};
+    }
+};
+
+template <typename... Ts>
+constexpr schema<Ts...> make_schema(const field<Ts>&... fields) {
+    return schema<Ts...>{std::tuple<field<Ts>...>(fields...)};
+}
+
+namespace parameter {
+
+template <size_t I, typename T>
+struct _schema_slot {
+    _schema_slot(
+        delegate<void(const char*)> print,
+        size_t                      lun,
+        const field<T>&             entry
+    )
+        : param(print, lun, uid_t(entry.name), entry.value) {
+    }
+
+    unique_parameter<T> param;
+};
+
+template <typename Indices, typename... Ts>
+struct _schema_slots;
+
+template <size_t... Is, typename... Ts>
+struct _schema_slots<std::index_sequence<Is...>, Ts...>
+    : _schema_slot<Is, Ts>... {
+    _schema_slots(
+        delegate<void(const char*)> print,
+        size_t                      lun,
+        const schema<Ts...>&        definition
+    )
+        : _schema_slot<Is, Ts>(
+              print, lun, std::get<Is>(definition.fields)
+          )... {
+        // Unused when the schema is empty.
+        (void)print;
+        (void)lun;
+        (void)definition;
+    }
+};
+
+template <typename S>
+struct _schema_traits;
+
+template <typename... Ts>
+struct _schema_traits<schema<Ts...>> {
+    using slots = _schema_slots<std::index_sequence_for<Ts...>, Ts...>;
+
+    template <size_t I>
+    using type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    static constexpr size_t stack_usage() {
+        return std::max({size_t{0}, unique_parameter<Ts>::stack_usage()...});
+    }
+};
+
+}  // namespace parameter
+
+// static_parameter_list holds the parameters of Schema on LUN as members.
+// Capacity and MaxBytes bound the number of parameters and the bytes they
+// store, e.g. to match the backend's limits.
+template <
+    size_t      LUN,
+    const auto& Schema,
+    size_t      Capacity = std::decay_t<decltype(Schema)>::size,
+    size_t      MaxBytes = static_cast<size_t>(-1)>
+class static_parameter_list {
+    using schema_t = std::decay_t<decltype(Schema)>;
+    using traits   = parameter::_schema_traits<schema_t>;
+
+    static_assert(!Schema.has_collision(), "schema has colliding UIDs");
+    static_assert(schema_t::size <= Capacity, "schema exceeds the capacity");
+    static_assert(
+        schema_t::storage_size() <= MaxBytes,
+        "schema values exceed the storage size"
+    );
+
+   public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // UID lookup table, sorted by UID.
+    static constexpr std::array<schema_entry, schema_t::size> table =
+        Schema.table();
+
+    static_parameter_list(delegate<void(const char*)> print)
+        : m_slots(print, LUN, Schema), m_print(print) {
+        this->attach(std::make_index_sequence<schema_t::size>{});
+    }
+
+    // Parameters hold callbacks into the list, so it must stay in place.
+    static_parameter_list(const static_parameter_list&)            = delete;
+    static_parameter_list& operator=(const static_parameter_list&) = delete;
+
+    static constexpr size_t size() {
+        return schema_t::size;
+    }
+
+    // Budgets as for unique_parameter_list. The parameters are members, so
+    // ram_usage covers them and nothing is allocated.
+    static constexpr size_t stack_usage() {
+        return _list_stack_usage(traits::stack_usage());
+    }
+
+    static constexpr size_t ram_usage() {
+        return sizeof(static_parameter_list);
+    }
+
+    static constexpr size_t heap_usage() {
+        return 0;
+    }
+
+    static constexpr size_t index_of(std::string_view name) {
+        return Schema.index_of(name);
+    }
+
+    template <size_t I>
+    auto& get() {
+        static_assert(I < schema_t::size, "schema index out of range");
+        using slot =
+            parameter::_schema_slot<I, typename traits::template type<I>>;
+        return static_cast<slot&>(m_slots).param;
+    }
+
+    template <size_t I>
+    const auto& get() const {
+        static_assert(I < schema_t::size, "schema index out of range");
+        using slot =
+            parameter::_schema_slot<I, typename traits::template type<I>>;
+        return static_cast<const slot&>(m_slots).param;
+    }
+
+    // for_each calls f with every parameter as its concrete
+    // unique_parameter<T>, in declaration order. unique_parameter is final,
+    // so calls made through it are bound statically and can be inlined,
+    // unlike calls through unique_parameter_i.
+    template <typename F>
+    void for_each(F&& f) {
+        this->for_each(f, std::make_index_sequence<schema_t::size>{});
+    }
+
+    template <typename F>
+    void for_each(F&& f) const {
+        this->for_each(f, std::make_index_sequence<schema_t::size>{});
+    }
+
+    // init and store_all batch their records as in unique_parameter_list.
+    bool init() {
+        parameter::transaction batch(LUN);
+
+        const bool ok = _init_batched(LUN, size(), [this](size_t slot) {
+            return m_params[slot];
+        });
+
+        return batch.commit() && ok;
+    }
+
+    bool store_all() {
+        parameter::transaction batch(LUN);
+
+        const bool ok = _store_batched(
+            LUN,
+            size(),
+            [this](size_t slot) {
+                return m_params[slot];
+            },
+            [](unique_parameter_i&) {
+                return true;
+            }
+        );
+
+        return batch.commit() && ok;
+    }
+
+    void print() const {
+        char                 buffer[CGX_PARAMETER_PRINT_CHUNK_SIZE];
+        parameter::text_sink out(buffer, sizeof(buffer), m_print);
+        this->print(out);
+    }
+
+    void print(parameter::text_sink& out) const {
+        this->for_each([&out](const auto& param) {
+            param.print(out);
+        });
+    }
+
+    void reset() {
+        parameter::transaction batch(LUN);
+
+        this->for_each([](auto& param) {
+            param.reset();
+        });
+    }
+
+    // get_crc matches unique_parameter_list::get_crc() for the same
+    // parameters and values.
+    uint32_t get_crc() const {
+        return m_crc.fold([this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot]);
+        });
+    }
+
+    // migrate moves stored values from the keys old_hash derives from the
+    // parameter names to their current UIDs; see
+    // unique_parameter_list::migrate().
+    bool migrate(parameter::uid_value_t (*old_hash)(std::string_view)) {
+        parameter::transaction batch(LUN);
+
+        bool ok = true;
+        for (auto* param : m_params) {
+            const parameter::uid_value_t old_uid = old_hash(param->name());
+            if (old_uid != param->uid() && !param->rekey(old_uid)) {
+                ok = false;
+            }
+        }
+
+        return batch.commit() && ok;
+    }
+
+    // snapshot_size is the buffer size snapshot() needs, known at compile
+    // time so the buffer can be a static array.
+    static constexpr size_t snapshot_size() {
+        size_t size = parameter::snapshot_writer::overhead;
+        for (const auto& entry : table) {
+            size += parameter::snapshot_writer::record_size(entry.size);
+        }
+        return size;
+    }
+
+    static constexpr size_t manifest_size() {
+        return parameter::snapshot_writer::manifest_size(schema_t::size);
+    }
+
+    // snapshot, restore, manifest and delta use the same blob formats as
+    // their unique_parameter_list counterparts.
+    size_t snapshot(uint8_t* buffer, size_t size) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot]);
+        };
+        return _write_snapshot(schema_t::size, param_at, buffer, size);
+    }
+
+    size_t manifest(uint8_t* buffer, size_t size) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot]);
+        };
+        return _write_manifest(schema_t::size, param_at, buffer, size);
+    }
+
+    size_t delta(
+        const uint8_t* base,
+        size_t         base_size,
+        uint8_t*       buffer,
+        size_t         size
+    ) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot]);
+        };
+        return _write_delta(
+            schema_t::size, param_at, base, base_size, buffer, size
+        );
+    }
+
+    bool restore(const uint8_t* buffer, size_t size) {
+        return _restore_snapshot(buffer, size, [this](auto uid) {
+            return this->find(uid);
+        });
+    }
+
+    // export_values and import_values behave as their
+    // unique_parameter_list counterparts.
+    bool export_values(parameter::value_writer& out) const {
+        auto param_at = [this](size_t slot) {
+            return static_cast<const unique_parameter_i*>(m_params[slot]);
+        };
+        return _export_values(schema_t::size, param_at, out);
+    }
+
+    bool import_values(parameter::value_reader& in) {
+        return _import_values(in, [this](auto uid) {
+            return this->find(uid);
+        });
+    }
+
+    // lookup returns the declaration index of uid, or npos.
+    static constexpr size_t lookup(parameter::uid_value_t uid) {
+        size_t first = 0;
+        size_t count = table.size();
+        while (count > 0) {
+            const size_t half = count / 2;
+            if (table[first + half].uid < uid) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        if (first < table.size() && table[first].uid == uid) {
+            return table[first].index;
+        }
+        return npos;
+    }
+
+    static constexpr bool uid_exists(parameter::uid_value_t uid) {
+        return lookup(uid) != npos;
+    }
+
+    unique_parameter_i* find(parameter::uid_value_t uid) {
+        const size_t index = lookup(uid);
+        return index == npos ? nullptr : m_params[index];
+    }
+
+    const unique_parameter_i* find(parameter::uid_value_t uid) const {
+        const size_t index = lookup(uid);
+        return index == npos ? nullptr : m_params[index];
+    }
+
+    // at returns the parameter declared at index, see
+    // unique_parameter_list::at().
+    const unique_parameter_i* at(size_t index) const {
+        return index < schema_t::size ? m_params[index] : nullptr;
+    }
+
+   private:
+    template <typename F, size_t... Is>
+    void for_each(F& f, std::index_sequence<Is...>) {
+        (f(this->template get<Is>()), ...);
+        (void)f;
+    }
+
+    template <typename F, size_t... Is>
+    void for_each(F& f, std::index_sequence<Is...>) const {
+        (f(this->template get<Is>()), ...);
+        (void)f;
+    }
+
+    typename traits::slots                          m_slots;
+    delegate<void(const char*)>                     m_print;
+    std::array<unique_parameter_i*, schema_t::size> m_params{};
+    mutable _crc_tracker<schema_t::size>            m_crc;
+
+    template <size_t... Is>
+    void attach(std::index_sequence<Is...>) {
+        ((m_params[Is] = &this->template get<Is>()), ...);
+        for (size_t slot = 0; slot < schema_t::size; ++slot) {
+            m_params[slot]->on_dirty([this, slot]() {
+                m_crc.mark_dirty(slot);
+            });
+            m_crc.mark_dirty(slot);
+        }
+    }
+};
+
+}  // namespace cgx
@@ -0,0 +1,230 @@
+#pragma once
+
+// Snapshot blobs: a whole parameter list serialized into one contiguous,
+// versioned buffer. All fields are in native byte order and records are
+// packed back to back without padding:
+//
+//   snapshot_header_t
+//   count x { snapshot_record_t, payload[size] }
+//   uint32_t crc of every byte before it
+//
+// A delta is a snapshot holding only the records that changed, so restore()
+// applies it as well. A CRC manifest uses the same layout with its own
+// magic; each record's payload is the parameter's get_crc().
+//
+// The writer and reader never allocate; the list functions that drive them
+// live in parameter.hpp.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "crc.hpp"
+#include "uid.hpp"
+
+namespace cgx::parameter {
+
+struct snapshot_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t key_version;
+    uint32_t count;
+    uint32_t size;  // whole blob, trailing CRC included
+};
+
+struct snapshot_record_t {
+    uid_value_t uid;
+    uint32_t    size;
+    uint32_t    type;  // _type_id<T>() of the stored value
+};
+
+constexpr uint32_t snapshot_magic   = 0x53584743;  // "CGXS"
+constexpr uint32_t manifest_magic   = 0x4D584743;  // "CGXM"
+constexpr uint16_t snapshot_version = 1;
+
+class snapshot_writer {
+   public:
+    // overhead is the size of an empty snapshot.
+    static constexpr size_t overhead =
+        sizeof(snapshot_header_t) + sizeof(uint32_t);
+
+    static constexpr size_t record_size(size_t payload) {
+        return sizeof(snapshot_record_t) + payload;
+    }
+
+    // manifest_size is the size of a CRC manifest of count parameters.
+    static constexpr size_t manifest_size(size_t count) {
+        return overhead + count * record_size(sizeof(uint32_t));
+    }
+
+    snapshot_writer(
+        uint8_t* buffer,
+        size_t   size,
+        uint32_t magic = snapshot_magic
+    )
+        : m_buffer(buffer)
+        , m_size(size)
+        , m_used(sizeof(snapshot_header_t))
+        , m_magic(magic) {
+        m_ok = buffer != nullptr && size >= overhead;
+    }
+
+    // append adds a record and returns where its size bytes of payload go,
+    // or nullptr if the buffer is full.
+    uint8_t* append(uid_value_t uid, uint32_t type, size_t size) {
+        if (!m_ok || m_used + record_size(size) + sizeof(uint32_t) > m_size) {
+            m_ok = false;
+            return nullptr;
+        }
+        const snapshot_record_t record{uid, static_cast<uint32_t>(size), type};
+        std::memcpy(m_buffer + m_used, &record, sizeof(record));
+        uint8_t* payload = m_buffer + m_used + sizeof(record);
+        m_last           = m_used;
+        m_used += record_size(size);
+        m_count += 1;
+        return payload;
+    }
+
+    // drop removes the record added by the last successful append().
+    void drop() {
+        m_used = m_last;
+        m_count -= 1;
+    }
+
+    // finish writes the header and the trailing CRC. Returns the size of the
+    // blob, or 0 if any record did not fit.
+    size_t finish() {
+        if (!m_ok) {
+            return 0;
+        }
+        const size_t            total = m_used + sizeof(uint32_t);
+        const snapshot_header_t header{
+            m_magic,
+            snapshot_version,
+            static_cast<uint16_t>(key_version),
+            m_count,
+            static_cast<uint32_t>(total),
+        };
+        std::memcpy(m_buffer, &header, sizeof(header));
+        const uint32_t crc = _calc_crc(m_buffer, m_used);
+        std::memcpy(m_buffer + m_used, &crc, sizeof(crc));
+        return total;
+    }
+
+   private:
+    uint8_t* m_buffer;
+    size_t   m_size;
+    size_t   m_used;
+    size_t   m_last{0};
+    uint32_t m_magic;
+    uint32_t m_count{0};
+    bool     m_ok;
+};
+
+class snapshot_reader {
+   public:
+    struct record_t {
+        uid_value_t    uid;
+        uint32_t       type;
+        size_t         size;
+        const uint8_t* data;
+    };
+
+    // open checks the header, the CRC and that every record lies inside the
+    // blob, so next() can walk it without further bounds checks.
+    bool open(
+        const uint8_t* buffer,
+        size_t         size,
+        uint32_t       magic = snapshot_magic
+    ) {
+        m_buffer = nullptr;
+        if (buffer == nullptr || size < snapshot_writer::overhead) {
+            return false;
+        }
+        snapshot_header_t header;
+        std::memcpy(&header, buffer, sizeof(header));
+        if (header.magic != magic ||
+            header.version != snapshot_version ||
+            _key_version(header.key_version) != key_version ||
+            header.size != size) {
+            return false;
+        }
+
+        const size_t body = size - sizeof(uint32_t);
+        uint32_t     crc;
+        std::memcpy(&crc, buffer + body, sizeof(crc));
+        if (_calc_crc(buffer, body) != crc) {
+            return false;
+        }
+
+        size_t offset = sizeof(snapshot_header_t);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            snapshot_record_t record;
+            if (offset + sizeof(record) > body) {
+                return false;
+            }
+            std::memcpy(&record, buffer + offset, sizeof(record));
+            if (record.size > body - offset - sizeof(record)) {
+                return false;
+            }
+            offset += snapshot_writer::record_size(record.size);
+        }
+        if (offset != body) {
+            return false;
+        }
+
+        m_buffer = buffer;
+        m_count  = header.count;
+        this->rewind();
+        return true;
+    }
+
+    size_t count() const {
+        return m_count;
+    }
+
+    void rewind() {
+        m_offset = sizeof(snapshot_header_t);
+        m_index  = 0;
+    }
+
+    bool next(record_t& out) {
+        if (m_buffer == nullptr || m_index >= m_count) {
+            return false;
+        }
+        snapshot_record_t record;
+        std::memcpy(&record, m_buffer + m_offset, sizeof(record));
+        out = record_t{
+            record.uid,
+            record.type,
+            record.size,
+            m_buffer + m_offset + sizeof(record),
+        };
+        m_offset += snapshot_writer::record_size(record.size);
+        m_index += 1;
+        return true;
+    }
+
+    // find looks up uid, scanning on from the last record returned and
+    // wrapping around once. Blobs written by a list with the same layout are
+    // looked up in order, which keeps a full pass linear.
+    bool find(uid_value_t uid, record_t& out) {
+        for (size_t i = 0; i < m_count; ++i) {
+            if (m_index >= m_count) {
+                this->rewind();
+            }
+            if (this->next(out) && out.uid == uid) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+   private:
+    const uint8_t* m_buffer{nullptr};
+    size_t         m_count{0};
+    size_t         m_offset{0};
+    size_t         m_index{0};
+};
+
+}  // namespace cgx::parameter
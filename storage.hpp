@@ -0,0 +1,341 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "uid.hpp"
+
+// A thread may keep transactions open on up to this many LUNs at once, e.g.
+// when a callback run by reset() of LUN 0 stores a parameter of LUN 1.
+#ifndef CGX_PARAMETER_STORAGE_NESTING
+#define CGX_PARAMETER_STORAGE_NESTING 4
+#endif
+
+namespace cgx::parameter {
+
+// _in_range tells whether [offset, offset + size) lies within total bytes.
+constexpr bool _in_range(size_t offset, size_t size, size_t total) {
+    return offset <= total && size <= total - offset;
+}
+
+// Per-UID storage hooks. These must be provided by the application and are
+// used whenever no batched backend is installed with set_storage().
+// get_bytes() should fail without writing to dst when the record is
+// missing or of another size, as storage_i::read() does.
+extern bool
+set_bytes(size_t lun, uid_value_t uid, const uint8_t* src, size_t len);
+extern bool get_bytes(size_t lun, uid_value_t uid, uint8_t* dst, size_t len);
+
+struct record_t {
+    uid_value_t uid;
+    uint8_t*    data;
+    size_t      size;
+    bool        ok;
+};
+
+struct const_record_t {
+    uid_value_t    uid;
+    const uint8_t* data;
+    size_t         size;
+    bool           ok;
+};
+
+// storage_i is an optional batched backend. Reads and writes issued between
+// begin() and commit() belong to one transaction, which lets the backend keep
+// its file or flash session open and flush once. Calls made outside of a
+// transaction are wrapped in an implicit single-record one.
+class storage_i {
+   public:
+    virtual ~storage_i() = default;
+
+    virtual bool begin(size_t lun)  = 0;
+    virtual bool commit(size_t lun) = 0;
+
+    // read fails without writing to dst when the record of uid is missing
+    // or not len bytes long. Large values are loaded straight into the
+    // parameter, which relies on this.
+    virtual bool
+    read(size_t lun, uid_value_t uid, uint8_t* dst, size_t len) = 0;
+    virtual bool
+    write(size_t lun, uid_value_t uid, const uint8_t* src, size_t len) = 0;
+
+    // read_at and write_at transfer len bytes at offset inside the record of
+    // uid, which must already exist. Backends that cannot address part of a
+    // record keep these defaults, which fail so that callers fall back to
+    // the whole record.
+    virtual bool read_at(
+        size_t      lun,
+        uid_value_t uid,
+        size_t      offset,
+        uint8_t*    dst,
+        size_t      len
+    ) {
+        (void)lun;
+        (void)uid;
+        (void)offset;
+        (void)dst;
+        (void)len;
+        return false;
+    }
+
+    virtual bool write_at(
+        size_t         lun,
+        uid_value_t    uid,
+        size_t         offset,
+        const uint8_t* src,
+        size_t         len
+    ) {
+        (void)lun;
+        (void)uid;
+        (void)offset;
+        (void)src;
+        (void)len;
+        return false;
+    }
+
+    // read_many and write_many return the number of records transferred and
+    // set each record's ok flag. Backends that can gather several records in
+    // one access should override them.
+    virtual size_t read_many(size_t lun, record_t* records, size_t count) {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto& r = records[i];
+            r.ok    = this->read(lun, r.uid, r.data, r.size);
+            n += r.ok ? 1 : 0;
+        }
+        return n;
+    }
+
+    virtual size_t
+    write_many(size_t lun, const_record_t* records, size_t count) {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto& r = records[i];
+            r.ok    = this->write(lun, r.uid, r.data, r.size);
+            n += r.ok ? 1 : 0;
+        }
+        return n;
+    }
+
+    // Nesting-aware wrappers around begin()/commit(). Only the outermost
+    // pair of each LUN reaches the backend, so a nested enter() on another
+    // LUN begins a transaction there that commits when it is left. Each
+    // enter() must be paired with leave(), even when it failed. A
+    // transaction belongs to the thread that entered it; other threads wait
+    // in enter() until every LUN is left.
+    bool enter(size_t lun) {
+        m_lock.lock();
+        if (m_overflow > 0) {
+            m_overflow += 1;
+            return false;
+        }
+        if (m_used > 0 && m_frames[m_used - 1].lun == lun) {
+            m_frames[m_used - 1].depth += 1;
+            return m_frames[m_used - 1].ok;
+        }
+        if (m_used == m_frames.size()) {
+            m_overflow = 1;
+            return false;
+        }
+        // Going back to a LUN that is open further down shares its
+        // transaction.
+        const frame_t* open = this->find(lun);
+        if (m_used == 0) {
+            m_owner.store(
+                std::this_thread::get_id(), std::memory_order_relaxed
+            );
+        }
+        frame_t& f = m_frames[m_used++];
+        f          = {lun, 1, open != nullptr && open->ok, open == nullptr};
+        if (f.owner) {
+            f.ok = this->begin(lun);
+        }
+        return f.ok;
+    }
+
+    bool leave() {
+        assert("unbalanced transaction" && in_transaction());
+        if (m_overflow > 0) {
+            m_overflow -= 1;
+            m_lock.unlock();
+            return false;
+        }
+        frame_t& f  = m_frames[m_used - 1];
+        bool     ok = f.ok;
+        if (--f.depth == 0) {
+            // A failed begin() is expected to clean up after itself.
+            ok = f.ok && (!f.owner || this->commit(f.lun));
+            if (--m_used == 0) {
+                m_owner.store(std::thread::id{}, std::memory_order_relaxed);
+            }
+        }
+        m_lock.unlock();
+        return ok;
+    }
+
+    // in_transaction tells whether the calling thread is inside a
+    // transaction.
+    bool in_transaction() const {
+        return m_owner.load(std::memory_order_relaxed) ==
+               std::this_thread::get_id();
+    }
+
+    bool in_transaction(size_t lun) const {
+        return in_transaction() && this->find(lun) != nullptr;
+    }
+
+   private:
+    // A frame is pushed whenever enter() switches LUN. owner tells whether
+    // it began the backend transaction, or shares one further down.
+    struct frame_t {
+        size_t lun;
+        size_t depth;
+        bool   ok;
+        bool   owner;
+    };
+
+    const frame_t* find(size_t lun) const {
+        for (size_t i = 0; i < m_used; ++i) {
+            if (m_frames[i].lun == lun) {
+                return &m_frames[i];
+            }
+        }
+        return nullptr;
+    }
+
+    std::recursive_mutex                               m_lock;
+    std::atomic<std::thread::id>                       m_owner{};
+    std::array<frame_t, CGX_PARAMETER_STORAGE_NESTING> m_frames{};
+    size_t                                             m_used{0};
+    size_t                                             m_overflow{0};
+};
+
+inline storage_i*& _storage() {
+    static storage_i* storage = nullptr;
+    return storage;
+}
+
+// set_storage installs a batched backend for every LUN. Passing nullptr
+// falls back to the per-UID set_bytes()/get_bytes() hooks.
+inline void set_storage(storage_i* storage) {
+    _storage() = storage;
+}
+
+inline storage_i* get_storage() {
+    return _storage();
+}
+
+// load and save route a single record to the installed backend, or to the
+// per-UID hooks when there is none.
+inline bool load(size_t lun, uid_value_t uid, uint8_t* dst, size_t len) {
+    storage_i* storage = get_storage();
+    if (storage == nullptr) {
+        return get_bytes(lun, uid, dst, len);
+    }
+    if (storage->in_transaction(lun)) {
+        return storage->read(lun, uid, dst, len);
+    }
+    bool ok = storage->enter(lun) && storage->read(lun, uid, dst, len);
+    return storage->leave() && ok;
+}
+
+inline bool save(size_t lun, uid_value_t uid, const uint8_t* src, size_t len) {
+    storage_i* storage = get_storage();
+    if (storage == nullptr) {
+        return set_bytes(lun, uid, src, len);
+    }
+    if (storage->in_transaction(lun)) {
+        return storage->write(lun, uid, src, len);
+    }
+    bool ok = storage->enter(lun) && storage->write(lun, uid, src, len);
+    return storage->leave() && ok;
+}
+
+// load_at and save_at route part of a record to the installed backend. The
+// per-UID hooks cannot address part of a record, so without a backend, or
+// with one that keeps the storage_i defaults, they fail.
+inline bool load_at(
+    size_t      lun,
+    uid_value_t uid,
+    size_t      offset,
+    uint8_t*    dst,
+    size_t      len
+) {
+    storage_i* storage = get_storage();
+    if (storage == nullptr) {
+        return false;
+    }
+    if (storage->in_transaction(lun)) {
+        return storage->read_at(lun, uid, offset, dst, len);
+    }
+    bool ok =
+        storage->enter(lun) && storage->read_at(lun, uid, offset, dst, len);
+    return storage->leave() && ok;
+}
+
+// _record_has_size tells whether the record of uid ends exactly at len,
+// with two one-byte load_at() calls. It fails for backends that cannot
+// address part of a record.
+inline bool _record_has_size(size_t lun, uid_value_t uid, size_t len) {
+    uint8_t byte;
+    return len > 0 && load_at(lun, uid, len - 1, &byte, 1) &&
+           !load_at(lun, uid, len, &byte, 1);
+}
+
+inline bool save_at(
+    size_t         lun,
+    uid_value_t    uid,
+    size_t         offset,
+    const uint8_t* src,
+    size_t         len
+) {
+    storage_i* storage = get_storage();
+    if (storage == nullptr) {
+        return false;
+    }
+    if (storage->in_transaction(lun)) {
+        return storage->write_at(lun, uid, offset, src, len);
+    }
+    bool ok =
+        storage->enter(lun) && storage->write_at(lun, uid, offset, src, len);
+    return storage->leave() && ok;
+}
+
+// transaction groups every load()/save() in its scope into one backend
+// batch. It is a no-op when no batched backend is installed.
+class transaction {
+   public:
+    explicit transaction(size_t lun) : m_storage(get_storage()) {
+        if (m_storage) {
+            m_ok = m_storage->enter(lun);
+        }
+    }
+    transaction(const transaction&)            = delete;
+    transaction& operator=(const transaction&) = delete;
+    ~transaction() {
+        commit();
+    }
+
+    bool commit() {
+        if (m_storage) {
+            m_ok      = m_storage->leave() && m_ok;
+            m_storage = nullptr;
+        }
+        return m_ok;
+    }
+
+    bool ok() const {
+        return m_ok;
+    }
+
+   private:
+    storage_i* m_storage{nullptr};
+    bool       m_ok{true};
+};
+
+}  // namespace cgx::parameter
@@ -0,0 +1,316 @@
+#pragma once
+
+// Typed change subscriptions. Each subscriber owns its subscription node,
+// which is linked into the parameter's intrusive list, so a parameter takes
+// any number of subscribers for the cost of one pointer and nothing is
+// allocated.
+//
+//   cgx::parameter::subscription<float> log(
+//       [](const auto& param, const float& old_value, const float& value) {
+//           ...
+//       }
+//   );
+//   gain.subscribe(log);
+//
+// A coalescing subscription records changes instead of delivering them and
+// flush(), called once per frame or tick, reports the value before the first
+// change together with the current one. While a parameter is held, e.g. in a
+// list transaction, every subscription coalesces until release().
+//
+// Each subscription keeps a copy of the old value. Parameters whose values
+// are too large for the stack save the old value into those copies before
+// a change instead of copying it to the stack.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "delegate.hpp"
+
+namespace cgx::parameter {
+
+template <typename T>
+class parameter;
+
+template <typename T>
+class subscription;
+
+template <typename T>
+void _assign(T& dst, const T& src) {
+    if constexpr (std::is_array_v<T>) {
+        std::copy(std::begin(src), std::end(src), std::begin(dst));
+    } else {
+        dst = src;
+    }
+}
+
+// _subscribers is the head of a parameter's subscription list. A copied
+// parameter starts without subscribers.
+template <typename T>
+class _subscribers {
+   public:
+    using node = subscription<T>;
+
+    _subscribers() = default;
+    _subscribers(const _subscribers&) {
+    }
+    _subscribers& operator=(const _subscribers&) {
+        return *this;
+    }
+    ~_subscribers() {
+        while (m_head != nullptr) {
+            m_head->unsubscribe();
+        }
+    }
+
+    explicit operator bool() const {
+        return m_head != nullptr;
+    }
+
+    template <typename... Args>
+    void add(node& sub, Args&&... args) {
+        sub.unsubscribe();
+        sub.attach(*this, std::forward<Args>(args)...);
+        sub.m_next = m_head;
+        m_head     = &sub;
+    }
+
+    void remove(node& sub) {
+        for (node** link = &m_head; *link != nullptr;
+             link        = &(*link)->m_next) {
+            if (*link == &sub) {
+                *link = sub.m_next;
+                break;
+            }
+        }
+    }
+
+    template <typename... Args>
+    void publish(bool held, const Args&... args) {
+        for (node* sub = m_head; sub != nullptr;) {
+            // The callback may unsubscribe sub.
+            node* next = sub->m_next;
+            sub->changed(held, args...);
+            sub = next;
+        }
+    }
+
+    // save hands every subscription the value before a change, which a
+    // following publish(held) without an old value delivers.
+    template <typename V>
+    void save(const V& old_value) {
+        for (node* sub = m_head; sub != nullptr; sub = sub->m_next) {
+            sub->save(old_value);
+        }
+    }
+
+    // release delivers, or with notify unset drops, what non-coalescing
+    // subscriptions recorded while the parameter was held.
+    void release(bool notify) {
+        for (node* sub = m_head; sub != nullptr;) {
+            node* next = sub->m_next;
+            if (!sub->m_coalesce) {
+                if (notify) {
+                    sub->flush();
+                } else {
+                    sub->m_pending = false;
+                }
+            }
+            sub = next;
+        }
+    }
+
+   private:
+    node* m_head{nullptr};
+};
+
+// subscription<T> delivers (parameter, old value, new value) for every
+// change of a parameter<T>.
+template <typename T>
+class subscription {
+   public:
+    using callback_t = delegate<void(
+        const parameter<T>& param,
+        const T&            old_value,
+        const T&            new_value
+    )>;
+
+    explicit subscription(callback_t callback, bool coalesce = false)
+        : m_callback(callback), m_coalesce(coalesce) {
+    }
+    subscription(const subscription&)            = delete;
+    subscription& operator=(const subscription&) = delete;
+    ~subscription() {
+        this->unsubscribe();
+    }
+
+    void unsubscribe() {
+        if (m_owner != nullptr) {
+            m_owner->remove(*this);
+            m_owner   = nullptr;
+            m_pending = false;
+        }
+    }
+
+    bool pending() const {
+        return m_pending;
+    }
+
+    // flush delivers a recorded change. Returns false if there was none.
+    bool flush() {
+        if (!m_pending) {
+            return false;
+        }
+        m_pending = false;
+        if (m_callback) {
+            m_callback(*m_param, m_old, *m_value);
+        }
+        return true;
+    }
+
+   private:
+    friend class _subscribers<T>;
+
+    callback_t          m_callback;
+    _subscribers<T>*    m_owner{nullptr};
+    subscription*       m_next{nullptr};
+    const parameter<T>* m_param{nullptr};
+    const T*            m_value{nullptr};
+    T                   m_old{};
+    bool                m_pending{false};
+    bool                m_saved{false};
+    bool                m_coalesce;
+
+    void attach(
+        _subscribers<T>&    owner,
+        const parameter<T>& param,
+        const T&            value
+    ) {
+        m_owner = &owner;
+        m_param = &param;
+        m_value = &value;
+    }
+
+    void changed(bool held, const T& old_value) {
+        if (m_coalesce || held) {
+            if (!m_pending) {
+                _assign(m_old, old_value);
+                m_pending = true;
+            }
+            return;
+        }
+        if (m_callback) {
+            m_callback(*m_param, old_value, *m_value);
+        }
+    }
+
+    // save keeps the old value unless a recorded change already did.
+    void save(const T& old_value) {
+        if (!m_pending) {
+            _assign(m_old, old_value);
+        }
+        m_saved = true;
+    }
+
+    // changed(held) delivers the value save() kept. A subscription added
+    // after save(), e.g. by on_changed, has nothing to deliver.
+    void changed(bool held) {
+        if (!m_saved) {
+            return;
+        }
+        m_saved = false;
+        if (m_coalesce || held) {
+            m_pending = true;
+            return;
+        }
+        if (m_callback) {
+            m_callback(*m_param, m_old, *m_value);
+        }
+    }
+};
+
+// Array subscriptions report the range [first, last) of changed elements
+// rather than copies of the whole array. Coalesced ranges are merged.
+template <typename T, size_t N>
+class subscription<std::array<T, N>> {
+   public:
+    using callback_t = delegate<void(
+        const parameter<std::array<T, N>>& param,
+        size_t                             first,
+        size_t                             last
+    )>;
+
+    explicit subscription(callback_t callback, bool coalesce = false)
+        : m_callback(callback), m_coalesce(coalesce) {
+    }
+    subscription(const subscription&)            = delete;
+    subscription& operator=(const subscription&) = delete;
+    ~subscription() {
+        this->unsubscribe();
+    }
+
+    void unsubscribe() {
+        if (m_owner != nullptr) {
+            m_owner->remove(*this);
+            m_owner   = nullptr;
+            m_pending = false;
+        }
+    }
+
+    bool pending() const {
+        return m_pending;
+    }
+
+    bool flush() {
+        if (!m_pending) {
+            return false;
+        }
+        m_pending = false;
+        if (m_callback) {
+            m_callback(*m_param, m_first, m_last);
+        }
+        return true;
+    }
+
+   private:
+    friend class _subscribers<std::array<T, N>>;
+
+    callback_t                         m_callback;
+    _subscribers<std::array<T, N>>*    m_owner{nullptr};
+    subscription*                      m_next{nullptr};
+    const parameter<std::array<T, N>>* m_param{nullptr};
+    size_t                             m_first{0};
+    size_t                             m_last{0};
+    bool                               m_pending{false};
+    bool                               m_coalesce;
+
+    void attach(
+        _subscribers<std::array<T, N>>&    owner,
+        const parameter<std::array<T, N>>& param
+    ) {
+        m_owner = &owner;
+        m_param = &param;
+    }
+
+    void changed(bool held, size_t first, size_t last) {
+        if (m_coalesce || held) {
+            if (!m_pending) {
+                m_first   = first;
+                m_last    = last;
+                m_pending = true;
+            } else {
+                m_first = std::min(m_first, first);
+                m_last  = std::max(m_last, last);
+            }
+            return;
+        }
+        if (m_callback) {
+            m_callback(*m_param, first, last);
+        }
+    }
+};
+
+}  // namespace cgx::parameter
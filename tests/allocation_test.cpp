@@ -0,0 +1,162 @@
+// allocation_test checks that a list with an arena never allocates once it
+// is set up: after init() the global operator new is armed to fail, and
+// parameters are added, changed, stored, printed and snapshotted.
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "../parameter.hpp"
+
+namespace {
+
+bool   g_armed       = false;
+size_t g_allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+    if (g_armed) {
+        g_allocations += 1;
+        throw std::bad_alloc();
+    }
+    if (void* p = std::malloc(size > 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// Kept out of line so that GCC does not see free() paired with new.
+[[gnu::noinline]] void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// A fixed table of records stands in for the backend, so storing does not
+// allocate either.
+struct record {
+    cgx::parameter::uid_value_t uid;
+    size_t                      size;
+    uint8_t                     data[64];
+};
+
+std::array<record, 8> g_records{};
+
+record* find(cgx::parameter::uid_value_t uid, bool create) {
+    for (auto& r : g_records) {
+        if (r.size != 0 && r.uid == uid) {
+            return &r;
+        }
+    }
+    for (auto& r : g_records) {
+        if (create && r.size == 0) {
+            r.uid = uid;
+            return &r;
+        }
+    }
+    return nullptr;
+}
+
+size_t g_lines = 0;
+
+void count_lines(const char*) {
+    g_lines += 1;
+}
+
+struct pair_t {
+    int a;
+    int b;
+
+    int to_char(char* dst, size_t size) const {
+        return std::snprintf(dst, size, "a=%d, b=%d", a, b);
+    }
+
+    bool operator==(const pair_t& other) const {
+        return a == other.a && b == other.b;
+    }
+};
+
+constexpr size_t arena =
+    cgx::arena_size<int, float, char[6], std::array<pair_t, 4>, bool>();
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(
+    size_t, uid_value_t uid, const uint8_t* src, size_t len
+) {
+    record* r = find(uid, true);
+    if (r == nullptr || len > sizeof(r->data)) {
+        return false;
+    }
+    std::memcpy(r->data, src, len);
+    r->size = len;
+    return true;
+}
+
+bool cgx::parameter::get_bytes(
+    size_t, uid_value_t uid, uint8_t* dst, size_t len
+) {
+    const record* r = find(uid, false);
+    if (r == nullptr || r->size != len) {
+        return false;
+    }
+    std::memcpy(dst, r->data, len);
+    return true;
+}
+
+int main() {
+    static cgx::unique_parameter_list<0, 8, arena> params(count_lines);
+
+    auto& i = params.add("i", 1);
+    auto& f = params.add("f", 2.0f);
+    auto& t = params.add("t", "hello");
+    auto& a = params.add("a", std::array<pair_t, 4>{});
+
+    int changes = 0;
+    i.on_changed([&changes]() {
+        changes += 1;
+    });
+    const bool init = params.init();
+
+    g_armed = true;
+    bool ok = init;
+    try {
+        auto& b = params.add("b", false);
+
+        i    = 5;
+        f    = 3.0f;
+        t    = "world";
+        a[1] = pair_t{1, 2};
+        b    = true;
+        ok   = ok && i.store() && params.store_all();
+
+        params.print();
+        ok = ok && params.get_crc() != 0;
+
+        uint8_t      buffer[512];
+        const size_t n = params.snapshot(buffer, sizeof(buffer));
+        params.reset();
+        ok = ok && n != 0 && params.restore(buffer, n) && i == 5 && b;
+    } catch (const std::bad_alloc&) {
+        ok = false;
+    }
+    g_armed = false;
+
+    std::printf(
+        "%zu allocations, %zu lines, %d changes, arena %zu/%zu\n",
+        g_allocations,
+        g_lines,
+        changes,
+        params.arena_used(),
+        arena
+    );
+    return ok && g_allocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+// codec_test round-trips int, float, char[N], std::array and bool values
+// through export_values() and import_values() in JSON and CBOR. Import
+// skips an unknown key whatever it nests, ignores a key longer than
+// CGX_PARAMETER_NAME_SIZE even when its start names a parameter, decodes
+// JSON string escapes, and fails on every truncation of a valid document.
+// Exits non-zero on a failed check.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "../cbor.hpp"
+#include "../json.hpp"
+#include "../parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+using cgx::parameter::byte_output;
+using cgx::parameter::cbor_reader;
+using cgx::parameter::cbor_writer;
+using cgx::parameter::json_reader;
+using cgx::parameter::json_writer;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+using list_t = cgx::unique_parameter_list<0, 8>;
+
+// values holds one parameter of every type the codec maps.
+struct values {
+    list_t                                     params{discard};
+    cgx::unique_parameter<int>&                i = params.add("i", 0);
+    cgx::unique_parameter<float>&              f = params.add("f", 0.0f);
+    cgx::unique_parameter<char[24]>&           s =
+        params.add("s", "-----------------------");
+    cgx::unique_parameter<std::array<int, 3>>& a =
+        params.add("a", std::array<int, 3>{});
+    cgx::unique_parameter<bool>& b = params.add("b", false);
+
+    void fill() {
+        i = std::numeric_limits<int>::min();
+        f = 0.1f;
+        s = "a\"b\\c\n\t\x01/";
+        a = std::array<int, 3>{-1, 0, 1 << 30};
+        b = true;
+    }
+
+    bool same(const values& other) const {
+        return i == other.i && f == other.f &&
+               std::strcmp(s.value(), other.s.value()) == 0 &&
+               a.value() == other.a.value() && b == other.b;
+    }
+};
+
+// document is an encoded buffer and its length.
+struct document {
+    std::array<uint8_t, 512> bytes{};
+    size_t                   size = 0;
+};
+
+struct json {
+    static document write(const list_t& params) {
+        document    doc;
+        byte_output out(doc.bytes.data(), doc.bytes.size());
+        json_writer writer(out);
+        check(params.export_values(writer), "json export");
+        doc.size = out.size();
+        return doc;
+    }
+
+    static bool read(list_t& params, const uint8_t* data, size_t size) {
+        json_reader reader(data, size);
+        return params.import_values(reader) && reader.finish();
+    }
+};
+
+struct cbor {
+    static document write(const list_t& params) {
+        document    doc;
+        byte_output out(doc.bytes.data(), doc.bytes.size());
+        cbor_writer writer(out);
+        check(params.export_values(writer), "cbor export");
+        doc.size = out.size();
+        return doc;
+    }
+
+    static bool read(list_t& params, const uint8_t* data, size_t size) {
+        cbor_reader reader(data, size);
+        return params.import_values(reader) && reader.finish();
+    }
+};
+
+// round_trip exports filled values and imports them into defaults, then
+// imports every proper prefix of the document, which must fail.
+template <typename Format>
+void round_trip(const char* name) {
+    values from;
+    from.fill();
+    const document doc = Format::write(from.params);
+    check(doc.size != 0, name);
+
+    values to;
+    check(Format::read(to.params, doc.bytes.data(), doc.size), name);
+    check(to.same(from), name);
+
+    bool rejected = true;
+    for (size_t size = 0; size < doc.size; ++size) {
+        values cut;
+        rejected = !Format::read(cut.params, doc.bytes.data(), size) &&
+                   rejected;
+    }
+    check(rejected, "every truncation rejected");
+}
+
+bool read_json(list_t& params, std::string_view text) {
+    json_reader reader(text.data(), text.size());
+    return params.import_values(reader) && reader.finish();
+}
+
+// An unknown key is skipped with everything it nests, including brackets
+// inside strings.
+void unknown_key() {
+    values to;
+    check(
+        read_json(
+            to.params,
+            R"({"x": {"a": [1, {"b": "]}"}, null, -2.5e3], "c": {}},)"
+            R"( "i": 5, "y": [[[]]], "b": true})"
+        ),
+        "json unknown key"
+    );
+    check(to.i == 5 && to.b, "json values around an unknown key");
+
+    // The same in CBOR, written with cbor_writer.
+    document    doc;
+    byte_output out(doc.bytes.data(), doc.bytes.size());
+    cbor_writer writer(out);
+    const bool  written =
+        writer.begin_object(3) && writer.key("x") && writer.begin_object(1) &&
+        writer.key("a") && writer.begin_array(3) && writer.write_int(1) &&
+        writer.begin_object(1) && writer.key("b") &&
+        writer.write_bytes(doc.bytes.data(), 4) && writer.end_object() &&
+        writer.write_double(-2.5e3) && writer.end_array() &&
+        writer.end_object() && writer.key("i") && writer.write_int(6) &&
+        writer.key("y") && writer.begin_array(1) && writer.begin_array(0) &&
+        writer.end_array() && writer.end_array() && writer.end_object();
+    check(written, "cbor nested value written");
+
+    values other;
+    check(cbor::read(other.params, doc.bytes.data(), out.size()), "cbor");
+    check(other.i == 6, "cbor value after an unknown key");
+}
+
+// A key longer than CGX_PARAMETER_NAME_SIZE cannot be matched: its start,
+// all that fits, must not be taken for the parameter of that name.
+void long_key() {
+    const std::string prefix(CGX_PARAMETER_NAME_SIZE - 1, 'k');
+    const std::string key = prefix + "-and-more";
+
+    list_t params(discard);
+    auto&  k = params.add(prefix.c_str(), 1);
+    auto&  i = params.add("i", 2);
+
+    const std::string text = "{\"" + key + "\": 10, \"i\": 20}";
+    check(read_json(params, text), "long key skipped");
+    check(k == 1 && i == 20, "long key not matched");
+
+    const std::string exact = "{\"" + prefix + "\": 30}";
+    check(read_json(params, exact) && k == 30, "longest name matched");
+}
+
+// JSON escapes, including \u with surrogate pairs, decode to UTF-8;
+// malformed ones fail.
+void escapes() {
+    values            to;
+    const char* const text =
+        R"({"s": "\"\\\/\b\f\n\r\t\u0041\u00e9\ud83d\ude00"})";
+    check(read_json(to.params, text), "escapes");
+    check(
+        std::strcmp(
+            to.s.value(), "\"\\/\b\f\n\r\tA\xC3\xA9\xF0\x9F\x98\x80"
+        ) == 0,
+        "escapes decoded"
+    );
+
+    const char* const bad[] = {
+        R"({"s": "\x"})",
+        R"({"s": "\u12"})",
+        R"({"s": "\ud83d"})",
+        R"({"s": "\ude00\ud83d"})",
+        "{\"s\": \"\x01\"}",
+    };
+    for (const char* malformed : bad) {
+        check(!read_json(to.params, malformed), malformed);
+    }
+
+    // Longer than the char[24] value.
+    const char* const long_text = R"({"s": "123456789012345678901234"})";
+    check(!read_json(to.params, long_text), "string too long");
+}
+
+// Floats survive JSON's shortest form and CBOR's bits; JSON writes
+// non-finite values as null, which reads back as NaN.
+void floats() {
+    const float table[] = {
+        0.1f,
+        -0.0f,
+        1e-30f,
+        3.4028235e38f,
+        std::numeric_limits<float>::denorm_min(),
+    };
+    for (const float value : table) {
+        // set_value() compares with ==, so -0.0f only replaces a value
+        // other than 0.0f.
+        values from;
+        values to_json;
+        values to_cbor;
+        from.f    = 1.0f;
+        from.f    = value;
+        to_json.f = 1.0f;
+        to_cbor.f = 1.0f;
+        const document j = json::write(from.params);
+        const document c = cbor::write(from.params);
+        check(json::read(to_json.params, j.bytes.data(), j.size), "json");
+        check(cbor::read(to_cbor.params, c.bytes.data(), c.size), "cbor");
+        check(to_json.f == value && to_cbor.f == value, "float kept");
+        check(
+            std::signbit(to_json.f.value()) == std::signbit(value) &&
+                std::signbit(to_cbor.f.value()) == std::signbit(value),
+            "float sign kept"
+        );
+    }
+
+    values from;
+    from.f = std::numeric_limits<float>::infinity();
+    values         to;
+    const document doc = json::write(from.params);
+    check(json::read(to.params, doc.bytes.data(), doc.size), "json null");
+    check(std::isnan(to.f.value()), "null reads as NaN");
+}
+
+}  // namespace
+
+int main() {
+    round_trip<json>("json round trip");
+    round_trip<cbor>("cbor round trip");
+    unknown_key();
+    long_key();
+    escapes();
+    floats();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
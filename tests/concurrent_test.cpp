@@ -0,0 +1,121 @@
+// concurrent_test hammers a concurrent<T> parameter with one writer and
+// several readers. Every value written has all of its words equal, so a
+// read that mixes two writes is caught. Then two writers count on_changed
+// calls in a plain counter, which only adds up if the callbacks are
+// serialized. Exits non-zero on a torn read or a lost callback.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "../concurrent_parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+struct value_t {
+    std::array<uint64_t, 16> words;
+
+    int to_char(char* dst, size_t size) const {
+        return std::snprintf(
+            dst, size, "%llu", static_cast<unsigned long long>(words[0])
+        );
+    }
+
+    bool operator==(const value_t& other) const {
+        return words == other.words;
+    }
+};
+
+constexpr size_t readers = 3;
+constexpr size_t writes  = 200000;
+constexpr size_t changes = 100000;
+
+void discard(const char*) {
+}
+
+bool consistent(const value_t& value) {
+    for (auto word : value.words) {
+        if (word != value.words[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    cgx::unique_parameter_list<0, 1> params(discard);
+    auto& shared = params.add("shared", cgx::concurrent<value_t>{});
+
+    std::atomic<bool>   done{false};
+    std::atomic<size_t> reads{0};
+    std::atomic<size_t> torn{0};
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < readers; ++i) {
+        threads.emplace_back([&]() {
+            size_t   n    = 0;
+            uint64_t last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                const value_t value = shared.value();
+                // The single writer only counts up.
+                if (!consistent(value) || value.words[0] < last) {
+                    torn.fetch_add(1, std::memory_order_relaxed);
+                }
+                last = value.words[0];
+                n += 1;
+            }
+            reads.fetch_add(n, std::memory_order_relaxed);
+        });
+    }
+
+    value_t value{};
+    for (uint64_t i = 1; i <= writes; ++i) {
+        value.words.fill(i);
+        shared = value;
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    bool ok = torn.load() == 0 && shared.value().words[0] == writes;
+    std::printf(
+        "%zu writes, %zu reads, %zu torn\n", writes, reads.load(), torn.load()
+    );
+
+    // Every value written below is new, so each write notifies once.
+    size_t notified = 0;
+    shared.on_changed([&notified]() {
+        notified += 1;
+    });
+    threads.clear();
+    for (uint64_t w = 0; w < 2; ++w) {
+        threads.emplace_back([&shared, w]() {
+            value_t value{};
+            for (uint64_t i = 0; i < changes; ++i) {
+                value.words.fill(writes + 1 + 2 * i + w);
+                shared = value;
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ok = ok && notified == 2 * changes;
+    std::printf("%zu changes, %zu notified\n", 2 * changes, notified);
+    return ok ? 0 : 1;
+}
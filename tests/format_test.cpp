@@ -0,0 +1,104 @@
+// format_test compares text_writer::put_float() with snprintf("%.*f") over
+// a table of values that round near a tie, exact ties, and a sweep of
+// pseudo-random values at every precision put_float() supports. Exits
+// non-zero on a failed check.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "../format.hpp"
+
+namespace {
+
+int failures = 0;
+
+// compare formats value both ways and reports a difference.
+void compare(double value, unsigned decimals) {
+    char                        ours[64];
+    char                        theirs[64];
+    cgx::parameter::text_writer out(ours, sizeof(ours));
+    out.put_float(value, decimals);
+    out.terminate();
+    std::snprintf(
+        theirs, sizeof(theirs), "%.*f", static_cast<int>(decimals), value
+    );
+    if (std::strcmp(ours, theirs) != 0) {
+        std::printf(
+            "FAILED: %.17g with %u decimals: \"%s\", snprintf \"%s\"\n",
+            value,
+            decimals,
+            ours,
+            theirs
+        );
+        failures += 1;
+    }
+}
+
+const double table[] = {
+    0.0,
+    -0.0,
+    0.0000005,
+    0.0000015,
+    0.0000025,
+    -0.0000005,
+    -1e-9,
+    0.5,
+    1.5,
+    2.5,
+    0.125,
+    0.375,
+    0.1,
+    0.2,
+    0.3,
+    1.0 / 3.0,
+    2.0 / 3.0,
+    0.9999995,
+    0.99999949999999999,
+    9.9999995,
+    123456.7890125,
+    1e-300,
+    5e-324,
+    3.14159265358979,
+    static_cast<double>(3.14159f),
+    static_cast<double>(0.1f),
+    1e15 + 0.5,
+    4503599627370495.5,
+    9007199254740993.0,
+    1e18,
+    9999999999999997952.0,
+    std::numeric_limits<double>::infinity(),
+    -std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::quiet_NaN(),
+};
+
+}  // namespace
+
+int main() {
+    for (const double value : table) {
+        for (unsigned decimals = 0; decimals <= 9; ++decimals) {
+            compare(value, decimals);
+        }
+    }
+
+    // Pseudo-random values over several magnitudes, and values on a
+    // 10^-k grid that land on or next to a tie.
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < 20000; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const double unit = static_cast<double>(state >> 11) * 0x1p-53;
+        const double value =
+            unit * std::pow(10.0, static_cast<int>(state % 24) - 12);
+        const auto   decimals = static_cast<unsigned>(state % 10);
+        const double grid     = std::pow(10.0, -static_cast<int>(decimals));
+        compare(value, decimals);
+        compare(std::round(value / grid) * grid + grid / 2, decimals);
+    }
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// journal_test tears and corrupts the last record of a journal between
+// opens: replay must cut it off and keep the records before it. It then
+// keeps rewriting a few UIDs until the journal crosses
+// CGX_PARAMETER_JOURNAL_COMPACT_MIN and _RATIO, and checks that compaction
+// keeps the latest value of each UID, also after reopening. Exits non-zero
+// on a failed check.
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+
+#include "../journal_storage.hpp"
+
+namespace {
+
+using cgx::parameter::journal_file;
+using cgx::parameter::journal_storage;
+
+const char* const path = "journal_test_lun0.log";
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+bool write_int(journal_file& file, uint32_t uid, int value) {
+    return file.write(
+        uid, reinterpret_cast<const uint8_t*>(&value), sizeof(value)
+    );
+}
+
+int read_int(journal_file& file, uint32_t uid) {
+    int value = -1;
+    file.read(uid, reinterpret_cast<uint8_t*>(&value), sizeof(value));
+    return value;
+}
+
+void flip_byte(off_t offset) {
+    std::FILE* f = std::fopen(path, "r+b");
+    if (f != nullptr) {
+        std::fseek(f, offset, SEEK_SET);
+        const int c = std::fgetc(f);
+        std::fseek(f, offset, SEEK_SET);
+        std::fputc(c ^ 0xFF, f);
+        std::fclose(f);
+    }
+}
+
+void torn_tail() {
+    ::unlink(path);
+    size_t good = 0;
+    size_t end  = 0;
+    {
+        journal_file file;
+        check(file.open(path), "create");
+        check(write_int(file, 1, 10) && write_int(file, 2, 20), "write");
+        good = file.size();
+        check(write_int(file, 1, 11), "rewrite");
+        end = file.size();
+    }
+
+    // A record cut short by a crash is dropped, and the older record of its
+    // UID is found again.
+    check(::truncate(path, static_cast<off_t>(end - 2)) == 0, "truncate");
+    {
+        journal_file file;
+        check(file.open(path), "open torn");
+        check(file.size() == good, "torn record cut off");
+        check(read_int(file, 1) == 10 && read_int(file, 2) == 20, "kept");
+        check(write_int(file, 1, 12), "append after torn");
+    }
+
+    // A record whose payload no longer matches its CRC is dropped too.
+    flip_byte(static_cast<off_t>(end - 2));
+    {
+        journal_file file;
+        check(file.open(path), "open corrupt");
+        check(file.size() == good, "corrupt record cut off");
+        check(read_int(file, 1) == 10 && read_int(file, 2) == 20, "intact");
+    }
+    ::unlink(path);
+}
+
+void compaction() {
+    ::unlink(path);
+    constexpr uint32_t uids = 3;
+
+    int  rounds = 0;
+    bool ok     = true;
+    {
+        journal_storage storage("journal_test_lun%zu.log");
+        while (ok && storage.file(0)->stats().compactions == 0) {
+            // Each commit checks the thresholds.
+            ok = storage.enter(0);
+            for (uint32_t uid = 1; ok && uid <= uids; ++uid) {
+                const int value = rounds * 10 + static_cast<int>(uid);
+                ok              = storage.write(
+                    0, uid, reinterpret_cast<const uint8_t*>(&value), 4
+                );
+            }
+            ok = storage.leave() && ok;
+            rounds += 1;
+        }
+        check(ok, "writes");
+
+        const journal_file* file   = storage.file(0);
+        const size_t        header = sizeof(journal_file::file_header_t);
+        check(file->size() < CGX_PARAMETER_JOURNAL_COMPACT_MIN, "compacted");
+        check(file->size() == header + file->live_size(), "only live left");
+    }
+
+    journal_file file;
+    check(file.open(path), "reopen compacted");
+    const int last = (rounds - 1) * 10;
+    for (uint32_t uid = 1; uid <= uids; ++uid) {
+        check(read_int(file, uid) == last + static_cast<int>(uid), "latest");
+    }
+    ::unlink(path);
+}
+
+}  // namespace
+
+int main() {
+    torn_tail();
+    compaction();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+// mapped_test checks that a mapped_parameter keeps the value last stored
+// when the process goes away without store(): every write made since then
+// still reaches the file when it is unmapped. A stored record torn while
+// store() copied it is loaded from the sealed working copy instead. An
+// update() that cannot create the record leaves the default alone. Exits
+// non-zero on a failed check.
+
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include "../mapped_parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+using cgx::parameter::packed_file_storage;
+
+const char* const pattern = "mapped_test_lun%zu.bin";
+const char* const path    = "mapped_test_lun0.bin";
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+struct table_t {
+    std::array<int, 64> cells;
+
+    int to_char(char* dst, size_t size) const {
+        return std::snprintf(dst, size, "%d", cells[0]);
+    }
+};
+
+table_t filled(int value) {
+    table_t t{};
+    t.cells.fill(value);
+    return t;
+}
+
+using mapped_table = cgx::mapped_parameter<table_t>;
+
+// reboot opens the file again and returns the first cell retrieved, or -1.
+int reboot() {
+    packed_file_storage              storage(pattern);
+    cgx::unique_parameter_list<0, 1> params(discard);
+    auto& table = params.emplace<mapped_table>("table", filled(0), storage);
+    return table.retrieve() ? table.value().cells[0] : -1;
+}
+
+}  // namespace
+
+int main() {
+    ::unlink(path);
+    {
+        packed_file_storage              storage(pattern);
+        cgx::unique_parameter_list<0, 1> params(discard);
+        auto& table = params.emplace<mapped_table>("table", filled(0), storage);
+        table       = filled(1);
+        check(table.store(), "store");
+
+        // Unstored writes reach the mapping, and with it the file.
+        table = filled(2);
+
+        const bool updated = table.update([](table_t& t) {
+            t.cells[5] = 9;
+        });
+        const uint8_t byte = 0x55;
+        check(updated && table.set_bytes_at(0, &byte, 1), "unstored writes");
+    }
+    check(reboot() == 1, "unstored writes keep the stored value");
+
+    {
+        packed_file_storage              storage(pattern);
+        cgx::unique_parameter_list<0, 1> params(discard);
+        auto& table = params.emplace<mapped_table>("table", filled(0), storage);
+        check(table.retrieve() && table.value().cells[0] == 1, "retrieve");
+        table = filled(3);
+        check(table.store(), "store again");
+
+        // Tear the stored record as a crash in the middle of store() would.
+        auto*    file   = storage.file(0);
+        uint8_t* stored = file->reserve(table.uid(), sizeof(table_t));
+        stored[0] ^= 0xFF;
+        check(file->flush(), "flush torn record");
+    }
+    check(reboot() == 3, "torn stored record recovered");
+    check(reboot() == 3, "recovered record repaired");
+    ::unlink(path);
+
+    // Without a file nothing can be bound: update() must not touch the
+    // default that reset() restores.
+    {
+        packed_file_storage              storage("/nonexistent/lun%zu.bin");
+        cgx::unique_parameter_list<0, 1> params(discard);
+        auto& table = params.emplace<mapped_table>("table", filled(4), storage);
+
+        bool       called  = false;
+        const bool updated = table.update([&called](table_t& t) {
+            called     = true;
+            t.cells[0] = 5;
+        });
+        check(!updated, "update without a record fails");
+        table.reset();
+        check(!called && table.value().cells[0] == 4, "default untouched");
+    }
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
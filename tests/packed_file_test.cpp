@@ -0,0 +1,206 @@
+// packed_file_test corrupts and truncates a packed file between opens. A
+// directory entry pointing outside the data area must not be followed: the
+// file is rewritten with the records that check out. It also checks which
+// resized records keep their place, and that unique_parameter store() and
+// retrieve() round trip through packed_file_storage. Exits non-zero on a
+// failed check.
+
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../packed_file_storage.hpp"
+#include "../parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+using cgx::parameter::packed_file;
+
+const char* const path = "packed_file_test.bin";
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+packed_file::header_t read_header() {
+    packed_file::header_t h{};
+    std::FILE*            f = std::fopen(path, "rb");
+    if (f != nullptr) {
+        check(std::fread(&h, sizeof(h), 1, f) == 1, "read header");
+        std::fclose(f);
+    }
+    return h;
+}
+
+packed_file::entry_t read_entry(size_t index) {
+    packed_file::entry_t e{};
+    std::FILE*           f = std::fopen(path, "rb");
+    if (f != nullptr) {
+        std::fseek(
+            f, sizeof(packed_file::header_t) + index * sizeof(e), SEEK_SET
+        );
+        check(std::fread(&e, sizeof(e), 1, f) == 1, "read entry");
+        std::fclose(f);
+    }
+    return e;
+}
+
+void write_entry(size_t index, const packed_file::entry_t& e) {
+    std::FILE* f = std::fopen(path, "r+b");
+    if (f != nullptr) {
+        std::fseek(
+            f, sizeof(packed_file::header_t) + index * sizeof(e), SEEK_SET
+        );
+        check(std::fwrite(&e, sizeof(e), 1, f) == 1, "write entry");
+        std::fclose(f);
+    }
+}
+
+void discard(const char*) {
+}
+
+// big_t is above CGX_PARAMETER_STACK_LIMIT, so it is stored and retrieved in
+// place.
+struct big_t {
+    std::array<int, 128> words;
+
+    int to_char(char* dst, size_t size) const {
+        return std::snprintf(dst, size, "%d", words[0]);
+    }
+
+    bool operator==(const big_t& other) const {
+        return words == other.words;
+    }
+};
+
+// round_trip stores a list through packed_file_storage, then retrieves it
+// into a second list with other values after reopening the file.
+void round_trip() {
+    const char* const pattern = "packed_file_test_lun%zu.bin";
+    ::unlink("packed_file_test_lun0.bin");
+
+    big_t big{};
+    big.words.fill(7);
+    {
+        cgx::parameter::packed_file_storage storage(pattern);
+        cgx::parameter::set_storage(&storage);
+
+        cgx::unique_parameter_list<0, 8> params(discard);
+        auto& i = params.add("i", 1);
+        auto& f = params.add("f", 2.5f);
+        auto& t = params.add("t", "first");
+        auto& a = params.add("a", std::array<int, 4>{1, 2, 3, 4});
+        auto& b = params.add("b", big);
+        check(params.store_all(), "store_all");
+
+        i = 42;
+        t = "other";
+        check(i.store() && t.store() && f.store(), "store");
+        a[2] = 9;
+        check(a.store() && b.store(), "store array and big");
+        cgx::parameter::set_storage(nullptr);
+    }
+    {
+        cgx::parameter::packed_file_storage storage(pattern);
+        cgx::parameter::set_storage(&storage);
+
+        cgx::unique_parameter_list<0, 8> params(discard);
+        auto& i = params.add("i", 0);
+        auto& f = params.add("f", 0.0f);
+        auto& t = params.add("t", "-----");
+        auto& a = params.add("a", std::array<int, 4>{});
+        auto& b = params.add("b", big_t{});
+        check(i.retrieve() && i == 42, "retrieve int");
+        check(f.retrieve() && f == 2.5f, "retrieve float");
+        check(t.retrieve() && std::strcmp(t.value(), "other") == 0, "text");
+        check(a.retrieve() && a[2] == 9 && a[3] == 4, "retrieve array");
+        check(b.retrieve() && b.value() == big, "retrieve in place");
+
+        // A record of another size is refused and leaves the value alone.
+        cgx::unique_parameter_list<0, 1> other(discard);
+        auto& wide = other.add("i", std::array<int, 2>{5, 5});
+        check(!wide.retrieve() && wide[1] == 5, "size mismatch refused");
+        cgx::parameter::set_storage(nullptr);
+    }
+    ::unlink("packed_file_test_lun0.bin");
+}
+
+}  // namespace
+
+int main() {
+    const uint8_t a[16] = {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+    const uint8_t b[16] = {2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2};
+    const uint8_t c[24] = {3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+                           3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3};
+    uint8_t       out[24];
+
+    // Resized records: the last one grows in place, others shrink in place
+    // and only move when they grow.
+    ::unlink(path);
+    {
+        packed_file file;
+        check(file.open(path, 8, 256), "create");
+        check(file.write(10, a, 16) && file.write(20, b, 16), "write");
+        check(file.write(20, c, 24), "grow last");
+        check(file.write(10, a, 8), "shrink");
+        check(file.flush(), "flush");
+    }
+    check(read_header().data_used == 16 + 24, "resized in place");
+    {
+        packed_file file;
+        check(file.open(path, 8, 256), "reopen");
+        check(file.write(10, c, 24), "grow");
+        check(file.flush(), "flush");
+    }
+    check(read_header().data_used == 16 + 24 + 24, "grown record moved");
+
+    // An entry pointing past the data in use is dropped on open; the other
+    // record survives.
+    packed_file::entry_t e   = read_entry(0);
+    const auto           bad = e.uid;
+    e.offset                 = 0xFFFFFF00;
+    write_entry(0, e);
+    {
+        packed_file file;
+        check(file.open(path, 8, 256), "open with a corrupt entry");
+        check(!file.read(bad, out, 24), "corrupt record not read");
+        check(file.count() == 1, "other records kept");
+        check(
+            file.read(20, out, 24) && std::memcmp(out, c, 24) == 0,
+            "other record intact"
+        );
+    }
+
+    // A truncated file is refused instead of mapped short.
+    check(
+        ::truncate(path, sizeof(packed_file::header_t) + 8) == 0, "truncate"
+    );
+    {
+        packed_file file;
+        check(!file.open(path, 8, 256), "truncated file refused");
+    }
+
+    ::unlink(path);
+
+    round_trip();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
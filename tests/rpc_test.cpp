@@ -0,0 +1,377 @@
+// rpc_test serves request frames through rpc_handler: GET, CRC and LIST
+// batches, a SET batch that one bad-size entry keeps from being applied,
+// frames that are short, too large or of an unknown op, and a key_version
+// mismatch. It then runs rpc_server on a Unix-domain socket and round-trips
+// values through rpc_client, pipelined frames included. Exits non-zero on
+// a failed check.
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#include "../rpc.hpp"
+#include "../rpc_socket.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+using namespace cgx::parameter;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+// table_t is above CGX_PARAMETER_RPC_COPY_SIZE, so GET references it.
+using table_t = std::array<int, 32>;
+using list_t  = cgx::unique_parameter_list<0, 4>;
+
+constexpr uid_value_t unknown = 0x5EED;
+
+struct fixture {
+    list_t                          params{discard};
+    cgx::unique_parameter<int>&     gain   = params.add("gain", 3);
+    cgx::unique_parameter<float>&   offset = params.add("offset", 0.5f);
+    cgx::unique_parameter<table_t>& table  = params.add("table", table_t{});
+};
+
+// harness runs handle() on one frame and copies the response out of the
+// iovecs, as the server would send it.
+template <size_t Iovs = 16, size_t Scratch = 1024>
+struct harness {
+    rpc_handler<list_t>          handler;
+    std::array<iovec, Iovs>      iov{};
+    std::array<uint8_t, Scratch> scratch{};
+    std::array<uint8_t, 2048>    response{};
+    rpc_output out{iov.data(), iov.size(), scratch.data(), scratch.size()};
+
+    explicit harness(list_t& params) : handler(params) {
+    }
+
+    // serve returns the size of the response, 0 if there was none.
+    size_t serve(const uint8_t* frame) {
+        out.clear();
+        if (handler.handle(frame, out) != rpc_handler<list_t>::rpc_handled) {
+            return 0;
+        }
+        size_t size = 0;
+        for (size_t i = 0; i < out.count(); ++i) {
+            const iovec& part = iov[i];
+            std::memcpy(response.data() + size, part.iov_base, part.iov_len);
+            size += part.iov_len;
+        }
+        return size;
+    }
+
+    // open serves frame and opens its response.
+    bool open(const uint8_t* frame, rpc_response& reply) {
+        const size_t size = this->serve(frame);
+        return size != 0 && reply.open(response.data(), size);
+    }
+};
+
+// failed tells whether frame is answered with an rpc_error of status.
+template <typename Harness>
+bool failed(Harness& h, const uint8_t* frame, rpc_status_t status) {
+    rpc_response reply;
+    return h.open(frame, reply) && reply.header().op == rpc_error &&
+           reply.status() == status;
+}
+
+void get_and_crc() {
+    fixture f;
+    f.table.update([](table_t& t) {
+        t[31] = 7;
+    });
+    harness<> h(f.params);
+
+    uint8_t     frame[256];
+    rpc_request request(frame, sizeof(frame));
+    request.begin(rpc_get, 11);
+    request.add(f.gain.uid());
+    request.add(unknown);
+    request.add(f.table.uid());
+    check(request.finish() != 0, "GET built");
+
+    rpc_response reply;
+    check(h.open(frame, reply), "GET served");
+    check(reply.header().id == 11 && reply.header().count == 3, "GET echo");
+
+    rpc_response::entry_t entry;
+    int                   gain = 0;
+    check(reply.next(entry) && entry.status == rpc_ok, "GET gain");
+    check(entry.size == sizeof(int), "GET gain size");
+    std::memcpy(&gain, entry.data, sizeof(gain));
+    check(gain == 3, "GET gain value");
+    check(reply.next(entry) && entry.status == rpc_not_found, "GET unknown");
+    check(entry.size == 0, "GET unknown has no value");
+    check(reply.next(entry) && entry.size == sizeof(table_t), "GET table");
+    check(std::memcmp(entry.data, f.table.bytes(), entry.size) == 0, "table");
+    check(!reply.next(entry), "GET ends");
+
+    request.begin(rpc_crc, 12);
+    request.add(f.offset.uid());
+    request.add(unknown);
+    check(request.finish() != 0, "CRC built");
+    check(h.open(frame, reply), "CRC served");
+    check(reply.list_crc() == f.params.get_crc(), "list CRC");
+
+    uint32_t crc = 0;
+    check(reply.next(entry) && entry.status == rpc_ok, "CRC offset");
+    std::memcpy(&crc, entry.data, sizeof(crc));
+    check(crc == f.offset.get_crc(), "CRC value");
+    check(reply.next(entry) && entry.status == rpc_not_found, "CRC unknown");
+    check(!reply.next(entry), "CRC ends");
+}
+
+void list() {
+    fixture   f;
+    harness<> h(f.params);
+
+    uint8_t     frame[64];
+    rpc_request request(frame, sizeof(frame));
+    request.begin(rpc_list, 1);
+    request.list(0, 2);
+    check(request.finish() != 0, "LIST built");
+
+    rpc_response reply;
+    check(h.open(frame, reply) && reply.header().count == 2, "LIST 2");
+    check(reply.next_slot() == 2, "LIST continues");
+
+    rpc_response::info_t info;
+    check(reply.next(info) && info.name == "gain", "LIST gain");
+    check(info.uid == f.gain.uid() && info.size == sizeof(int), "gain info");
+    check(info.type == f.gain.type_id(), "gain type");
+    check(reply.next(info) && info.name == "offset", "LIST offset");
+    check(!reply.next(info), "LIST of 2 ends");
+
+    request.begin(rpc_list, 2);
+    request.list(reply.next_slot(), 10);
+    check(request.finish() != 0, "LIST rest built");
+    check(h.open(frame, reply) && reply.header().count == 1, "LIST rest");
+    check(reply.next_slot() == f.params.size(), "LIST done");
+    check(reply.next(info) && info.name == "table", "LIST table");
+    check(info.size == sizeof(table_t), "table info");
+}
+
+void set() {
+    fixture   f;
+    harness<> h(f.params);
+
+    uint8_t     frame[256];
+    rpc_request request(frame, sizeof(frame));
+
+    // The offset entry has the size of a double: nothing is applied.
+    const int    gain   = 9;
+    const double offset = 1.5;
+    request.begin(rpc_set, 21);
+    request.add(f.gain.uid(), &gain, sizeof(gain));
+    request.add(f.offset.uid(), &offset, sizeof(offset));
+    request.add(unknown, &gain, sizeof(gain));
+    check(request.finish() != 0, "SET built");
+
+    rpc_response          reply;
+    rpc_response::entry_t entry;
+    check(h.open(frame, reply) && reply.header().count == 3, "SET served");
+    check(reply.next(entry) && entry.status == rpc_not_applied, "dropped");
+    check(reply.next(entry) && entry.status == rpc_bad_size, "bad size");
+    check(reply.next(entry) && entry.status == rpc_not_found, "not found");
+    check(f.gain == 3 && f.offset == 0.5f, "nothing applied");
+
+    const float good = 1.5f;
+    request.begin(rpc_set, 22);
+    request.add(f.gain.uid(), &gain, sizeof(gain));
+    request.add(f.offset.uid(), &good, sizeof(good));
+    check(request.finish() != 0, "SET again built");
+    check(h.open(frame, reply), "SET again served");
+    check(reply.next(entry) && entry.status == rpc_ok, "gain set");
+    check(reply.next(entry) && entry.status == rpc_ok, "offset set");
+    check(f.gain == 9 && f.offset == 1.5f, "applied");
+}
+
+// frame_of writes a header and body by hand, for frames rpc_request would
+// not build.
+size_t frame_of(
+    uint8_t*            frame,
+    const rpc_header_t& header,
+    const void*         body,
+    size_t              size
+) {
+    std::memcpy(frame, &header, sizeof(header));
+    std::memcpy(frame + sizeof(header), body, size);
+    return sizeof(header) + size;
+}
+
+void malformed() {
+    fixture   f;
+    harness<> h(f.params);
+
+    const auto  version = static_cast<uint16_t>(key_version);
+    uint8_t     frame[256];
+    rpc_request request(frame, sizeof(frame));
+
+    // A frame is only complete once its whole body arrived.
+    request.begin(rpc_get, 1);
+    request.add(f.gain.uid());
+    const size_t size         = request.finish();
+    bool         short_frames = true;
+    for (size_t n = 0; n < size; ++n) {
+        short_frames = rpc_frame_size(frame, n) == 0 && short_frames;
+    }
+    check(short_frames && rpc_frame_size(frame, size + 4) == size, "framing");
+
+    // Bodies shorter or longer than count says.
+    const uid_value_t uids[2] = {f.gain.uid(), f.offset.uid()};
+    frame_of(frame, {sizeof(uid_value_t), 2, version, rpc_get, 2}, uids, 4);
+    check(failed(h, frame, rpc_bad_request), "short GET");
+    frame_of(frame, {sizeof(uids), 3, version, rpc_crc, 1}, uids, 8);
+    check(failed(h, frame, rpc_bad_request), "long CRC");
+    frame_of(frame, {0, 4, version, rpc_list, 1}, uids, 0);
+    check(failed(h, frame, rpc_bad_request), "LIST without a slot");
+
+    // A SET entry whose payload runs past the body changes nothing.
+    const int         gain = 9;
+    const rpc_entry_t cut{f.gain.uid(), rpc_ok, sizeof(gain) + 1};
+    uint8_t           body[sizeof(cut) + sizeof(gain)];
+    std::memcpy(body, &cut, sizeof(cut));
+    std::memcpy(body + sizeof(cut), &gain, sizeof(gain));
+    frame_of(frame, {sizeof(body), 5, version, rpc_set, 1}, body, sizeof(body));
+    check(failed(h, frame, rpc_bad_request) && f.gain == 3, "short SET");
+
+    frame_of(frame, {0, 6, version, 9, 0}, uids, 0);
+    check(failed(h, frame, rpc_bad_request), "unknown op");
+
+    // Another UID width or hash cannot address the same parameters.
+    request.begin(rpc_get, 7);
+    request.add(f.gain.uid());
+    request.finish();
+    rpc_header_t header;
+    std::memcpy(&header, frame, sizeof(header));
+    header.key_version = static_cast<uint16_t>(key_version ^ 0x0100);
+    std::memcpy(frame, &header, sizeof(header));
+    check(failed(h, frame, rpc_bad_version), "key_version mismatch");
+
+    // A response that cannot fit the output even when it is empty.
+    harness<2> narrow(f.params);
+    request.begin(rpc_get, 8);
+    request.add(f.table.uid());
+    request.finish();
+    check(failed(narrow, frame, rpc_too_large), "response too large");
+
+    // A SET waits for what is queued before it.
+    harness<> pipelined(f.params);
+    check(pipelined.serve(frame) != 0, "GET queued");
+    request.begin(rpc_set, 9);
+    request.add(f.gain.uid(), &gain, sizeof(gain));
+    request.finish();
+    check(
+        pipelined.handler.handle(frame, pipelined.out) ==
+            rpc_handler<list_t>::rpc_full,
+        "SET after a referenced value waits"
+    );
+}
+
+// socket round-trips values through rpc_client and an rpc_server polled
+// on its own thread.
+void socket() {
+    const char* const path = "rpc_test.sock";
+
+    fixture            f;
+    rpc_server<list_t> server(f.params);
+    std::atomic<bool>  done{false};
+    check(server.listen_unix(path), "listen");
+    std::thread serve([&server, &done]() {
+        while (!done.load()) {
+            server.poll(1);
+        }
+    });
+
+    rpc_client client;
+    check(client.connect_unix(path), "connect");
+
+    int gain = 0;
+    check(client.get(f.gain.uid(), gain) && gain == 3, "client get");
+    check(client.set(f.gain.uid(), 42), "client set");
+    check(client.get(f.gain.uid(), gain) && gain == 42, "client get again");
+    check(!client.get(unknown, gain), "client get unknown");
+    check(client.status() == rpc_not_found, "client not found");
+    check(!client.set(f.gain.uid(), 1.0), "client set double");
+    check(client.status() == rpc_bad_size, "client bad size");
+
+    // Pipelined frames are answered in order.
+    uint8_t     frames[128];
+    uint8_t     frame[64];
+    size_t      used = 0;
+    rpc_request request(frame, sizeof(frame));
+    for (uint32_t id = 100; id < 103; ++id) {
+        request.begin(rpc_crc, id);
+        request.add(f.offset.uid());
+        const size_t size = request.finish();
+        std::memcpy(frames + used, frame, size);
+        used += size;
+    }
+    check(client.send(frames, used), "pipelined send");
+    bool in_order = true;
+    for (uint32_t id = 100; id < 103; ++id) {
+        uint8_t      buffer[64];
+        rpc_response reply;
+        const size_t size = client.receive(buffer, sizeof(buffer));
+        in_order          = size != 0 && reply.open(buffer, size) &&
+                   reply.header().id == id && in_order;
+    }
+    check(in_order, "pipelined responses in order");
+
+    // A frame larger than the server's buffer ends the connection.
+    rpc_client         greedy;
+    const rpc_header_t huge{
+        CGX_PARAMETER_RPC_BUFFER_SIZE, 1, static_cast<uint16_t>(key_version),
+        rpc_get, CGX_PARAMETER_RPC_BUFFER_SIZE / sizeof(uid_value_t)
+    };
+    uint8_t reply[64];
+    check(greedy.connect_unix(path), "connect greedy");
+    check(
+        greedy.send(reinterpret_cast<const uint8_t*>(&huge), sizeof(huge)),
+        "send oversized header"
+    );
+    check(greedy.receive(reply, sizeof(reply)) == 0, "oversized frame dropped");
+    check(client.get(f.gain.uid(), gain), "other client kept");
+
+    client.close();
+    done.store(true);
+    serve.join();
+    check(f.gain == 42, "set applied on the server");
+}
+
+}  // namespace
+
+int main() {
+    get_and_crc();
+    list();
+    set();
+    malformed();
+    socket();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+// schema_test checks the compile-time side of schemas with static_assert:
+// the sorted UID table, lookup() and collision detection. At run time it
+// checks find() and that init() and reset() reach every parameter. Built
+// with one of SCHEMA_FAIL_COLLISION, SCHEMA_FAIL_CAPACITY or
+// SCHEMA_FAIL_MAX_BYTES it must not compile; CMake checks the diagnostic.
+// Exits non-zero on a failed check.
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../schema.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+constexpr auto schema = cgx::make_schema(
+    cgx::field{"gain", 1.5f},
+    cgx::field{"name", "device"},
+    cgx::field{"limits", std::array<int, 2>{-10, 10}},
+    cgx::field{"enabled", true}
+);
+
+using list_t = cgx::static_parameter_list<0, schema>;
+
+constexpr cgx::parameter::uid_value_t uid_of(std::string_view name) {
+    return cgx::parameter::uid_t(name).get_uid();
+}
+
+constexpr bool sorted() {
+    for (size_t i = 1; i < list_t::table.size(); ++i) {
+        if (!(list_t::table[i - 1].uid < list_t::table[i].uid)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(decltype(schema)::size == 4);
+static_assert(
+    decltype(schema)::storage_size() ==
+    sizeof(float) + 7 + sizeof(std::array<int, 2>) + sizeof(bool)
+);
+static_assert(!schema.has_collision());
+static_assert(sorted(), "table is sorted by UID");
+static_assert(list_t::index_of("limits") == 2);
+static_assert(list_t::index_of("missing") == schema.size);
+static_assert(list_t::lookup(uid_of("gain")) == 0);
+static_assert(list_t::lookup(uid_of("name")) == 1);
+static_assert(list_t::lookup(uid_of("limits")) == 2);
+static_assert(list_t::lookup(uid_of("enabled")) == 3);
+static_assert(list_t::lookup(uid_of("missing")) == list_t::npos);
+static_assert(list_t::uid_exists(uid_of("enabled")));
+static_assert(!list_t::uid_exists(uid_of("missing")));
+
+// The offsets pack the values in declaration order.
+constexpr size_t offset_of(size_t index) {
+    for (const auto& entry : list_t::table) {
+        if (entry.index == index) {
+            return entry.offset;
+        }
+    }
+    return list_t::npos;
+}
+static_assert(offset_of(0) == 0 && offset_of(1) == sizeof(float));
+static_assert(offset_of(3) == sizeof(float) + 7 + sizeof(std::array<int, 2>));
+
+// Duplicate names are detected before any list is instantiated.
+static_assert(cgx::make_schema(cgx::field{"a", 1}, cgx::field{"a", 2})
+                  .has_collision());
+
+// Capacity and MaxBytes that the schema meets exactly are accepted.
+using exact_t = cgx::static_parameter_list<
+    0,
+    schema,
+    4,
+    decltype(schema)::storage_size()>;
+
+#if defined(SCHEMA_FAIL_COLLISION)
+constexpr auto colliding =
+    cgx::make_schema(cgx::field{"a", 1}, cgx::field{"a", 2});
+cgx::static_parameter_list<0, colliding> failing(discard);
+#elif defined(SCHEMA_FAIL_CAPACITY)
+cgx::static_parameter_list<0, schema, 3> failing(discard);
+#elif defined(SCHEMA_FAIL_MAX_BYTES)
+cgx::static_parameter_list<0, schema, 4, 8> failing(discard);
+#endif
+
+}  // namespace
+
+int main() {
+    list_t  params(discard);
+    exact_t exact(discard);
+
+    check(params.find(uid_of("gain")) == &params.get<0>(), "find gain");
+    check(params.find(uid_of("enabled")) == &params.get<3>(), "find bool");
+    check(params.find(uid_of("missing")) == nullptr, "find missing");
+    check(exact.find(uid_of("name")) == &exact.get<1>(), "find in exact");
+    check(params.get<1>().name() == "name", "names kept");
+
+    params.get<0>() = 2.0f;
+    params.get<2>() = std::array<int, 2>{0, 1};
+    check(params.init(), "init");
+    params.reset();
+    check(params.get<0>() == 1.5f, "reset float");
+    check(params.get<2>()[1] == 10, "reset array");
+    check(std::strcmp(params.get<1>().value(), "device") == 0, "text");
+
+    size_t visited = 0;
+    params.for_each([&visited](const auto&) {
+        visited += 1;
+    });
+    check(visited == 4, "for_each");
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
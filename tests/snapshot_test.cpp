@@ -0,0 +1,179 @@
+// snapshot_test checks that restore() applies an intact snapshot and
+// rejects a damaged or foreign one without changing any value: a bad CRC,
+// a blob cut short, a record of another type or size, and a UID the list
+// does not know. It also checks that a delta against a manifest or a
+// snapshot holds exactly the changed parameters and that restore() applies
+// it. Exits non-zero on a failed check.
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+using list_t = cgx::unique_parameter_list<0, 4>;
+
+// source holds the values the blobs are taken from.
+struct source {
+    list_t params{discard};
+    cgx::unique_parameter<int>&                i = params.add("i", 1);
+    cgx::unique_parameter<float>&              f = params.add("f", 2.0f);
+    cgx::unique_parameter<std::array<int, 3>>& a =
+        params.add("a", std::array<int, 3>{1, 2, 3});
+};
+
+// unchanged tells whether a restore target still holds its defaults.
+bool unchanged(const source& s) {
+    return s.i == 1 && s.f == 2.0f && s.a[2] == 3;
+}
+
+void restore() {
+    source from;
+    from.i = 10;
+    from.f = 20.0f;
+    from.a = std::array<int, 3>{4, 5, 6};
+
+    std::array<uint8_t, 256> blob{};
+    const size_t             n = from.params.snapshot(blob.data(), blob.size());
+    check(n != 0 && n == from.params.snapshot_size(), "snapshot size");
+    check(from.params.snapshot(blob.data(), n - 1) == 0, "too small");
+
+    {
+        source to;
+        check(to.params.restore(blob.data(), n), "restore");
+        check(to.i == 10 && to.f == 20.0f && to.a[1] == 5, "restored");
+    }
+
+    // A flipped payload byte fails the CRC.
+    {
+        auto bad = blob;
+        bad[n / 2] ^= 0xFF;
+        source to;
+        check(!to.params.restore(bad.data(), n), "bad CRC rejected");
+        check(unchanged(to), "bad CRC changes nothing");
+    }
+
+    // Every shorter prefix is rejected, as is a longer buffer.
+    {
+        source to;
+        bool   rejected = true;
+        for (size_t size = 0; size < n; ++size) {
+            rejected = !to.params.restore(blob.data(), size) && rejected;
+        }
+        check(rejected, "truncated blob rejected");
+        check(!to.params.restore(blob.data(), n + 1), "trailing bytes");
+        check(unchanged(to), "truncation changes nothing");
+    }
+
+    // "f" as an int has the size of the float but another type; "a" with
+    // four elements has another size. Either spoils the whole blob.
+    {
+        list_t to(discard);
+        auto&  i = to.add("i", 1);
+        auto&  f = to.add("f", 2);
+        auto&  a = to.add("a", std::array<int, 3>{1, 2, 3});
+        check(!to.restore(blob.data(), n), "type mismatch rejected");
+        check(i == 1 && f == 2 && a[0] == 1, "type mismatch changes nothing");
+    }
+    {
+        list_t to(discard);
+        auto&  i = to.add("i", 1);
+        auto&  f = to.add("f", 2.0f);
+        auto&  a = to.add("a", std::array<int, 4>{1, 2, 3, 4});
+        check(!to.restore(blob.data(), n), "size mismatch rejected");
+        check(i == 1 && f == 2.0f && a[0] == 1, "size mismatch unchanged");
+    }
+
+    // A list without "a" does not know one of the UIDs.
+    {
+        list_t to(discard);
+        auto&  i = to.add("i", 1);
+        auto&  f = to.add("f", 2.0f);
+        check(!to.restore(blob.data(), n), "unknown UID rejected");
+        check(i == 1 && f == 2.0f, "unknown UID changes nothing");
+    }
+}
+
+// holds tells whether blob is a snapshot of exactly the UIDs of params.
+template <typename... Ps>
+bool holds(const uint8_t* blob, size_t size, const Ps&... params) {
+    cgx::parameter::snapshot_reader           reader;
+    cgx::parameter::snapshot_reader::record_t record;
+    (void)record;  // unused for an empty delta
+    return reader.open(blob, size) && reader.count() == sizeof...(Ps) &&
+           (... && reader.find(params.uid(), record));
+}
+
+void delta() {
+    source local;
+    source peer;
+
+    std::array<uint8_t, 256> base{};
+    std::array<uint8_t, 256> out{};
+
+    // Against a manifest.
+    size_t base_size = peer.params.manifest(base.data(), base.size());
+    check(base_size == peer.params.manifest_size(), "manifest size");
+    size_t n = local.params.delta(base.data(), base_size, out.data(), 256);
+    check(n != 0 && holds(out.data(), n), "nothing changed, empty delta");
+
+    local.i = 7;
+    local.a = std::array<int, 3>{7, 8, 9};
+    n       = local.params.delta(base.data(), base_size, out.data(), 256);
+    check(holds(out.data(), n, local.i, local.a), "manifest delta");
+    check(peer.params.restore(out.data(), n), "apply manifest delta");
+    check(peer.i == 7 && peer.a[2] == 9 && peer.f == 2.0f, "applied");
+
+    // Against a snapshot, whose bytes are compared directly.
+    base_size = peer.params.snapshot(base.data(), base.size());
+    local.f   = 3.0f;
+    n         = local.params.delta(base.data(), base_size, out.data(), 256);
+    check(holds(out.data(), n, local.f), "snapshot delta");
+    check(peer.params.restore(out.data(), n) && peer.f == 3.0f, "apply");
+
+    // A parameter the base does not know is always included.
+    auto& extra = local.params.add("extra", 1);
+    n = local.params.delta(base.data(), base_size, out.data(), 256);
+    check(holds(out.data(), n, local.f, extra), "unknown to the base");
+
+    // An invalid base or a small buffer gives no delta.
+    base[0] ^= 0xFF;
+    n = local.params.delta(base.data(), base_size, out.data(), 256);
+    check(n == 0, "invalid base");
+    base[0] ^= 0xFF;
+    n = local.params.delta(base.data(), base_size, out.data(), 8);
+    check(n == 0, "small buffer");
+}
+
+}  // namespace
+
+int main() {
+    restore();
+    delta();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
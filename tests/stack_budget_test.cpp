@@ -0,0 +1,222 @@
+// stack_budget_test builds streamed parameters, a 4 KiB struct and a 1 KiB
+// string, against a CGX_PARAMETER_STACK_BUDGET far below their size: their
+// subscribers get old values from the subscriptions rather than from a
+// copy on the stack. It checks that the old and new values still arrive,
+// and that an in-place retrieve() that fails part way leaves the default,
+// with or without subscribers, while one that fails before writing leaves
+// the value unchanged. Exits non-zero on a failed check.
+
+#define CGX_PARAMETER_STACK_BUDGET 512
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../parameter.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+struct big_t {
+    int x[1024];
+
+    int to_char(char* dst, size_t size) const {
+        return std::snprintf(dst, size, "%d", x[0]);
+    }
+
+    bool operator==(const big_t& other) const {
+        return std::equal(x, x + 1024, other.x);
+    }
+};
+
+big_t filled(int value) {
+    big_t b;
+    std::fill(b.x, b.x + 1024, value);
+    return b;
+}
+
+using big_param  = cgx::unique_parameter<big_t>;
+using text_param = cgx::unique_parameter<char[1024]>;
+
+static_assert(big_param::streamed && text_param::streamed);
+static_assert(big_param::stack_usage() < sizeof(big_t));
+static_assert(text_param::stack_usage() < 1024);
+static_assert(big_param::stack_usage() <= CGX_PARAMETER_STACK_BUDGET);
+
+// The hooks load a record filled with g_fill, and with g_cut set fail after
+// writing that many bytes.
+enum class load_t { whole, cut, refused };
+
+load_t g_load = load_t::whole;
+int    g_fill = 0;
+size_t g_cut  = 0;
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t* dst, size_t len) {
+    if (g_load == load_t::refused) {
+        return false;
+    }
+    const big_t record = filled(g_fill);
+    std::memcpy(dst, &record, std::min(len, sizeof(record)));
+    if (g_load == load_t::cut) {
+        std::memset(dst + g_cut, 0x7F, len - g_cut);
+        return false;
+    }
+    return len == sizeof(big_t);
+}
+
+namespace {
+
+using cgx::parameter::subscription;
+
+// log_t keeps the last element of the old value and the first element of
+// the new value last delivered, and counts deliveries.
+struct log_t {
+    int count     = 0;
+    int old_value = -1;
+    int new_value = -1;
+
+    subscription<big_t>::callback_t callback() {
+        return [this](const auto&, const big_t& old_value, const big_t& value) {
+            this->count += 1;
+            this->old_value = old_value.x[1023];
+            this->new_value = value.x[0];
+        };
+    }
+
+    bool saw(int count, int old_value, int new_value) const {
+        return this->count == count && this->old_value == old_value &&
+               this->new_value == new_value;
+    }
+};
+
+void subscribers() {
+    cgx::unique_parameter_list<0, 2> params(discard);
+    auto&                            big = params.add("big", filled(0));
+
+    log_t               log;
+    log_t               frame;
+    subscription<big_t> sub(log.callback());
+    subscription<big_t> coalesced(frame.callback(), true);
+    big.subscribe(sub);
+    big.subscribe(coalesced);
+
+    big = filled(1);
+    check(log.saw(1, 0, 1), "set_value delivered");
+    big = filled(2);
+    check(log.saw(2, 1, 2), "second set_value delivered");
+
+    big.update([](big_t& b) {
+        b.x[0] = 3;
+    });
+    check(log.saw(3, 2, 3), "update delivered");
+    big.update([](big_t&) {});
+    check(log.count == 3, "unchanged update not delivered");
+
+    const int four = 4;
+    big.set_bytes_at(0, reinterpret_cast<const uint8_t*>(&four), sizeof(four));
+    check(log.saw(4, 2, 4), "set_bytes_at delivered");
+
+    // The coalescing subscription kept the value before its first change.
+    check(coalesced.flush() && frame.saw(1, 0, 4), "coalesced old value");
+
+    // A subscription added by on_changed joins after the change started
+    // and is told about the next one only.
+    log_t               late_log;
+    subscription<big_t> late(late_log.callback());
+    big.on_changed([&big, &late]() {
+        big.subscribe(late);
+    });
+    big = filled(5);
+    check(late_log.count == 0, "late subscription skips the change");
+    big.on_changed(nullptr);
+    big = filled(6);
+    check(late_log.saw(1, 5, 6), "late subscription delivered");
+}
+
+void text() {
+    static const char initial[1024] = "initial";
+
+    cgx::unique_parameter_list<0, 2> params(discard);
+    auto&                            s = params.add("s", initial);
+
+    int                      count = 0;
+    char                     old_text[8]{};
+    subscription<char[1024]> sub(
+        [&count, &old_text](const auto&, const auto& old_value, const auto&) {
+            count += 1;
+            std::memcpy(old_text, old_value, sizeof(old_text) - 1);
+        }
+    );
+    s.subscribe(sub);
+
+    s = "changed";
+    check(count == 1 && std::strcmp(old_text, "initial") == 0, "text old");
+
+    const char tail[] = "xyz";
+    check(s.set_bytes_at(1020, reinterpret_cast<const uint8_t*>(tail), 4), "tail");
+    check(count == 2 && std::strcmp(old_text, "changed") == 0, "text tail");
+    check(s.value()[1023] == '\0' && s.value()[1022] == 'z', "terminated");
+}
+
+// failed_loads retrieves into a parameter holding 5s while the hooks fail
+// in several ways.
+void failed_loads(bool subscribed) {
+    cgx::unique_parameter_list<0, 2> params(discard);
+    auto&                            big = params.add("big", filled(0));
+
+    log_t               log;
+    subscription<big_t> sub(log.callback());
+    if (subscribed) {
+        big.subscribe(sub);
+    }
+    big = filled(5);
+    log = log_t{};
+
+    g_fill = 9;
+    g_load = load_t::refused;
+    check(!big.retrieve() && big.value() == filled(5), "refused: unchanged");
+    check(log.count == 0, "refused: nothing delivered");
+
+    g_load = load_t::cut;
+    g_cut  = sizeof(big_t) / 2;
+    check(!big.retrieve() && big.value() == filled(0), "cut: default");
+    if (subscribed) {
+        check(log.saw(1, 5, 0), "cut: change to the default delivered");
+    }
+
+    g_load = load_t::whole;
+    check(big.retrieve() && big.value() == filled(9), "whole: loaded");
+    if (subscribed) {
+        check(log.saw(2, 0, 9), "whole: delivered");
+    }
+}
+
+}  // namespace
+
+int main() {
+    subscribers();
+    text();
+    failed_loads(false);
+    failed_loads(true);
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// storage_test checks transactions that nest across LUNs: an on_changed
+// callback run by reset() of a LUN 0 list stores a LUN 1 parameter, once
+// against a backend that counts begin()/commit() per LUN and once against
+// journal_storage, whose begin() holds a lock until commit(). Exits
+// non-zero on a failed check.
+
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../journal_storage.hpp"
+#include "../parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+using cgx::parameter::uid_value_t;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+// counting_storage keeps one int record per LUN and counts the backend
+// transactions of each LUN.
+class counting_storage : public cgx::parameter::storage_i {
+   public:
+    bool begin(size_t lun) override {
+        begins[lun] += 1;
+        return true;
+    }
+
+    bool commit(size_t lun) override {
+        commits[lun] += 1;
+        return true;
+    }
+
+    bool read(size_t lun, uid_value_t, uint8_t* dst, size_t len) override {
+        if (len != sizeof(int) || !stored[lun]) {
+            return false;
+        }
+        std::memcpy(dst, &values[lun], len);
+        return true;
+    }
+
+    bool write(
+        size_t lun, uid_value_t, const uint8_t* src, size_t len
+    ) override {
+        if (len != sizeof(int) || !this->in_transaction(lun)) {
+            return false;
+        }
+        std::memcpy(&values[lun], src, len);
+        stored[lun] = true;
+        return true;
+    }
+
+    std::array<int, 2>  values{};
+    std::array<bool, 2> stored{};
+    std::array<int, 2>  begins{};
+    std::array<int, 2>  commits{};
+};
+
+void nesting(counting_storage& storage) {
+    // Going back to LUN 0 shares its transaction; each LUN commits once,
+    // when its outermost enter() is left.
+    check(storage.enter(0) && storage.enter(1), "enter two LUNs");
+    check(storage.in_transaction(0) && storage.in_transaction(1), "both open");
+    check(storage.enter(0), "enter LUN 0 again");
+    check(storage.leave() && storage.leave(), "leave inner");
+    check(storage.commits[1] == 1 && storage.commits[0] == 0, "LUN 1 left");
+    check(storage.leave(), "leave LUN 0");
+    check(!storage.in_transaction(), "all left");
+    check(storage.begins[0] == 1 && storage.begins[1] == 1, "one begin each");
+    check(storage.commits[0] == 1, "LUN 0 committed once");
+
+    // Nesting deeper than CGX_PARAMETER_STORAGE_NESTING fails, but stays
+    // balanced.
+    size_t entered = 0;
+    bool   ok      = true;
+    for (size_t i = 0; i <= CGX_PARAMETER_STORAGE_NESTING; ++i) {
+        ok = storage.enter(i % 2) && ok;
+        entered += 1;
+    }
+    check(!ok, "too deep");
+    while (entered-- > 0) {
+        storage.leave();
+    }
+    check(!storage.in_transaction(), "balanced after too deep");
+}
+
+}  // namespace
+
+int main() {
+    cgx::unique_parameter_list<0, 2> params0(discard);
+    cgx::unique_parameter_list<1, 2> params1(discard);
+
+    auto& a = params0.add("a", 1);
+    auto& b = params1.add("b", 0);
+
+    int  next   = 7;
+    bool stored = false;
+    a.on_changed([&b, &next, &stored]() {
+        b      = next;
+        stored = b.store();
+    });
+
+    counting_storage counting;
+    cgx::parameter::set_storage(&counting);
+    nesting(counting);
+
+    a = 5;
+    params0.reset();
+    check(stored, "LUN 1 stored from a LUN 0 reset()");
+    check(counting.stored[1] && counting.values[1] == 7, "LUN 1 record");
+    check(!counting.in_transaction(), "reset() left its transactions");
+
+    // journal_storage::begin() locks until commit(), so the nested LUN must
+    // not wait for the outer one.
+    const char* const pattern = "storage_test_lun%zu.log";
+    ::unlink("storage_test_lun0.log");
+    ::unlink("storage_test_lun1.log");
+    {
+        cgx::parameter::journal_storage journal(pattern);
+        cgx::parameter::set_storage(&journal);
+
+        next   = 8;
+        stored = false;
+        a      = 5;
+        params0.reset();
+        check(stored, "journal: LUN 1 stored from a LUN 0 reset()");
+
+        b = 0;
+        check(b.retrieve() && b == 8, "journal: LUN 1 record");
+        cgx::parameter::set_storage(nullptr);
+    }
+    ::unlink("storage_test_lun0.log");
+    ::unlink("storage_test_lun1.log");
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
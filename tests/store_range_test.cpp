@@ -0,0 +1,183 @@
+// store_range_test checks unique_parameter::store_range(): against
+// packed_file_storage it writes only the range asked for, a value that also
+// changed outside the range is left to the next store(), which writes the
+// whole record, and a backend that cannot address part of a record, or
+// none at all, gets the whole record through store() and the per-UID hooks.
+// Exits non-zero on a failed check.
+
+#include <unistd.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../packed_file_storage.hpp"
+#include "../parameter.hpp"
+
+namespace {
+
+using cgx::parameter::uid_value_t;
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+using table_t = std::array<int, 16>;
+
+// The hooks count whole-record writes.
+size_t g_hook_writes = 0;
+size_t g_hook_size   = 0;
+
+// spy_storage counts what reaches packed_file_storage. With partial unset
+// it keeps the storage_i defaults for read_at() and write_at().
+class spy_storage : public cgx::parameter::packed_file_storage {
+   public:
+    using packed_file_storage::packed_file_storage;
+
+    bool write(
+        size_t lun, uid_value_t uid, const uint8_t* src, size_t len
+    ) override {
+        writes += 1;
+        return packed_file_storage::write(lun, uid, src, len);
+    }
+
+    bool read_at(
+        size_t      lun,
+        uid_value_t uid,
+        size_t      offset,
+        uint8_t*    dst,
+        size_t      len
+    ) override {
+        return partial &&
+               packed_file_storage::read_at(lun, uid, offset, dst, len);
+    }
+
+    bool write_at(
+        size_t         lun,
+        uid_value_t    uid,
+        size_t         offset,
+        const uint8_t* src,
+        size_t         len
+    ) override {
+        if (!partial) {
+            return false;
+        }
+        ranged_writes += 1;
+        ranged_offset = offset;
+        ranged_bytes += len;
+        return packed_file_storage::write_at(lun, uid, offset, src, len);
+    }
+
+    bool   partial       = true;
+    size_t writes        = 0;
+    size_t ranged_writes = 0;
+    size_t ranged_offset = 0;
+    size_t ranged_bytes  = 0;
+};
+
+const char* const pattern = "store_range_test_lun%zu.bin";
+const char* const path    = "store_range_test_lun0.bin";
+
+// reread retrieves the table from a fresh open of the file.
+table_t reread() {
+    cgx::parameter::packed_file_storage storage(pattern);
+    cgx::parameter::set_storage(&storage);
+    cgx::unique_parameter_list<0, 1> params(discard);
+    auto& table = params.add("table", table_t{});
+    check(table.retrieve(), "reread");
+    cgx::parameter::set_storage(nullptr);
+    return table.value();
+}
+
+void ranged() {
+    ::unlink(path);
+    {
+        spy_storage storage(pattern);
+        cgx::parameter::set_storage(&storage);
+
+        cgx::unique_parameter_list<0, 1> params(discard);
+        auto& table = params.add("table", table_t{});
+
+        // Nothing stored yet: the whole record is written.
+        table[3] = 1;
+        check(table.store_range(3 * sizeof(int), sizeof(int)), "first");
+        check(storage.writes == 1 && storage.ranged_writes == 0, "whole");
+
+        // Only entry 5 changed: one ranged write of its bytes.
+        table[5] = 2;
+        check(table.store_range(5 * sizeof(int), sizeof(int)), "ranged");
+        check(storage.writes == 1 && storage.ranged_writes == 1, "range only");
+        check(storage.ranged_offset == 5 * sizeof(int), "range offset");
+        check(storage.ranged_bytes == sizeof(int), "range size");
+        check(table.is_stored(), "stored after the range");
+        check(table.store() && storage.writes == 1, "store() skips");
+
+        // Entries 7 and 9 changed but only 7 is written: the value is not
+        // stored, so store() writes the whole record.
+        table[7] = 3;
+        table[9] = 4;
+        check(table.store_range(7 * sizeof(int), sizeof(int)), "mismatch");
+        check(storage.ranged_writes == 2 && !table.is_stored(), "not stored");
+        check(table.store() && storage.writes == 2, "full store() follows");
+        check(table.is_stored(), "stored after store()");
+
+        // A backend that cannot address part of a record gets store().
+        storage.partial = false;
+        table[11]       = 5;
+        check(table.store_range(11 * sizeof(int), sizeof(int)), "fallback");
+        check(storage.writes == 3 && storage.ranged_writes == 2, "full");
+        check(table.is_stored(), "stored by the fallback");
+        cgx::parameter::set_storage(nullptr);
+    }
+
+    const table_t t = reread();
+    check(t[3] == 1 && t[5] == 2 && t[7] == 3, "persisted");
+    check(t[9] == 4 && t[11] == 5 && t[0] == 0, "persisted all");
+    ::unlink(path);
+}
+
+// Without a backend the per-UID hooks take the whole record.
+void hooks() {
+    cgx::unique_parameter_list<0, 1> params(discard);
+    auto&                            table = params.add("table", table_t{});
+
+    table[1] = 1;
+    check(table.store(), "hook store");
+    check(g_hook_writes == 1 && g_hook_size == sizeof(table_t), "hook");
+
+    table[2] = 2;
+    check(table.store_range(2 * sizeof(int), sizeof(int)), "hook fallback");
+    check(g_hook_writes == 2 && g_hook_size == sizeof(table_t), "hook whole");
+    check(table.is_stored(), "stored through the hook");
+}
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(
+    size_t, uid_value_t, const uint8_t*, size_t len
+) {
+    g_hook_writes += 1;
+    g_hook_size = len;
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+int main() {
+    ranged();
+    hooks();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
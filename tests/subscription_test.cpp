@@ -0,0 +1,201 @@
+// subscription_test checks typed subscriptions: every subscriber of a
+// parameter sees each change with its old and new value, a coalescing one
+// reports the first old value and the current one on flush(), a list
+// transaction holds all of them until commit() and drops what they held on
+// rollback(), and destroying either side unlinks the subscription. Array
+// subscriptions report merged index ranges. Exits non-zero on a failed
+// check.
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+
+#include "../parameter.hpp"
+
+bool cgx::parameter::set_bytes(size_t, uid_value_t, const uint8_t*, size_t) {
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+using cgx::parameter::subscription;
+
+// log_t counts deliveries and keeps the last old and new value.
+struct log_t {
+    int count     = 0;
+    int old_value = 0;
+    int new_value = 0;
+
+    subscription<int>::callback_t callback() {
+        return [this](const auto&, const int& old_value, const int& value) {
+            this->count += 1;
+            this->old_value = old_value;
+            this->new_value = value;
+        };
+    }
+
+    bool saw(int count, int old_value, int new_value) const {
+        return this->count == count && this->old_value == old_value &&
+               this->new_value == new_value;
+    }
+};
+
+void delivery() {
+    cgx::unique_parameter_list<0, 2> params(discard);
+    auto&                            a = params.add("a", 1);
+
+    log_t             first;
+    log_t             second;
+    log_t             frame;
+    subscription<int> sub1(first.callback());
+    subscription<int> sub2(second.callback());
+    subscription<int> coalesced(frame.callback(), true);
+    a.subscribe(sub1);
+    a.subscribe(sub2);
+    a.subscribe(coalesced);
+
+    a = 2;
+    check(first.saw(1, 1, 2) && second.saw(1, 1, 2), "both delivered");
+    a = 2;
+    check(first.count == 1, "unchanged value not delivered");
+
+    // The coalescing subscription reports the value before its first change
+    // and the current one.
+    a = 3;
+    check(frame.count == 0 && coalesced.pending(), "coalesced recorded");
+    check(coalesced.flush() && frame.saw(1, 1, 3), "coalesced flush");
+    check(!coalesced.flush() && frame.count == 1, "nothing left to flush");
+
+    // set_bytes() and reset() are changes like any other.
+    const int bytes = 4;
+    a.set_bytes(reinterpret_cast<const uint8_t*>(&bytes), sizeof(bytes));
+    check(first.saw(3, 3, 4), "set_bytes delivered");
+    a.reset();
+    check(second.saw(4, 4, 1), "reset delivered");
+
+    sub1.unsubscribe();
+    a = 5;
+    check(first.count == 4 && second.count == 5, "unsubscribed");
+    a.subscribe(sub1);
+    a.subscribe(sub1);
+    a = 6;
+    check(first.saw(5, 5, 6), "subscribed once");
+}
+
+void transaction() {
+    using list_t = cgx::unique_parameter_list<0, 2>;
+
+    list_t params(discard);
+    auto&  a = params.add("a", 1);
+
+    log_t             log;
+    log_t             frame;
+    subscription<int> sub(log.callback());
+    subscription<int> coalesced(frame.callback(), true);
+    a.subscribe(sub);
+    a.subscribe(coalesced);
+
+    // Held changes coalesce into one delivery on commit(), from the value
+    // before the transaction.
+    uint8_t buffer[64];
+    check(params.begin(buffer, sizeof(buffer)), "begin");
+    a = 2;
+    a = 3;
+    check(log.count == 0 && sub.pending(), "held");
+    check(params.commit(), "commit");
+    check(log.saw(1, 1, 3), "one delivery on commit");
+
+    // A coalescing subscription keeps its own schedule across commit().
+    check(frame.count == 0 && coalesced.flush(), "coalescing not released");
+    check(frame.saw(1, 1, 3), "coalescing flushed");
+
+    // rollback() drops what was held.
+    check(params.begin(buffer, sizeof(buffer)), "begin again");
+    a = 4;
+    params.rollback();
+    check(a == 3 && log.count == 1 && !sub.pending(), "dropped on rollback");
+    a = 5;
+    check(log.saw(2, 3, 5), "delivered after rollback");
+}
+
+void lifetime() {
+    cgx::unique_parameter_list<0, 2> params(discard);
+    auto&                            a = params.add("a", 1);
+
+    log_t             log;
+    subscription<int> kept(log.callback());
+    a.subscribe(kept);
+    {
+        log_t             gone;
+        subscription<int> temporary(gone.callback());
+        a.subscribe(temporary);
+    }
+    a = 2;
+    check(log.saw(1, 1, 2), "destroyed subscription unlinked");
+
+    // A subscription outlives its parameter.
+    log_t             orphan_log;
+    subscription<int> orphan(orphan_log.callback(), true);
+    {
+        std::optional<cgx::parameter::parameter<int>> b;
+        b.emplace(discard, 1);
+        b->subscribe(orphan);
+        *b = 2;
+        check(orphan.pending(), "pending before destruction");
+    }
+    check(!orphan.pending() && !orphan.flush(), "unlinked by parameter");
+}
+
+void array() {
+    using array_t = std::array<int, 8>;
+
+    cgx::unique_parameter_list<0, 2> params(discard);
+    auto& table = params.add("table", array_t{});
+
+    size_t                calls = 0;
+    size_t                first = 0;
+    size_t                last  = 0;
+    subscription<array_t> sub(
+        [&calls, &first, &last](const auto&, size_t from, size_t to) {
+            calls += 1;
+            first = from;
+            last  = to;
+        },
+        true
+    );
+    table.subscribe(sub);
+
+    table[5] = 1;
+    table[2] = 1;
+    check(calls == 0 && sub.flush(), "array coalesced");
+    check(calls == 1 && first == 2 && last == 6, "ranges merged");
+}
+
+}  // namespace
+
+int main() {
+    delivery();
+    transaction();
+    lifetime();
+    array();
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// transaction_test checks list transactions: commit() fires on_changed once
+// per changed parameter and stores the values, rollback() restores them and
+// drops the held callbacks, a failed store rolls back, and a parameter
+// added during the transaction joins it. Exits non-zero on a failed check.
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../parameter.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+// The hooks keep one int record per UID and fail while g_fail is set.
+struct record {
+    cgx::parameter::uid_value_t uid;
+    int                         value;
+    bool                        used;
+};
+
+std::array<record, 8> g_records{};
+bool                  g_fail = false;
+
+record* find(cgx::parameter::uid_value_t uid) {
+    for (auto& r : g_records) {
+        if (r.used && r.uid == uid) {
+            return &r;
+        }
+    }
+    for (auto& r : g_records) {
+        if (!r.used) {
+            r = record{uid, 0, true};
+            return &r;
+        }
+    }
+    return nullptr;
+}
+
+int stored(const cgx::unique_parameter<int>& param) {
+    return find(param.uid())->value;
+}
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(
+    size_t, uid_value_t uid, const uint8_t* src, size_t len
+) {
+    record* r = find(uid);
+    if (g_fail || r == nullptr || len != sizeof(int)) {
+        return false;
+    }
+    std::memcpy(&r->value, src, len);
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+int main() {
+    using list_t = cgx::unique_parameter_list<0, 5>;
+
+    list_t params(discard);
+    auto&  a = params.add("a", 1);
+    auto&  b = params.add("b", 2);
+    auto&  c = params.add("c", 3);
+
+    std::array<int, 5> calls{};
+    a.on_changed([&calls]() {
+        calls[0] += 1;
+    });
+    b.on_changed([&calls]() {
+        calls[1] += 1;
+    });
+    c.on_changed([&calls]() {
+        calls[2] += 1;
+    });
+
+    uint8_t buffer[256];
+
+    // Commit: one callback per changed parameter, and the values stored.
+    check(params.begin(buffer, sizeof(buffer)), "begin");
+    a = 10;
+    a = 11;
+    b = 20;
+    check(calls == std::array<int, 5>{}, "callbacks held");
+    check(params.commit(), "commit");
+    check(calls == (std::array<int, 5>{1, 1, 0, 0, 0}), "one callback each");
+    check(stored(a) == 11 && stored(b) == 20, "stored on commit");
+
+    // Rollback: values restored, held callbacks dropped.
+    calls = {};
+    {
+        cgx::list_transaction<list_t> update(params, buffer, sizeof(buffer));
+        a = 12;
+        c = 30;
+    }
+    check(a == 11 && c == 3, "rolled back");
+    check(calls == std::array<int, 5>{}, "callbacks dropped");
+    check(stored(a) == 11, "nothing stored on rollback");
+    a = 13;
+    check(calls[0] == 1, "callbacks fire again after rollback");
+
+    // A failed store rolls the values back and fires nothing.
+    calls = {};
+    check(params.begin(buffer, sizeof(buffer)), "begin failing");
+    b      = 21;
+    g_fail = true;
+    check(!params.commit(), "commit fails");
+    g_fail = false;
+    check(b == 20 && !params.in_transaction(), "failed commit rolled back");
+    check(calls == std::array<int, 5>{}, "no callback on failed commit");
+
+    // A parameter added during a transaction is held like the others and
+    // goes back to the value it was added with on rollback.
+    calls = {};
+    check(params.begin(buffer, sizeof(buffer)), "begin with add");
+    auto& d = params.add("d", 4);
+    d.on_changed([&calls]() {
+        calls[3] += 1;
+    });
+    d = 40;
+    check(calls[3] == 0, "added parameter held");
+    params.rollback();
+    check(d == 4 && calls[3] == 0, "added parameter rolled back");
+
+    check(params.begin(buffer, sizeof(buffer)), "begin again");
+    auto& e = params.add("e", 5);
+    e.on_changed([&calls]() {
+        calls[4] += 1;
+    });
+    e = 50;
+    check(calls[4] == 0, "added parameter held again");
+    check(params.commit() && calls[4] == 1, "added parameter committed");
+    check(stored(e) == 50, "added parameter stored");
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
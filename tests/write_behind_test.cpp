@@ -0,0 +1,105 @@
+// write_behind_test drives a write_behind queue both as a hand-pumped queue
+// and with its worker: changes within the window coalesce into one write,
+// barrier() returns once earlier changes are persisted, stats() counts
+// what happened, and destroying a pumped queue still writes what it held.
+// Exits non-zero on a failed check.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../write_behind.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failures += 1;
+    }
+}
+
+void discard(const char*) {
+}
+
+// The hooks keep the last int written and count the writes.
+size_t g_writes = 0;
+int    g_last   = 0;
+
+}  // namespace
+
+bool cgx::parameter::set_bytes(
+    size_t, uid_value_t, const uint8_t* src, size_t len
+) {
+    if (len != sizeof(int)) {
+        return false;
+    }
+    std::memcpy(&g_last, src, len);
+    g_writes += 1;
+    return true;
+}
+
+bool cgx::parameter::get_bytes(size_t, uid_value_t, uint8_t*, size_t) {
+    return false;
+}
+
+int main() {
+    using queue_t = cgx::write_behind<4>;
+
+    cgx::unique_parameter_list<0, 4> params(discard);
+    auto&                            a = params.add("a", 0);
+
+    // Pumped by hand, with a window long enough that only a forced flush
+    // writes.
+    {
+        queue_t queue(std::chrono::hours{1});
+        params.set_write_behind(&queue);
+
+        a = 1;
+        a = 2;
+        a = 3;
+        auto stats = queue.stats();
+        check(stats.enqueued == 1 && stats.coalesced == 2, "coalesced");
+        check(stats.depth == 1 && queue.depth() == 1, "one queued");
+        check(queue.flush() == 0 && g_writes == 0, "window not expired");
+        check(queue.flush(true) == 1, "forced flush");
+        check(g_writes == 1 && g_last == 3, "latest value written");
+
+        a = 4;
+        queue.barrier();
+        stats = queue.stats();
+        check(g_writes == 2 && g_last == 4, "barrier flushes");
+        check(stats.written == 2 && stats.failed == 0, "written counted");
+        check(stats.depth == 0 && stats.max_depth == 1, "depth counted");
+
+        // The queue is destroyed with a change still queued.
+        a = 5;
+        params.set_write_behind<queue_t>(nullptr);
+    }
+    check(g_writes == 3 && g_last == 5, "destroyed queue drained");
+
+    // With the worker, barrier() waits for it instead of flushing.
+    {
+        queue_t queue;
+        params.set_write_behind(&queue);
+        queue.start(std::chrono::microseconds{100});
+
+        for (int i = 6; i <= 100; ++i) {
+            a = i;
+        }
+        queue.barrier();
+        check(g_last == 100, "worker persisted the latest value");
+
+        const auto stats = queue.stats();
+        check(stats.written + stats.failed == stats.enqueued, "all written");
+        check(stats.enqueued + stats.coalesced == 95, "all changes seen");
+        queue.stop();
+        params.set_write_behind<queue_t>(nullptr);
+    }
+
+    std::printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
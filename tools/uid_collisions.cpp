@@ -0,0 +1,124 @@
+// uid_collisions reads parameter names, one per line, from a file or stdin
+// and reports how many of them collide under each UID hash.
+//
+//   g++ -std=c++17 -I.. uid_collisions.cpp -o uid_collisions
+//   ./uid_collisions names.txt [-v]
+//
+// With -v every colliding pair is printed as well.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../uid.hpp"
+
+namespace {
+
+using namespace cgx::parameter;
+
+template <typename U>
+size_t scan(
+    const char*                     label,
+    U                               (*hash)(std::string_view),
+    const std::vector<std::string>& names,
+    bool                            verbose
+) {
+    std::vector<std::pair<U, size_t>> keys;
+    keys.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        keys.emplace_back(hash(names[i]), i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    size_t collisions = 0;
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keys[i].first != keys[i - 1].first) {
+            continue;
+        }
+        collisions += 1;
+        if (verbose) {
+            std::printf(
+                "  %-10s %016llx %s == %s\n",
+                label,
+                static_cast<unsigned long long>(keys[i].first),
+                names[keys[i - 1].second].c_str(),
+                names[keys[i].second].c_str()
+            );
+        }
+    }
+
+    std::printf(
+        "%-12s %8zu collisions  %8.4f%%\n",
+        label,
+        collisions,
+        names.empty() ? 0.0 : 100.0 * collisions / names.size()
+    );
+    return collisions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const char* path    = nullptr;
+    bool        verbose = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    std::ifstream file;
+    if (path != nullptr) {
+        file.open(path);
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", path);
+            return 2;
+        }
+    }
+    std::istream& in = path != nullptr ? file : std::cin;
+
+    // Duplicate names are the same parameter, not a collision.
+    std::vector<std::string> names;
+    for (std::string line; std::getline(in, line);) {
+        if (!line.empty()) {
+            names.push_back(line);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    std::printf("%zu unique names\n", names.size());
+    const size_t selected =
+        scan<uid_value_t>("selected", uid_hash::selected, names, verbose);
+    scan<uint32_t>("poly32", uid_hash::polynomial<uint32_t>, names, verbose);
+    scan<uint64_t>("poly64", uid_hash::polynomial<uint64_t>, names, verbose);
+    scan<uint32_t>("fnv1a32", uid_hash::fnv1a32, names, verbose);
+    scan<uint64_t>("fnv1a64", uid_hash::fnv1a64, names, verbose);
+    scan<uint32_t>("crc32", uid_hash::crc32, names, verbose);
+
+    // The xxHash functions take an optional seed.
+    scan<uint32_t>(
+        "xxhash32",
+        [](std::string_view name) { return uid_hash::xxhash32(name); },
+        names,
+        verbose
+    );
+    scan<uint64_t>(
+        "xxhash64",
+        [](std::string_view name) { return uid_hash::xxhash64(name); },
+        names,
+        verbose
+    );
+
+    // A non-zero exit status lets build scripts reject colliding name sets.
+    return selected == 0 ? 0 : 1;
+}
@@ -4,24 +4,234 @@
 #include <cstring>
 #include <string_view>
 
+#include "crc.hpp"
+
+// Hash functions that derive UIDs from parameter names.
+#define CGX_PARAMETER_UID_HASH_POLYNOMIAL 0
+#define CGX_PARAMETER_UID_HASH_FNV1A      1
+#define CGX_PARAMETER_UID_HASH_XXHASH     2
+#define CGX_PARAMETER_UID_HASH_CRC32      3
+
+#ifndef CGX_PARAMETER_UID_HASH
+#define CGX_PARAMETER_UID_HASH CGX_PARAMETER_UID_HASH_POLYNOMIAL
+#endif
+
+// UID width in bits, 32 or 64. Stores record the width and refuse to open
+// files written with a different one.
+#ifndef CGX_PARAMETER_UID_BITS
+#define CGX_PARAMETER_UID_BITS 32
+#endif
+
+#if CGX_PARAMETER_UID_BITS != 32 && CGX_PARAMETER_UID_BITS != 64
+#error "CGX_PARAMETER_UID_BITS must be 32 or 64"
+#endif
+
+#if CGX_PARAMETER_UID_BITS == 64 && \
+    CGX_PARAMETER_UID_HASH == CGX_PARAMETER_UID_HASH_CRC32
+#error "CRC32 UIDs are 32 bits wide"
+#endif
+
 namespace cgx::parameter {
 
+#if CGX_PARAMETER_UID_BITS == 64
+using uid_value_t = uint64_t;
+#else
+using uid_value_t = uint32_t;
+#endif
+
+// key_version identifies how stored keys were derived: the UID width in the
+// high byte and the hash function in the low byte. Stores written before
+// the version was recorded hold 0, which stands for 32-bit polynomial UIDs.
+constexpr uint32_t key_version =
+    (CGX_PARAMETER_UID_BITS << 8) | CGX_PARAMETER_UID_HASH;
+
+constexpr uint32_t _key_version(uint32_t stored) {
+    return stored == 0 ? (32 << 8) | CGX_PARAMETER_UID_HASH_POLYNOMIAL
+                       : stored;
+}
+
+constexpr uint32_t _key_bits(uint32_t version) {
+    return _key_version(version) >> 8;
+}
+
+namespace uid_hash {
+
+template <typename U>
+constexpr U polynomial(std::string_view name) {
+    U hash = 0;
+    for (size_t i = 0; i < name.size(); ++i) {
+        hash = (hash * 31) + static_cast<U>(name[i]);
+    }
+    return hash;
+}
+
+constexpr uint32_t fnv1a32(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+constexpr uint64_t fnv1a64(std::string_view name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename U>
+constexpr U _read_le(std::string_view data, size_t offset) {
+    U value = 0;
+    for (size_t i = 0; i < sizeof(U); ++i) {
+        value |= static_cast<U>(static_cast<uint8_t>(data[offset + i]))
+                 << (8 * i);
+    }
+    return value;
+}
+
+constexpr uint32_t _rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+constexpr uint64_t _rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+constexpr uint32_t xxhash32(std::string_view name, uint32_t seed = 0) {
+    constexpr uint32_t p1 = 2654435761u;
+    constexpr uint32_t p2 = 2246822519u;
+    constexpr uint32_t p3 = 3266489917u;
+    constexpr uint32_t p4 = 668265263u;
+    constexpr uint32_t p5 = 374761393u;
+
+    const size_t size = name.size();
+    size_t       i    = 0;
+    uint32_t     hash = 0;
+    if (size >= 16) {
+        uint32_t v[4] = {seed + p1 + p2, seed + p2, seed, seed - p1};
+        for (; i + 16 <= size; i += 16) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                v[lane] += _read_le<uint32_t>(name, i + 4 * lane) * p2;
+                v[lane] = _rotl32(v[lane], 13) * p1;
+            }
+        }
+        hash = _rotl32(v[0], 1) + _rotl32(v[1], 7) + _rotl32(v[2], 12) +
+               _rotl32(v[3], 18);
+    } else {
+        hash = seed + p5;
+    }
+    hash += static_cast<uint32_t>(size);
+
+    for (; i + 4 <= size; i += 4) {
+        hash += _read_le<uint32_t>(name, i) * p3;
+        hash = _rotl32(hash, 17) * p4;
+    }
+    for (; i < size; ++i) {
+        hash += static_cast<uint8_t>(name[i]) * p5;
+        hash = _rotl32(hash, 11) * p1;
+    }
+
+    hash ^= hash >> 15;
+    hash *= p2;
+    hash ^= hash >> 13;
+    hash *= p3;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+constexpr uint64_t xxhash64(std::string_view name, uint64_t seed = 0) {
+    constexpr uint64_t p1 = 11400714785074694791ull;
+    constexpr uint64_t p2 = 14029467366897019727ull;
+    constexpr uint64_t p3 = 1609587929392839161ull;
+    constexpr uint64_t p4 = 9650029242287828579ull;
+    constexpr uint64_t p5 = 2870177450012600261ull;
+
+    const size_t size = name.size();
+    size_t       i    = 0;
+    uint64_t     hash = 0;
+    if (size >= 32) {
+        uint64_t v[4] = {seed + p1 + p2, seed + p2, seed, seed - p1};
+        for (; i + 32 <= size; i += 32) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                v[lane] += _read_le<uint64_t>(name, i + 8 * lane) * p2;
+                v[lane] = _rotl64(v[lane], 31) * p1;
+            }
+        }
+        hash = _rotl64(v[0], 1) + _rotl64(v[1], 7) + _rotl64(v[2], 12) +
+               _rotl64(v[3], 18);
+        for (size_t lane = 0; lane < 4; ++lane) {
+            hash ^= _rotl64(v[lane] * p2, 31) * p1;
+            hash = hash * p1 + p4;
+        }
+    } else {
+        hash = seed + p5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    for (; i + 8 <= size; i += 8) {
+        hash ^= _rotl64(_read_le<uint64_t>(name, i) * p2, 31) * p1;
+        hash = _rotl64(hash, 27) * p1 + p4;
+    }
+    if (i + 4 <= size) {
+        hash ^= static_cast<uint64_t>(_read_le<uint32_t>(name, i)) * p1;
+        hash = _rotl64(hash, 23) * p2 + p3;
+        i += 4;
+    }
+    for (; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(name[i]) * p5;
+        hash = _rotl64(hash, 11) * p1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= p2;
+    hash ^= hash >> 29;
+    hash *= p3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+constexpr uint32_t crc32(std::string_view name) {
+    return _calc_crc(name);
+}
+
+// selected is the hash configured by CGX_PARAMETER_UID_HASH and
+// CGX_PARAMETER_UID_BITS.
+constexpr uid_value_t selected(std::string_view name) {
+#if CGX_PARAMETER_UID_HASH == CGX_PARAMETER_UID_HASH_FNV1A
+#if CGX_PARAMETER_UID_BITS == 64
+    return fnv1a64(name);
+#else
+    return fnv1a32(name);
+#endif
+#elif CGX_PARAMETER_UID_HASH == CGX_PARAMETER_UID_HASH_XXHASH
+#if CGX_PARAMETER_UID_BITS == 64
+    return xxhash64(name);
+#else
+    return xxhash32(name);
+#endif
+#elif CGX_PARAMETER_UID_HASH == CGX_PARAMETER_UID_HASH_CRC32
+    return crc32(name);
+#else
+    return polynomial<uid_value_t>(name);
+#endif
+}
+
+}  // namespace uid_hash
+
 class uid_t {
    public:
-    constexpr uid_t(uint32_t uid = 0) : m_name(""), m_uid(uid) {
+    constexpr uid_t(uid_value_t uid = 0) : m_name(""), m_uid(uid) {
     }
     constexpr uid_t(std::string_view name) : m_name(name), m_uid(hash(name)) {
     }
 
-    static constexpr uint32_t hash(std::string_view name) {
-        uint32_t hash = 0;
-        for (size_t i = 0; i < name.size(); ++i) {
-            hash = (hash * 31) + static_cast<uint32_t>(name[i]);
-        }
-        return hash;
+    static constexpr uid_value_t hash(std::string_view name) {
+        return uid_hash::selected(name);
     }
 
-    constexpr uint32_t get_uid() const {
+    constexpr uid_value_t get_uid() const {
         return m_uid;
     }
 
@@ -45,13 +255,13 @@ class uid_t {
         return const_cast<char*>(m_name.data());
     }
 
-    constexpr operator uint32_t() const {
+    constexpr operator uid_value_t() const {
         return m_uid;
     }
 
    private:
     const std::string_view m_name;
-    const uint32_t         m_uid{0};
+    const uid_value_t      m_uid{0};
 };
 
 }  // namespace cgx::parameter
@@ -0,0 +1,333 @@
+#pragma once
+
+// Coalescing write-behind queue for unique_parameter_list. Changed
+// parameters are queued by slot from any thread without locks; a worker
+// thread or a user-driven flush() pump persists their latest value.
+//
+// The value is copied into its slot on the thread that changed it, and the
+// worker writes that copy to the backend. It never touches the parameter,
+// which may be changing on its own thread meanwhile.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "parameter.hpp"
+
+// Bytes each slot keeps for the value waiting to be written. Larger values
+// are stored at once on the thread that changed them.
+#ifndef CGX_PARAMETER_WRITE_BEHIND_SIZE
+#define CGX_PARAMETER_WRITE_BEHIND_SIZE 64
+#endif
+
+namespace cgx {
+
+template <size_t N, size_t Size = CGX_PARAMETER_WRITE_BEHIND_SIZE>
+class write_behind {
+   public:
+    using clock = std::chrono::steady_clock;
+
+    struct stats_t {
+        size_t   enqueued;    // parameters queued for a write
+        size_t   coalesced;   // changes folded into an already queued write
+        size_t   written;     // successful writes
+        size_t   failed;      // failed writes
+        size_t   depth;       // parameters currently queued
+        size_t   max_depth;   // high-water mark of depth
+        uint64_t latency_us;  // summed time from first change to persisted
+        uint64_t max_latency_us;
+    };
+
+    // Changes to a queued parameter within window of its first change are
+    // folded into a single write.
+    explicit write_behind(
+        std::chrono::microseconds window = std::chrono::microseconds{0}
+    )
+        : m_window(window) {
+        for (size_t i = 0; i < m_ring.size(); ++i) {
+            m_ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    write_behind(const write_behind&)            = delete;
+    write_behind& operator=(const write_behind&) = delete;
+    ~write_behind() {
+        stop();
+    }
+
+    // enqueue copies the value of param into slot and marks the slot as
+    // needing a write. It never blocks: a slot that is already queued only
+    // gets the newer copy and is counted as coalesced, so the ring, sized
+    // for N slots, cannot overflow. Values larger than Size are stored
+    // right away instead, as are values without a byte image.
+    void enqueue(size_t slot, unique_parameter_i* param) {
+        if (slot >= N) {
+            return;
+        }
+        auto& state = m_slots[slot];
+        if (param->byte_size() > Size || !this->copy(state, *param)) {
+            m_pushed.fetch_add(1, std::memory_order_relaxed);
+            this->record(param->store(), _now());
+            return;
+        }
+        if (state.queued.exchange(true, std::memory_order_acq_rel)) {
+            m_coalesced.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        state.since.store(_now(), std::memory_order_relaxed);
+        this->push(slot);
+
+        size_t depth = m_depth.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t high  = m_max_depth.load(std::memory_order_relaxed);
+        while (depth > high && !m_max_depth.compare_exchange_weak(
+                                   high, depth, std::memory_order_relaxed
+                               )) {
+        }
+        m_pushed.fetch_add(1, std::memory_order_release);
+    }
+
+    // flush persists queued parameters whose coalescing window has expired,
+    // or all of them when force is set. Returns the number of writes. Only
+    // one thread may consume the queue at a time: call flush() from a single
+    // pump, or use start() and let the worker do it.
+    size_t flush(bool force = false) {
+        size_t written = 0;
+        while (true) {
+            if (m_held == npos && !this->pop(m_held)) {
+                break;
+            }
+            auto& state = m_slots[m_held];
+            if (!force &&
+                _now() - state.since.load(std::memory_order_relaxed) <
+                    m_window.count()) {
+                break;
+            }
+            written += this->persist(m_held);
+            m_held = npos;
+        }
+        return written;
+    }
+
+    // barrier returns once every change made before the call is persisted.
+    void barrier() {
+        const size_t target = m_pushed.load(std::memory_order_acquire);
+        while (m_completed.load(std::memory_order_acquire) < target) {
+            if (m_running.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            } else {
+                this->flush(true);
+            }
+        }
+    }
+
+    // start runs flush() on a background thread, polling every period.
+    void start(std::chrono::microseconds period = std::chrono::milliseconds{1}
+    ) {
+        if (m_running.exchange(true)) {
+            return;
+        }
+        m_worker = std::thread([this, period]() {
+            while (m_running.load(std::memory_order_acquire)) {
+                this->flush();
+                std::this_thread::sleep_for(period);
+            }
+            this->flush(true);
+        });
+    }
+
+    // stop drains the queue and joins the worker. Without a worker, as
+    // when flush() is pumped by hand, it drains the queue on the calling
+    // thread, so that destroying the queue never drops queued changes.
+    void stop() {
+        if (!m_running.exchange(false)) {
+            this->flush(true);
+            return;
+        }
+        m_worker.join();
+    }
+
+    size_t depth() const {
+        return m_depth.load(std::memory_order_relaxed);
+    }
+
+    stats_t stats() const {
+        return stats_t{
+            m_pushed.load(std::memory_order_relaxed),
+            m_coalesced.load(std::memory_order_relaxed),
+            m_written.load(std::memory_order_relaxed),
+            m_failed.load(std::memory_order_relaxed),
+            m_depth.load(std::memory_order_relaxed),
+            m_max_depth.load(std::memory_order_relaxed),
+            m_latency_us.load(std::memory_order_relaxed),
+            m_max_latency_us.load(std::memory_order_relaxed),
+        };
+    }
+
+   private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    static constexpr size_t _capacity() {
+        size_t capacity = 1;
+        while (capacity < N) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    static int64_t _now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   clock::now().time_since_epoch()
+        )
+            .count();
+    }
+
+    // slot_state holds the copy of a queued value under a seqlock: the
+    // sequence is odd while enqueue() writes it, and persist() retries a
+    // read that overlapped a write.
+    struct slot_state {
+        std::atomic<bool>      queued{false};
+        std::atomic<int64_t>   since{0};
+        std::atomic<uint32_t>  sequence{0};
+        size_t                 lun{0};
+        parameter::uid_value_t uid{0};
+        size_t                 size{0};
+        uint8_t                bytes[Size];
+    };
+
+    // Bounded multi-producer ring after Dmitry Vyukov's MPMC queue.
+    struct cell {
+        std::atomic<size_t> sequence;
+        size_t              slot;
+    };
+
+    std::chrono::microseconds           m_window;
+    std::array<slot_state, N>           m_slots{};
+    std::array<cell, _capacity()>       m_ring{};
+    alignas(64) std::atomic<size_t>     m_tail{0};
+    alignas(64) std::atomic<size_t>     m_head{0};
+    size_t                              m_held{npos};
+    std::atomic<size_t>                 m_pushed{0};
+    std::atomic<size_t>                 m_completed{0};
+    std::atomic<size_t>                 m_coalesced{0};
+    std::atomic<size_t>                 m_written{0};
+    std::atomic<size_t>                 m_failed{0};
+    std::atomic<size_t>                 m_depth{0};
+    std::atomic<size_t>                 m_max_depth{0};
+    std::atomic<uint64_t>               m_latency_us{0};
+    std::atomic<uint64_t>               m_max_latency_us{0};
+    std::atomic<bool>                   m_running{false};
+    std::thread                         m_worker;
+
+    void push(size_t slot) {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        while (true) {
+            cell&  c   = m_ring[pos & (m_ring.size() - 1)];
+            size_t seq = c.sequence.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (m_tail.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed
+                    )) {
+                    c.slot = slot;
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(size_t& slot) {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        while (true) {
+            cell&  c   = m_ring[pos & (m_ring.size() - 1)];
+            size_t seq = c.sequence.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (m_head.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed
+                    )) {
+                    slot = c.slot;
+                    c.sequence.store(
+                        pos + m_ring.size(), std::memory_order_release
+                    );
+                    return true;
+                }
+            } else if (seq < pos + 1) {
+                return false;
+            } else {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t persist(size_t slot) {
+        auto& state = m_slots[slot];
+        // Clear the flag first so changes made during the write queue the
+        // parameter again instead of being lost.
+        state.queued.exchange(false, std::memory_order_acq_rel);
+        m_depth.fetch_sub(1, std::memory_order_relaxed);
+        const int64_t since = state.since.load(std::memory_order_relaxed);
+
+        size_t                 lun;
+        parameter::uid_value_t uid;
+        size_t                 size;
+        uint8_t                bytes[Size];
+        while (true) {
+            const uint32_t before =
+                state.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            lun  = state.lun;
+            uid  = state.uid;
+            size = state.size;
+            std::memcpy(bytes, state.bytes, size <= Size ? size : 0);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (state.sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        const bool ok = cgx::parameter::save(lun, uid, bytes, size);
+        this->record(ok, since);
+        return ok ? 1 : 0;
+    }
+
+    // copy writes the value of param into state. Only the thread changing
+    // a parameter enqueues it, so writers of a slot rarely meet; when they
+    // do, e.g. two writers of a concurrent<T>, the later one waits.
+    // Returns false if param has no byte image to copy.
+    bool copy(slot_state& state, const unique_parameter_i& param) {
+        uint32_t sequence = state.sequence.load(std::memory_order_relaxed);
+        while ((sequence & 1) != 0 ||
+               !state.sequence.compare_exchange_weak(
+                   sequence, sequence + 1, std::memory_order_acquire
+               )) {
+            sequence = state.sequence.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        state.lun  = param.get_lun();
+        state.uid  = param.uid();
+        state.size = param.byte_size();
+        const bool ok = param.get_bytes(state.bytes, state.size);
+        state.sequence.store(sequence + 2, std::memory_order_release);
+        return ok;
+    }
+
+    // record counts a finished write of a change first made at since.
+    void record(bool ok, int64_t since) {
+        const uint64_t latency = static_cast<uint64_t>(_now() - since);
+        m_latency_us.fetch_add(latency, std::memory_order_relaxed);
+        uint64_t high = m_max_latency_us.load(std::memory_order_relaxed);
+        while (latency > high && !m_max_latency_us.compare_exchange_weak(
+                                     high, latency, std::memory_order_relaxed
+                                 )) {
+        }
+        (ok ? m_written : m_failed).fetch_add(1, std::memory_order_relaxed);
+        m_completed.fetch_add(1, std::memory_order_release);
+    }
+};
+
+}  // namespace cgx